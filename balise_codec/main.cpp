@@ -11,6 +11,7 @@
 */
  
 #include "balise_codec.h"
+#include "codec_server.h"
 #include "CLI11.hpp"            // parse command line parameters
 
 int verbose = VERB_PROG;        // default verbosity, can be overridden by command line option --verbose
@@ -18,11 +19,11 @@ int verbose = VERB_PROG;        // default verbosity, can be overridden by comma
 int main(int argc, char** argv)
 // the main function from which the rest of the program is called
 {
-    telegram *telegrams = NULL, *p_telegram = NULL;
+    telegram_batch telegrams;
     int result = ERR_NO_ERR;            // end result of this program (0=success)
     clock_t start, end;
     double execution_time;
-    string output_text;                 // the output of the program
+    int output_fd;                      // the file descriptor the output is written to
 
     // command line parameters:
     string input_file = "";             // the input file name
@@ -30,10 +31,26 @@ int main(int argc, char** argv)
     string literal = "";                // the input literal 
     string output_format = "";          // the output format (if set to hex, output as hex. Otherwise: output in base64)
     int max_cpu = 0;                    // maximum nr of simultaneous processes (0=unlimited)
+    int chunk_size = 0;                 // nr of telegrams per chunk taken by a thread (0=adaptive)
     bool force_long = false;            // force long format for shaped telegrams
     bool show_err = false;              // show the meaning of the error codes
     bool error_only = false;            // only show output lines that contain an error
     bool calc_all = false;              // calculate all possible shaped telegrams for each input telegram
+    bool parallel_search = false;       // distribute the search of SB/ESB of each telegram over the threads
+    bool stream = false;                // stream the input file through the thread pool with bounded memory
+    t_stream_param stream_param;        // the parameters of the streaming mode
+    int stream_result;                  // the result of the streaming mode (first error code)
+    string serve_socket = "";           // serve requests on this Unix domain socket
+    string client_socket = "";          // send the input to the server on this Unix domain socket
+    bool stats = false;                 // print the counters of the shaping search
+    string stats_json = "";             // write the counters of the shaping search to this file
+    bool adaptive_checks = false;       // adapt the order of the candidate checks to their rejection rates
+    string check_profile_file = "";     // read and write the statistics of the candidate checks in this file
+    string cache_file = "";             // the cache of shaped telegrams
+    int cache_size = RESULT_CACHE_DEFAULT_SLOTS;    // nr of telegrams in a new cache file
+    telegram_batch unique;              // the telegrams without the duplicates (see remove_duplicate_telegrams)
+    vector<unsigned int> source;        // the index in unique of the result of each telegram
+    unsigned int n_duplicates = 0;      // nr of telegrams with the same user data as an earlier telegram
 
     setupConsole();                     // for colorful output
 
@@ -49,6 +66,17 @@ int main(int argc, char** argv)
     app.add_flag("-e,--show_error_codes", show_err, "Shows the meaning of the error codes that can be generated when checking / shaping telegrams.");
     app.add_flag("-E,--error_only", error_only, "Output only the telegrams in which an error was found (-e gives the error codes).");
     app.add_flag("-a,--calc_all", calc_all, "Calculate all valid combinations of scrambling bits (SB) and extra shaping bits (ESB) for each telegram in the input. The output will contain the SB and ESB in two extra columns, as well as the 9th and 10th 11-bit word of each telegram.");
+    app.add_flag("-p,--parallel_search", parallel_search, "Shape the telegrams one by one, distributing the search of scrambling bits and extra shaping bits of each telegram over all cpu's. The result is identical to the default shaping. Gives the lowest latency for a single telegram or a few telegrams. Not used in combination with --calc_all.");
+    app.add_option("--chunk", chunk_size, "Nr of telegrams that a thread takes at once from the input. 0 (default) adapts the size to the remaining work: large chunks at the start, single telegrams at the end. The idle time of the threads is shown with verbosity >= 1.");
+    app.add_flag("--stream", stream, "Stream the input file (-i) in chunks through the thread pool and write the results in the order of the input as soon as they are ready. Uses a constant amount of memory, for very large input files. Not used in combination with --parallel_search.");
+    app.add_option("--serve", serve_socket, "Run as a server on this Unix domain socket: keep the threads and tables ready and convert the lines that clients send (in the format of the input file) with the other options given here (-f, -a, -E, -l, -m). Stop with Ctrl-C. Not available on Windows.");
+    app.add_flag("--stats", stats, "Count the candidates that are rejected by each stage of the shaping search and the time spent in each stage, print a summary at the end.");
+    app.add_option("--stats_json", stats_json, "Like --stats, write the counters and times as JSON to this file.");
+    app.add_flag("--adaptive_checks", adaptive_checks, "Order the checks of the candidate telegrams during shaping by their observed cost per rejected candidate, cheapest first, and keep adapting the order during the run. The result is identical to the default shaping.");
+    app.add_option("--check_profile", check_profile_file, "Read the statistics of the candidate checks from this file (if it exists) and order the checks with them, write the statistics of this run added to them to the file at the end. The result is identical to the default shaping.");
+    app.add_option("--cache", cache_file, "Keep the shaped telegrams in this cache file (created if it does not exist) and use them in later runs: a telegram that is found is only checked instead of shaped. The result is identical to the default shaping. Not used with --parallel_search.");
+    app.add_option("--cache_size", cache_size, "Nr of telegrams that fit in a new cache file (see --cache), 256 bytes each. Default: 65536.");
+    app.add_option("--client", client_socket, "Send the input (-i or -s) to the server on this Unix domain socket (see --serve) and write its answer to the output, like a normal run. The exit code is the error code of the answer.");
     CLI11_PARSE(app, argc, argv);
 
     // tbd: print the command line parameters when verb >= VERB_FLOW
@@ -69,6 +97,7 @@ int main(int argc, char** argv)
         printf("\t%d\tError during memory allocation\n", ERR_MEM_ALLOC);
         printf("\t%d\tError in the input data (wrong size, illegal chars, ...)\n", ERR_INPUT_ERROR);
         printf("\t%d\tError creating calculation thread or acquiring mutex\n", ERR_THREAD_CREATION);
+        printf("\t%d\tError creating, binding or connecting the socket of the server (--serve, --client)\n", ERR_SOCKET);
         printf("\t%d\tAlphabet condition fails\n", ERR_ALPHABET);
         printf("\t%d\tOff-sync parsing condition fails\n", ERR_OFF_SYNCH_PARSING);
         printf("\t%d\tAperiodicity condition fails\n", ERR_APERIODICITY);
@@ -84,14 +113,68 @@ int main(int argc, char** argv)
 
     // execute the commands from the command line:
 
+    stats_enabled = stats || (stats_json != "");
+    if ((init_check_profile(adaptive_checks, check_profile_file) != ERR_NO_ERR) || (open_shape_cache(cache_file, (unsigned int)cache_size) != ERR_NO_ERR))
+    {
+        restoreConsole();
+        return ERR_INPUT_ERROR;
+    }
+
+    if (serve_socket != "")
+    // serve requests until the process is stopped
+    {
+        if (verbose > VERB_FLOW)
+            max_cpu = 1;
+
+        stream_param = { "", "", output_format, error_only, calc_all, force_long, (unsigned int)max_cpu };
+        stream_result = run_server(serve_socket, stream_param);
+        close_shape_cache();
+
+        restoreConsole();
+        return stream_result;
+    }
+
+    if (client_socket != "")
+    // let the server convert the input
+    {
+        stream_result = run_client(client_socket, input_file, literal, output_file);
+
+        restoreConsole();
+        return stream_result;
+    }
+
+    if (stream && (input_file != ""))
+    // stream the input file to the output, without storing all telegrams
+    {
+        if (verbose > VERB_FLOW)
+            max_cpu = 1;
+
+        start = clock();
+        stream_param = { input_file, output_file, output_format, error_only, calc_all, force_long, (unsigned int)max_cpu };
+        stream_result = convert_stream(stream_param);
+
+        end = clock();
+        execution_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+        eprintf(VERB_PROG, "Calculation time: %.2f secs\n", execution_time);
+        output_shape_stats(stats, stats_json);
+        save_check_profile(check_profile_file);
+        close_shape_cache();
+
+        restoreConsole();
+        return stream_result;
+    }
+
+    // set the #processes to 1 if the verbosity level is higher than VERB_PROG
+    if (verbose > VERB_FLOW)
+        max_cpu = 1;
+
     // first get the input (either input file or literal)
     if (input_file != "")
-    // filename is set, load the data from the file:
-        telegrams = parse_content_string(read_from_file(input_file));
+    // filename is set, map the file and parse it in parallel:
+        telegrams = read_telegrams_from_file(input_file, (unsigned int)max_cpu);
     else
     {
-        telegrams = parse_input_line(literal.c_str());
-        if (telegrams == NULL)
+        if (!parse_input_line(literal.c_str(), telegrams))
         {
             eprintf(VERB_QUIET, ERROR_COLOR "ERROR: No input specified, quitting.\n" ANSI_COLOR_RESET);
             restoreConsole();
@@ -102,36 +185,49 @@ int main(int argc, char** argv)
     // set the force_long parameter of the telegrams:
     if (force_long)
     {
-        p_telegram = telegrams;
-
-        while (p_telegram)
-        {
-            p_telegram->force_long = true;
-            p_telegram = p_telegram->next;
-        }
+        for (telegram& t : telegrams)
+            t.force_long = true;
     }
 
-    // set the #processes to 1 if the verbosity level is higher than VERB_PROG
-    if (verbose > VERB_FLOW)
-        max_cpu = 1;
-
     start = clock();
 
+    // shape each user data only once (calc_all returns all variants of each telegram):
+    if (!calc_all)
+        n_duplicates = remove_duplicate_telegrams(telegrams, unique, source);
+    if (n_duplicates > 0)
+        eprintf(VERB_PROG, "Found %d duplicate telegram(s), these are shaped once.\n", n_duplicates);
+    telegram_batch& work = (n_duplicates > 0) ? unique : telegrams;
+
     // convert the input to the other format or check the correctness of a telegram:
-    convert_telegrams_multithreaded(telegrams, max_cpu, calc_all);
+    if (parallel_search && !calc_all)
+        convert_telegrams_parallel_search(work, max_cpu);
+    else
+        convert_telegrams_multithreaded(work, max_cpu, calc_all, (unsigned int)chunk_size);
+
+    if (n_duplicates > 0)
+        restore_duplicate_telegrams(telegrams, unique, source);
 
     end = clock();
     execution_time = ((double)(end - start)) / CLOCKS_PER_SEC;
     eprintf(VERB_PROG, "Calculation time: %.2f secs\n", execution_time);
 
-    // determine the output string:
-    output_text = output_telegrams_to_string(telegrams, output_format, error_only, true, calc_all);
-
-    // output the result to the indicated medium:
+    // output the result to the indicated medium, the same stream as eprintf if no output file is given:
     if (output_file != "")
-        output_telegrams_to_file(output_text, output_file);
+    {
+        output_fd = open_output_file(output_file);
+        eprintf(VERB_FLOW, "Writing output to file: '%s'.\n", output_file.c_str());
+    }
     else
-        eprintf(VERB_QUIET, "%s", output_text.c_str());
+        output_fd = fileno(stderr);
+
+    output_telegrams_to_fd(telegrams, output_format, error_only, true, calc_all, output_fd);
+
+    if (output_file != "")
+        close_fd(output_fd);
+
+    output_shape_stats(stats, stats_json);
+    save_check_profile(check_profile_file);
+    close_shape_cache();
 
 //    eprintf(VERB_QUIET, "Ready. Press any key to continue ...");
 //    char dummy = getch();
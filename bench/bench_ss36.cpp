@@ -0,0 +1,393 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * bench_ss36 - benchmarks of the conversion pipeline and of its kernels, with reproducible workloads
+ *
+ * All input is generated from a fixed seed, so two builds run exactly the same workloads.
+ * Each workload runs --warmup times untimed and --repetitions times timed. The time per item (telegram, line or kernel call)
+ * is derived from the median repetition. The results are printed as a table, and written as JSON with --json
+ * to compare builds (e.g. in a regression check). With --json - the JSON goes to stdout and the table to stderr.
+*/
+
+#include <stdio.h>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <math.h>
+#include "balise_codec.h"
+#include "check_bits.h"
+#include "undersampling.h"
+#include "cpu_features.h"
+#include "CLI11.hpp"
+
+#define BENCH_DEFAULT_SEED          36      // seed of the generated workloads
+#define BENCH_KERNEL_CALLS          64      // nr of kernel calls per telegram in the kernel workloads
+
+int verbose = VERB_QUIET;
+
+typedef struct
+{
+    unsigned int count;             // nr of telegrams per workload
+    unsigned int calc_all_count;    // nr of telegrams in the calc_all workload
+    unsigned int repetitions;       // nr of timed runs per workload
+    unsigned int warmup;            // nr of untimed runs before the timed runs
+    unsigned int max_cpu;           // nr of threads used by the conversions
+    unsigned int seed;              // seed of the generated workloads
+    string filter;                  // only run the workloads of which the name contains this text
+    FILE* table;                    // the table of the results is printed here (stderr if the JSON goes to stdout)
+} t_bench_param;
+
+typedef struct
+{
+    string name;                    // name of the workload
+    string unit;                    // what one item is: telegram, line, call
+    unsigned int items;             // nr of items per run
+    vector<double> times;           // the time of each timed run (seconds)
+    double min, median, mean, stddev;
+} t_bench_result;
+
+volatile uint64_t bench_sink;       // results of the kernels end up here, so they are not optimised away
+
+static void calc_statistics(t_bench_result& r)
+// calculates the min, median, mean and standard deviation of the times of r
+{
+    vector<double> sorted = r.times;
+    size_t n = sorted.size();
+    double sum = 0, sq = 0;
+
+    std::sort(sorted.begin(), sorted.end());
+    r.min = sorted[0];
+    r.median = (n % 2) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+
+    for (double t : sorted)
+        sum += t;
+    r.mean = sum / n;
+
+    for (double t : sorted)
+        sq += (t - r.mean) * (t - r.mean);
+    r.stddev = (n > 1) ? sqrt(sq / (n - 1)) : 0;
+}
+
+static void run_workload(vector<t_bench_result>& results, const t_bench_param& p, const string name, const string unit, unsigned int items,
+    std::function<void(void)> prepare, std::function<void(void)> run)
+// runs the workload (prepare is not timed, run is timed) if its name matches the filter, adds the result to results
+{
+    t_bench_result r;
+    std::chrono::steady_clock::time_point t0;
+    unsigned int i;
+
+    if ((p.filter != "") && (name.find(p.filter) == string::npos))
+        return;
+
+    if (items == 0)
+        return;
+
+    r.name = name;
+    r.unit = unit;
+    r.items = items;
+
+    for (i = 0; i < p.warmup + p.repetitions; i++)
+    {
+        if (prepare)
+            prepare();
+
+        t0 = std::chrono::steady_clock::now();
+        run();
+        if (i >= p.warmup)
+            r.times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    }
+
+    calc_statistics(r);
+    fprintf(p.table, "%-28s %8u %-9s %12.3f %12.3f %10.1f%%\n", r.name.c_str(), r.items, r.unit.c_str(),
+        1e3 * r.median, 1e9 * r.median / r.items, (r.mean > 0) ? 100 * r.stddev / r.mean : 0.0);
+    fflush(p.table);
+
+    results.push_back(r);
+}
+
+static string random_hex(std::mt19937& rng, int n_chars)
+// returns n_chars random hex chars
+{
+    static const char digits[] = "0123456789ABCDEF";
+    string s(n_chars, '0');
+    int i;
+
+    for (i = 0; i < n_chars; i++)
+        s[i] = digits[rng() % 16];
+
+    return s;
+}
+
+static string column(const string& line, int n)
+// returns column n (0 = first) of a line of the output
+{
+    size_t start = 0, end;
+
+    while (n-- > 0)
+        start = line.find(CSV_SEPARATOR, start) + 1;
+
+    end = line.find(CSV_SEPARATOR, start);
+    return line.substr(start, (end == string::npos) ? string::npos : end - start);
+}
+
+static vector<string> output_lines(telegram_batch& telegrams, const string format)
+// returns the output lines of the telegrams (without header)
+{
+    vector<string> lines;
+    string out = output_telegrams_to_string(telegrams, format, false, false, false);
+    size_t start = 0, end;
+
+    while ((end = out.find('\n', start)) != string::npos)
+    {
+        lines.push_back(out.substr(start, end - start));
+        start = end + 1;
+    }
+
+    return lines;
+}
+
+static string join_lines(const vector<string>& lines)
+// returns the lines as the contents of an input file
+{
+    string s;
+
+    for (const string& line : lines)
+        s += line + "\n";
+
+    return s;
+}
+
+static void write_json(FILE* f, const t_bench_param& p, const vector<t_bench_result>& results)
+// writes the settings, the build and the results to f as JSON
+{
+    const t_cpu_features& cpu = get_cpu_features();
+    size_t i, j;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"program\": \"bench_ss36\",\n");
+    fprintf(f, "  \"version\": \"%s\",\n", VER_FILEVERSION_STR);
+#if defined(_MSC_VER)
+    fprintf(f, "  \"compiler\": \"MSVC %d\",\n", _MSC_VER);
+#elif defined(__VERSION__)
+    fprintf(f, "  \"compiler\": \"%s\",\n", __VERSION__);
+#else
+    fprintf(f, "  \"compiler\": \"unknown\",\n");
+#endif
+#if defined(NDEBUG)
+    fprintf(f, "  \"debug\": false,\n");
+#else
+    fprintf(f, "  \"debug\": true,\n");
+#endif
+    fprintf(f, "  \"cpu_features\": { \"pclmul\": %s, \"bmi2\": %s, \"ssse3\": %s, \"pmull\": %s },\n",
+        cpu.pclmul ? "true" : "false", cpu.bmi2 ? "true" : "false", cpu.ssse3 ? "true" : "false", cpu.pmull ? "true" : "false");
+    fprintf(f, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(f, "  \"seed\": %u,\n  \"count\": %u,\n  \"calc_all_count\": %u,\n  \"repetitions\": %u,\n  \"warmup\": %u,\n  \"max_cpu\": %u,\n",
+        p.seed, p.count, p.calc_all_count, p.repetitions, p.warmup, p.max_cpu);
+    fprintf(f, "  \"results\": [\n");
+
+    for (i = 0; i < results.size(); i++)
+    {
+        const t_bench_result& r = results[i];
+
+        fprintf(f, "    { \"name\": \"%s\", \"unit\": \"%s\", \"items\": %u, \"min_s\": %.9f, \"median_s\": %.9f, \"mean_s\": %.9f, \"stddev_s\": %.9f, \"ns_per_item\": %.3f, \"times_s\": [",
+            r.name.c_str(), r.unit.c_str(), r.items, r.min, r.median, r.mean, r.stddev, 1e9 * r.median / r.items);
+        for (j = 0; j < r.times.size(); j++)
+            fprintf(f, "%s%.9f", j ? ", " : "", r.times[j]);
+        fprintf(f, "] }%s\n", (i + 1 < results.size()) ? "," : "");
+    }
+
+    fprintf(f, "  ]\n}\n");
+}
+
+static void run_pipeline_workloads(vector<t_bench_result>& results, const t_bench_param& p)
+// the workloads of the conversion pipeline: parsing, shaping, deshaping, checking, calc_all and formatting
+{
+    std::mt19937 rng(p.seed);
+    vector<string> unshaped[2], shaped_lines, deshape_lines, check_lines, check_lines_b64;
+    string unshaped_text[2], deshape_text, check_text, check_text_b64, calc_all_text;
+    telegram_batch input, work, checked;
+    unsigned int i, is_long;
+
+    // the user data of the short and long telegrams:
+    for (is_long = 0; is_long < 2; is_long++)
+    {
+        for (i = 0; i < p.count; i++)
+            unshaped[is_long].push_back(random_hex(rng, is_long ? N_CHARS_UNSHAPED_LONG_HEX : N_CHARS_UNSHAPED_SHORT_HEX));
+        unshaped_text[is_long] = join_lines(unshaped[is_long]);
+    }
+
+    // shape them once to create the input of the other workloads (half short, half long):
+    for (is_long = 0; is_long < 2; is_long++)
+    {
+        work = parse_content_string(unshaped_text[is_long]);
+        convert_telegrams_multithreaded(work, p.max_cpu, false);
+        for (string& line : output_lines(work, "hex"))
+        {
+            deshape_lines.push_back(column(line, 1));
+            check_lines.push_back(column(line, 0) + CSV_SEPARATOR + column(line, 1));
+        }
+        for (string& line : output_lines(work, "base64"))
+            check_lines_b64.push_back(column(line, 0) + CSV_SEPARATOR + column(line, 1));
+    }
+    deshape_text = join_lines(deshape_lines);
+    check_text = join_lines(check_lines);
+    check_text_b64 = join_lines(check_lines_b64);
+    calc_all_text = join_lines(vector<string>(unshaped[1].begin(), unshaped[1].begin() + min(p.calc_all_count, p.count)));
+
+    run_workload(results, p, "parse_hex", "line", (unsigned int)check_lines.size(), NULL,
+        [&] { work = parse_content_string(check_text); });
+
+    run_workload(results, p, "parse_base64", "line", (unsigned int)check_lines_b64.size(), NULL,
+        [&] { work = parse_content_string(check_text_b64); });
+
+    for (is_long = 0; is_long < 2; is_long++)
+    {
+        input = parse_content_string(unshaped_text[is_long]);
+        run_workload(results, p, is_long ? "shape_long" : "shape_short", "telegram", (unsigned int)input.size(),
+            [&] { work = input; },
+            [&] { convert_telegrams_multithreaded(work, p.max_cpu, false); });
+    }
+
+    input = parse_content_string(deshape_text);
+    run_workload(results, p, "deshape", "telegram", (unsigned int)input.size(),
+        [&] { work = input; },
+        [&] { convert_telegrams_multithreaded(work, p.max_cpu, false); });
+
+    input = parse_content_string(check_text);
+    run_workload(results, p, "check", "telegram", (unsigned int)input.size(),
+        [&] { work = input; },
+        [&] { convert_telegrams_multithreaded(work, p.max_cpu, false); });
+
+    input = parse_content_string(calc_all_text);
+    run_workload(results, p, "calc_all", "telegram", (unsigned int)input.size(),
+        [&] { work = input; },
+        [&] { convert_telegrams_multithreaded(work, p.max_cpu, true); });
+
+    checked = parse_content_string(check_text);
+    convert_telegrams_multithreaded(checked, p.max_cpu, false);
+    run_workload(results, p, "format_hex", "telegram", (unsigned int)checked.size(), NULL,
+        [&] { bench_sink += output_telegrams_to_string(checked, "hex", false, true, false).length(); });
+
+    run_workload(results, p, "format_base64", "telegram", (unsigned int)checked.size(), NULL,
+        [&] { bench_sink += output_telegrams_to_string(checked, "base64", false, true, false).length(); });
+}
+
+static void run_kernel_workloads(vector<t_bench_result>& results, const t_bench_param& p)
+// the workloads of the kernels, each with the kernel selected for this cpu and with the portable kernel
+{
+    std::mt19937 rng(p.seed + 1);
+    unsigned int i, calls = p.count * BENCH_KERNEL_CALLS;
+    uint8_t bytes[N_CHARS_SHAPED_LONG_HEX / 2], decoded[N_CHARS_SHAPED_LONG_HEX / 2];
+    char hex[N_CHARS_SHAPED_LONG_HEX], base64[BASE64_LENGTH(N_CHARS_SHAPED_LONG_HEX / 2)];
+    longnum contents;
+    longnum v[UNDERSAMPLING_N_TELEGRAMS];
+    t_remainder r, intermediate;
+    longnum_checkbits checkbits;
+
+    for (i = 0; i < WORDS_IN_LONGNUM; i++)
+        contents[i] = (t_word)rng();
+    for (i = 0; i < sizeof(bytes); i++)
+        bytes[i] = (uint8_t)rng();
+    encode_hex_portable(bytes, sizeof(bytes), hex);
+    encode_base64_portable(bytes, sizeof(bytes), base64);
+
+    // the check bits as telegram::compute_check_bits_opt calculates them: the words of a telegram once per SB, then once per ESB
+    run_workload(results, p, "check_bits_feed", "call", calls, NULL,
+        [&] { int k; for (i = 0; i < calls; i++) { r[0] = i; r[1] = 0; for (k = 0; k < WORDS_IN_LONGNUM; k++) check_bits_long.feed(r, contents[k]); bench_sink += r[0]; } });
+
+    intermediate[0] = ((uint64_t)rng() << 32) | rng();
+    intermediate[1] = rng() & 0x1FFFFF;
+    run_workload(results, p, "check_bits_esb", "call", calls, NULL,
+        [&] { for (i = 0; i < calls; i++) { r[0] = intermediate[0]; r[1] = intermediate[1]; check_bits_long.add_esb(r, (t_esb)(i & 0x3FF)); check_bits_long.get_check_bits(r, checkbits); bench_sink += checkbits[0]; } });
+
+    run_workload(results, p, "undersample", "call", calls / 16, NULL,
+        [&] { for (i = 0; i < calls / 16; i++) { contents[0] ^= i; undersample_telegram(get_deinterleave(), contents, s_long, v); bench_sink += v[0][0]; } });
+    if (get_deinterleave() != deinterleave_portable)
+        run_workload(results, p, "undersample_portable", "call", calls / 16, NULL,
+            [&] { for (i = 0; i < calls / 16; i++) { contents[0] ^= i; undersample_telegram(deinterleave_portable, contents, s_long, v); bench_sink += v[0][0]; } });
+
+    run_workload(results, p, "encode_hex", "call", calls, NULL,
+        [&] { t_encode_hex* f = get_encode_hex(); for (i = 0; i < calls; i++) { bytes[0] ^= i; f(bytes, sizeof(bytes), hex); bench_sink += hex[0]; } });
+    if (get_encode_hex() != encode_hex_portable)
+        run_workload(results, p, "encode_hex_portable", "call", calls, NULL,
+            [&] { for (i = 0; i < calls; i++) { bytes[0] ^= i; encode_hex_portable(bytes, sizeof(bytes), hex); bench_sink += hex[0]; } });
+
+    run_workload(results, p, "encode_base64", "call", calls, NULL,
+        [&] { t_encode_base64* f = get_encode_base64(); for (i = 0; i < calls; i++) { bytes[0] ^= i; f(bytes, sizeof(bytes), base64); bench_sink += base64[0]; } });
+    if (get_encode_base64() != encode_base64_portable)
+        run_workload(results, p, "encode_base64_portable", "call", calls, NULL,
+            [&] { for (i = 0; i < calls; i++) { bytes[0] ^= i; encode_base64_portable(bytes, sizeof(bytes), base64); bench_sink += base64[0]; } });
+
+    run_workload(results, p, "decode_hex", "call", calls, NULL,
+        [&] { t_decode_hex* f = get_decode_hex(); for (i = 0; i < calls; i++) { bench_sink += f(hex, sizeof(decoded), decoded); bench_sink += decoded[i % sizeof(decoded)]; } });
+    if (get_decode_hex() != decode_hex_portable)
+        run_workload(results, p, "decode_hex_portable", "call", calls, NULL,
+            [&] { for (i = 0; i < calls; i++) { bench_sink += decode_hex_portable(hex, sizeof(decoded), decoded); bench_sink += decoded[i % sizeof(decoded)]; } });
+
+    run_workload(results, p, "decode_base64", "call", calls, NULL,
+        [&] { t_decode_base64* f = get_decode_base64(); for (i = 0; i < calls; i++) { bench_sink += f(base64, sizeof(base64), decoded); bench_sink += decoded[i % sizeof(decoded)]; } });
+    if (get_decode_base64() != decode_base64_portable)
+        run_workload(results, p, "decode_base64_portable", "call", calls, NULL,
+            [&] { for (i = 0; i < calls; i++) { bench_sink += decode_base64_portable(base64, sizeof(base64), decoded); bench_sink += decoded[i % sizeof(decoded)]; } });
+}
+
+int main(int argc, char** argv)
+// runs the benchmarks, returns 0 if ok
+{
+    t_bench_param p = { 200, 2, 5, 1, 1, BENCH_DEFAULT_SEED, "", stdout };
+    vector<t_bench_result> results;
+    string json_file = "";
+    FILE* f;
+
+    CLI::App app{ "bench_ss36: benchmarks of balise_codec with reproducible workloads. Version: " VER_FILEVERSION_STR };
+    app.add_option("-n,--count", p.count, "Nr of telegrams per workload (default 200). The kernel workloads make 64 calls per telegram.");
+    app.add_option("-c,--calc_all_count", p.calc_all_count, "Nr of telegrams in the calc_all workload (default 2).");
+    app.add_option("-r,--repetitions", p.repetitions, "Nr of timed runs per workload (default 5). The median is reported.");
+    app.add_option("-w,--warmup", p.warmup, "Nr of untimed runs before the timed runs (default 1).");
+    app.add_option("-m,--max_cpu", p.max_cpu, "Nr of threads used by the conversions (default 1, 0 = all cores).");
+    app.add_option("-s,--seed", p.seed, "Seed of the generated workloads (default 36).");
+    app.add_option("-k,--workload", p.filter, "Only run the workloads of which the name contains this text.");
+    app.add_option("-j,--json", json_file, "Write the results as JSON to this file ('-' for stdout, the table then goes to stderr).");
+    CLI11_PARSE(app, argc, argv);
+
+    if ((p.count == 0) || (p.repetitions == 0))
+    {
+        eprintf(VERB_QUIET, "Error: count and repetitions must be > 0.\n");
+        return ERR_INPUT_ERROR;
+    }
+
+    if (json_file == "-")
+        p.table = stderr;
+
+    fprintf(p.table, "%-28s %8s %-9s %12s %12s %11s\n", "workload", "items", "unit", "median ms", "ns/item", "stddev");
+    run_pipeline_workloads(results, p);
+    run_kernel_workloads(results, p);
+
+    if (json_file == "-")
+        write_json(stdout, p, results);
+    else if (json_file != "")
+    {
+        f = fopen(json_file.c_str(), "w");
+        if (f == NULL)
+        {
+            eprintf(VERB_QUIET, "Error creating %s: %s\n", json_file.c_str(), strerror(errno));
+            return ERR_OUTPUT_FILE;
+        }
+
+        write_json(f, p, results);
+        fclose(f);
+    }
+
+    return ERR_NO_ERR;
+}
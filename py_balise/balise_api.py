@@ -2,7 +2,7 @@
 
 import os
 import ctypes
-from ctypes import c_char_p, c_uint, c_bool, c_size_t, c_int, create_string_buffer
+from ctypes import c_char_p, c_uint, c_bool, c_size_t, c_int, c_void_p, POINTER, create_string_buffer
 
 # Path to the compiled shared library
 # Adjust depending on your project layout (e.g. ../build/libbalise_codec.so)
@@ -37,6 +37,20 @@ lib.encode_telegram_line.argtypes = [
 ]
 lib.encode_telegram_line.restype = c_int
 
+# int encode_telegram_lines(const char* const* input_lines, size_t n_lines, unsigned int max_cpu,
+#                           uint8_t* shaped, uint8_t* deshaped, int* errcodes, int* sizes);
+lib.encode_telegram_lines.argtypes = [POINTER(c_char_p), c_size_t, c_uint, c_void_p, c_void_p, c_void_p, c_void_p]
+lib.encode_telegram_lines.restype = c_int
+
+# int encode_telegram_buffer(const char* input, size_t input_size, unsigned int max_cpu,
+#                            uint8_t* shaped, uint8_t* deshaped, int* errcodes, int* sizes,
+#                            size_t max_lines, size_t* n_lines);
+lib.encode_telegram_buffer.argtypes = [c_char_p, c_size_t, c_uint, c_void_p, c_void_p, c_void_p, c_void_p, c_size_t, POINTER(c_size_t)]
+lib.encode_telegram_buffer.restype = c_int
+
+SHAPED_BYTES = 128      # bytes per telegram in the shaped array (API_SHAPED_BYTES)
+DESHAPED_BYTES = 104    # bytes per telegram in the deshaped array (API_DESHAPED_BYTES)
+
 
 def encode_telegram(input_line: str,
                     max_cpu: int = 0,
@@ -96,4 +110,69 @@ def decode_encoded_output(encoded: str):
     telegram_encoded = parts[1]
     status = int(parts[2])
 
-    return  telegram_encoded,telegram, status
\ No newline at end of file
+    return  telegram_encoded,telegram, status
+
+
+class TelegramBatch:
+    """
+    The results of encode_telegrams, in contiguous arrays (no copies per telegram):
+        shaped:   n * SHAPED_BYTES bytes, telegram i at [i*SHAPED_BYTES : i*SHAPED_BYTES + shaped_length(i)]
+        deshaped: n * DESHAPED_BYTES bytes, telegram i at [i*DESHAPED_BYTES : i*DESHAPED_BYTES + deshaped_length(i)]
+        errcodes: error code of each line (1 = empty or comment-only line)
+        sizes:    nr of bits of each telegram (1023 or 341, 0 if there is no telegram)
+    The arrays support the buffer protocol, so e.g. numpy.frombuffer can use them without copying.
+    """
+    def __init__(self, n: int):
+        self.n = n
+        self.shaped = (ctypes.c_uint8 * (n * SHAPED_BYTES))()
+        self.deshaped = (ctypes.c_uint8 * (n * DESHAPED_BYTES))()
+        self.errcodes = (c_int * n)()
+        self.sizes = (c_int * n)()
+
+    def __len__(self):
+        return self.n
+
+    def shaped_length(self, i: int) -> int:
+        return (self.sizes[i] + 7) // 8
+
+    def deshaped_length(self, i: int) -> int:
+        return {1023: 104, 341: 27}.get(self.sizes[i], 0)
+
+    def __getitem__(self, i: int):
+        """ returns (shaped telegram, deshaped telegram, status) of line i, as in encode_telegram but as bytes """
+        if not 0 <= i < self.n:
+            raise IndexError(i)
+        shaped = memoryview(self.shaped)[i * SHAPED_BYTES : i * SHAPED_BYTES + self.shaped_length(i)]
+        deshaped = memoryview(self.deshaped)[i * DESHAPED_BYTES : i * DESHAPED_BYTES + self.deshaped_length(i)]
+        return bytes(shaped), bytes(deshaped), self.errcodes[i]
+
+
+def encode_telegrams(lines, max_cpu: int = 0) -> TelegramBatch:
+    """
+    Calls the C++ library to encode many telegram lines at once, in a thread pool that is kept between the calls.
+
+    :param lines: a list of lines (str or bytes), or one bytes object with lines separated by '\n' (passed without copying)
+    :param max_cpu: 0 = all cores, otherwise the max nr of threads of the shared pool that this call uses (on every call).
+    :return: TelegramBatch with the result of each line, in the order of the lines
+    """
+    if isinstance(lines, (bytes, bytearray)):
+        n = lines.count(b"\n") + (0 if lines.endswith(b"\n") or len(lines) == 0 else 1)
+        batch = TelegramBatch(n)
+        n_lines = c_size_t(0)
+        data = bytes(lines) if isinstance(lines, bytearray) else lines
+        rc = lib.encode_telegram_buffer(data, len(data), max_cpu, batch.shaped, batch.deshaped,
+                                        batch.errcodes, batch.sizes, n, ctypes.byref(n_lines))
+    else:
+        encoded = [line.encode("ascii") if isinstance(line, str) else bytes(line) for line in lines]
+        batch = TelegramBatch(len(encoded))
+        rc = lib.encode_telegram_lines((c_char_p * len(encoded))(*encoded), len(encoded), max_cpu,
+                                       batch.shaped, batch.deshaped, batch.errcodes, batch.sizes)
+
+    if rc == -1:
+        raise ValueError("Invalid parameters")
+    if rc == -2:
+        raise ValueError("More lines in the buffer than expected")
+    if rc != 0:
+        raise RuntimeError(f"encode_telegram_lines failed with error code {rc}")
+
+    return batch
@@ -6,4 +6,11 @@ line = "8010011CB80002421989DCCFD8111D193FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF
 
 res = encode_telegram(line, max_cpu=0, calc_all=False)
 print("Résult :")
-print(res[0])
\ No newline at end of file
+print(res[0])
+
+# many telegrams at once, e.g. the rows of a table:
+from balise_api import encode_telegrams
+
+batch = encode_telegrams([line, "", line])
+for shaped, deshaped, status in (batch[i] for i in range(len(batch))):
+    print(status, shaped.hex().upper())
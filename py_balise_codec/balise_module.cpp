@@ -0,0 +1,285 @@
+// Native Python module py_balise_codec, on top of the batch functions of python_api.cpp
+//
+// The module releases the GIL while the telegrams are converted, so several Python threads can use it at the same time.
+// The results are returned as memoryviews (buffer protocol) on bytes objects, without copying them:
+//   shaped:   uint8, n * API_SHAPED_BYTES      (same bytes as the hex output, zero padded)
+//   deshaped: uint8, n * API_DESHAPED_BYTES
+//   errcodes: int32, n                         (ERR_NO_INPUT for an empty or comment-only line)
+//   sizes:    int32, n                         (1023 or 341, 0 if there is no telegram)
+// numpy.asarray() can use them directly (reshape shaped and deshaped to n rows).
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "python_api.h"
+
+static PyObject* make_view(PyObject* bytes, const char* format)
+// returns a memoryview on bytes with the given format. Steals the reference to bytes.
+{
+    PyObject *view, *cast;
+
+    if (bytes == NULL)
+        return NULL;
+
+    view = PyMemoryView_FromObject(bytes);
+    Py_DECREF(bytes);       // the view keeps the bytes alive
+    if (view == NULL)
+        return NULL;
+
+    cast = PyObject_CallMethod(view, "cast", "s", format);
+
+    Py_DECREF(view);
+    return cast;
+}
+
+static bool make_result(Py_ssize_t n, PyObject** shaped, PyObject** deshaped, PyObject** errcodes, PyObject** sizes)
+// creates the bytes objects for the results of n lines; returns false if this fails
+{
+    *shaped = PyBytes_FromStringAndSize(NULL, n * API_SHAPED_BYTES);
+    *deshaped = PyBytes_FromStringAndSize(NULL, n * API_DESHAPED_BYTES);
+    *errcodes = PyBytes_FromStringAndSize(NULL, n * sizeof(int));
+    *sizes = PyBytes_FromStringAndSize(NULL, n * sizeof(int));
+
+    if ((*shaped == NULL) || (*deshaped == NULL) || (*errcodes == NULL) || (*sizes == NULL))
+    {
+        Py_XDECREF(*shaped);
+        Py_XDECREF(*deshaped);
+        Py_XDECREF(*errcodes);
+        Py_XDECREF(*sizes);
+        return false;
+    }
+
+    return true;
+}
+
+static PyObject* return_result(int rc, PyObject* shaped, PyObject* deshaped, PyObject* errcodes, PyObject* sizes)
+// returns the tuple (shaped, deshaped, errcodes, sizes) of memoryviews, or raises the error in rc
+{
+    if (rc != 0)
+    {
+        Py_DECREF(shaped);
+        Py_DECREF(deshaped);
+        Py_DECREF(errcodes);
+        Py_DECREF(sizes);
+
+        if (rc == -99)
+            PyErr_SetString(PyExc_RuntimeError, "unexpected exception while converting the telegrams");
+        else
+            PyErr_Format(PyExc_ValueError, "converting the telegrams failed with error code %d", rc);
+        return NULL;
+    }
+
+    return Py_BuildValue("(NNNN)",
+        make_view(shaped, "B"),
+        make_view(deshaped, "B"),
+        make_view(errcodes, "i"),
+        make_view(sizes, "i"));
+}
+
+static Py_ssize_t count_lines(const char* buf, Py_ssize_t len)
+// the nr of lines in buf as split by encode_telegram_buffer: the last line does not need to end with '\n'
+{
+    Py_ssize_t n = 0;
+    const char* p = buf;
+    const char* end = buf + len;
+
+    while (p < end)
+    {
+        p = (const char*)memchr(p, '\n', end - p);
+        n++;
+        if (p == NULL)
+            break;
+        p++;
+    }
+
+    return n;
+}
+
+static PyObject* encode_buffer(PyObject* data, unsigned int max_cpu)
+// converts the lines in a bytes-like object, the buffer is used without copying it
+{
+    Py_buffer input;
+    PyObject *shaped, *deshaped, *errcodes, *sizes;
+    Py_ssize_t n;
+    size_t n_lines;
+    int rc;
+
+    if (PyObject_GetBuffer(data, &input, PyBUF_SIMPLE) != 0)
+        return NULL;
+
+    n = count_lines((const char*)input.buf, input.len);
+    if (!make_result(n, &shaped, &deshaped, &errcodes, &sizes))
+    {
+        PyBuffer_Release(&input);
+        return NULL;
+    }
+
+    // the buffer stays exported during the conversion, so it can not be resized by another thread:
+    Py_BEGIN_ALLOW_THREADS
+    rc = encode_telegram_buffer((const char*)input.buf, (size_t)input.len, max_cpu,
+        (uint8_t*)PyBytes_AS_STRING(shaped), (uint8_t*)PyBytes_AS_STRING(deshaped),
+        (int*)PyBytes_AS_STRING(errcodes), (int*)PyBytes_AS_STRING(sizes), (size_t)n, &n_lines);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&input);
+    return return_result(rc, shaped, deshaped, errcodes, sizes);
+}
+
+static PyObject* encode_sequence(PyObject* data, unsigned int max_cpu)
+// converts the lines in a sequence of str and/or bytes objects, one telegram per item
+{
+    PyObject *items, *item, *shaped, *deshaped, *errcodes, *sizes;
+    vector<const char*> lines;
+    Py_ssize_t i, n;
+    int rc;
+
+    // a new list with references to the items: the caller may change the sequence while the GIL is released
+    items = PySequence_List(data);
+    if (items == NULL)
+        return NULL;
+
+    n = PyList_GET_SIZE(items);
+    lines.resize(n);
+    for (i = 0; i < n; i++)
+    {
+        item = PyList_GET_ITEM(items, i);
+        if (PyUnicode_Check(item))
+            lines[i] = PyUnicode_AsUTF8(item);
+        else if (PyBytes_Check(item))
+            lines[i] = PyBytes_AS_STRING(item);
+        else
+        {
+            PyErr_Format(PyExc_TypeError, "line %zd is not a str or bytes object", i);
+            lines[i] = NULL;
+        }
+
+        if (lines[i] == NULL)
+        {
+            Py_DECREF(items);
+            return NULL;
+        }
+    }
+
+    if (!make_result(n, &shaped, &deshaped, &errcodes, &sizes))
+    {
+        Py_DECREF(items);
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    rc = encode_telegram_lines(lines.data(), (size_t)n, max_cpu,
+        (uint8_t*)PyBytes_AS_STRING(shaped), (uint8_t*)PyBytes_AS_STRING(deshaped),
+        (int*)PyBytes_AS_STRING(errcodes), (int*)PyBytes_AS_STRING(sizes));
+    Py_END_ALLOW_THREADS
+
+    Py_DECREF(items);
+    return return_result(rc, shaped, deshaped, errcodes, sizes);
+}
+
+static PyObject* py_encode(PyObject* self, PyObject* args, PyObject* kwargs)
+// encode(lines, max_cpu=0) -> (shaped, deshaped, errcodes, sizes)
+{
+    static const char* keywords[] = { "lines", "max_cpu", NULL };
+    PyObject* data;
+    unsigned int max_cpu = 0;
+
+    (void)self;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|I", (char**)keywords, &data, &max_cpu))
+        return NULL;
+
+    if (PyObject_CheckBuffer(data))
+        return encode_buffer(data, max_cpu);
+
+    if (PyUnicode_Check(data))
+    {
+        PyErr_SetString(PyExc_TypeError, "lines must be a bytes-like object or a sequence of lines, not str");
+        return NULL;
+    }
+
+    return encode_sequence(data, max_cpu);
+}
+
+static PyObject* py_encode_line(PyObject* self, PyObject* args, PyObject* kwargs)
+// encode_line(line, max_cpu=0) -> (shaped, deshaped, errcode), the telegrams as bytes of their own length
+{
+    static const char* keywords[] = { "line", "max_cpu", NULL };
+    const char* line;
+    Py_ssize_t line_length;
+    unsigned int max_cpu = 0;
+    uint8_t shaped[API_SHAPED_BYTES], deshaped[API_DESHAPED_BYTES];
+    int errcode, size, rc;
+    size_t n_lines;
+
+    (void)self;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s#|I", (char**)keywords, &line, &line_length, &max_cpu))
+        return NULL;
+
+    if (memchr(line, '\n', line_length) != NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "line must not contain '\\n', use encode() for more lines");
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    rc = encode_telegram_buffer(line, (size_t)line_length, max_cpu, shaped, deshaped, &errcode, &size, 1, &n_lines);
+    Py_END_ALLOW_THREADS
+
+    if (rc != 0)
+    {
+        PyErr_Format(PyExc_RuntimeError, "converting the telegram failed with error code %d", rc);
+        return NULL;
+    }
+
+    if (n_lines == 0)
+    // an empty line
+    {
+        errcode = ERR_NO_INPUT;
+        size = 0;
+    }
+
+    return Py_BuildValue("(y#y#i)",
+        (const char*)shaped, (Py_ssize_t)(size > 0 ? (size - 1) / 8 + 1 : 0),
+        (const char*)deshaped, (Py_ssize_t)(size == s_long ? (N_USERBITS_L - 1) / 8 + 1 : (size == s_short ? (N_USERBITS_S - 1) / 8 + 1 : 0)),
+        errcode);
+}
+
+static PyMethodDef module_methods[] =
+{
+    { "encode", (PyCFunction)(void(*)(void))py_encode, METH_VARARGS | METH_KEYWORDS,
+      "encode(lines, max_cpu=0) -> (shaped, deshaped, errcodes, sizes)\n\n"
+      "Converts the lines (a bytes-like object with lines separated by '\\n', or a sequence of str/bytes lines), one telegram per line.\n"
+      "Returns memoryviews: shaped (uint8, n * 128), deshaped (uint8, n * 104), errcodes (int32, n), sizes (int32, n; bits per telegram, 0 if none).\n"
+      "The GIL is released during the conversion. One thread pool with a thread per cpu is shared by all calls, each call uses at most max_cpu of its threads (0 = all)." },
+    { "encode_line", (PyCFunction)(void(*)(void))py_encode_line, METH_VARARGS | METH_KEYWORDS,
+      "encode_line(line, max_cpu=0) -> (shaped, deshaped, errcode)\n\n"
+      "Converts one line, returns the shaped and deshaped telegram as bytes and the error code." },
+    { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef module_def =
+{
+    PyModuleDef_HEAD_INIT,
+    "py_balise_codec",
+    "Shapes, deshapes and checks balise telegrams (ETCS Subset-036).",
+    -1,
+    module_methods,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+PyMODINIT_FUNC PyInit_py_balise_codec(void)
+// creates the module and its constants
+{
+    PyObject* module = PyModule_Create(&module_def);
+
+    if (module == NULL)
+        return NULL;
+
+    PyModule_AddIntConstant(module, "SHAPED_BYTES", API_SHAPED_BYTES);
+    PyModule_AddIntConstant(module, "DESHAPED_BYTES", API_DESHAPED_BYTES);
+    PyModule_AddIntConstant(module, "ERR_NO_INPUT", ERR_NO_INPUT);
+    PyModule_AddIntConstant(module, "ERR_INPUT_ERROR", ERR_INPUT_ERROR);
+
+    return module;
+}
@@ -3,6 +3,64 @@
 #include "python_api.h"
 
 int verbose = VERB_QUIET;
+
+static BS::thread_pool<>& get_pool(void)
+// returns the thread pool of the module, created at the first call with one thread per cpu
+// max_cpu of a call limits the nr of tasks it submits to the pool (see convert_telegrams_in_pool), not the size of the pool
+// the pool is never destroyed: joining its threads while the library is unloaded may hang
+{
+    static BS::thread_pool<>* pool = new BS::thread_pool<>(0);
+
+    return *pool;
+}
+
+static int encode_lines(const vector<string_view>& lines, unsigned int max_cpu, uint8_t* shaped, uint8_t* deshaped, int* errcodes, int* sizes)
+// converts the lines in the pool, writes the results of line i at position i of the arrays (see encode_telegram_lines)
+{
+    telegram_batch t, unique;
+    vector<telegram*> line_telegram(lines.size(), NULL);   // the telegram of each line, NULL if the line is empty
+    vector<unsigned int> source;
+    unsigned int n_duplicates;
+    telegram* p_telegram;
+    size_t i;
+
+    t.reserve(lines.size());
+    for (i = 0; i < lines.size(); i++)
+        if (parse_input_line(lines[i], t))
+            line_telegram[i] = &t.back();
+
+    // shape each user data in the batch only once, the duplicates get a copy of the result at their own position in t:
+    n_duplicates = remove_duplicate_telegrams(t, unique, source);
+    convert_telegrams_in_pool((n_duplicates > 0) ? unique : t, get_pool(), false, 0, max_cpu);
+    if (n_duplicates > 0)
+        restore_duplicate_telegrams(t, unique, source);
+
+    memset(shaped, 0, lines.size() * API_SHAPED_BYTES);
+    memset(deshaped, 0, lines.size() * API_DESHAPED_BYTES);
+
+    for (i = 0; i < lines.size(); i++)
+    {
+        p_telegram = line_telegram[i];
+        sizes[i] = 0;
+
+        if (p_telegram == NULL)
+        {
+            errcodes[i] = ERR_NO_INPUT;
+            continue;
+        }
+
+        errcodes[i] = p_telegram->errcode;
+        if (p_telegram->errcode == ERR_INPUT_ERROR)
+            continue;
+
+        p_telegram->align(a_enc);
+        sizes[i] = p_telegram->size;
+        p_telegram->contents.write_to_array(shaped + i * API_SHAPED_BYTES, (p_telegram->size - 1) / 8 + 1);
+        p_telegram->deshaped_contents.write_to_array(deshaped + i * API_DESHAPED_BYTES, ((int)p_telegram->number_of_userbits - 1) / 8 + 1);
+    }
+
+    return 0;
+}
    
 extern "C" EXPORT   // export this function in the .dll / .so file    
 int encode_telegram_line(const char* input_line,
@@ -16,15 +74,15 @@ int encode_telegram_line(const char* input_line,
         return -1;   // invalid parameters
 
     try {
-        // 1) Parse the input line into a linked list of telegram objects
-        telegram* t = parse_input_line(input_line);
-        if (!t) {
+        // 1) Parse the input line into a batch of telegram objects
+        telegram_batch t;
+        if (!parse_input_line(input_line, t)) {
             // empty line or comment-only line
             return 1;
         }
 
         // 2) Process / encode telegram(s)
-        convert_telegrams_multithreaded(t, max_cpu, calc_all);
+        convert_telegrams_in_pool(t, get_pool(), calc_all, 0, max_cpu);
 
         // 3) Produce the output string
         // format = "hex" → default formatting style of the library
@@ -42,17 +100,78 @@ int encode_telegram_line(const char* input_line,
 
         memcpy(out_buf, out.c_str(), out.size() + 1);
 
-        // 5) Free the linked list of telegrams
-        telegram* p = t;
-        while (p) {
-            telegram* next = p->next;   // next pointer (assumed public)
-            delete p;
-            p = next;
+        return 0;   // success
+    }
+    catch (...) {
+        return -99; // unexpected exception
+    }
+}
+
+extern "C" EXPORT
+int encode_telegram_lines(const char* const* input_lines,
+                          size_t n_lines,
+                          unsigned int max_cpu,
+                          uint8_t* shaped,
+                          uint8_t* deshaped,
+                          int* errcodes,
+                          int* sizes)
+{
+    vector<string_view> lines;
+    size_t i;
+
+    if ((!input_lines && n_lines > 0) || !shaped || !deshaped || !errcodes || !sizes)
+        return -1;   // invalid parameters
+
+    try {
+        lines.reserve(n_lines);
+        for (i = 0; i < n_lines; i++)
+            lines.push_back(input_lines[i] ? string_view(input_lines[i]) : string_view());
+
+        return encode_lines(lines, max_cpu, shaped, deshaped, errcodes, sizes);
+    }
+    catch (...) {
+        return -99; // unexpected exception
+    }
+}
+
+extern "C" EXPORT
+int encode_telegram_buffer(const char* input,
+                           size_t input_size,
+                           unsigned int max_cpu,
+                           uint8_t* shaped,
+                           uint8_t* deshaped,
+                           int* errcodes,
+                           int* sizes,
+                           size_t max_lines,
+                           size_t* n_lines)
+{
+    vector<string_view> lines;
+    string_view contents;
+    size_t start = 0, end;
+
+    if ((!input && input_size > 0) || !shaped || !deshaped || !errcodes || !sizes || !n_lines)
+        return -1;   // invalid parameters
+
+    try {
+        // split the buffer in lines without copying them, the last line does not need to end with '\n':
+        contents = string_view(input, input_size);
+        while (start < contents.length())
+        {
+            end = contents.find('\n', start);
+            if (end == string_view::npos)
+                end = contents.length();
+
+            lines.push_back(contents.substr(start, end - start));
+            start = end + 1;
         }
 
-        return 0;   // success
+        *n_lines = lines.size();
+        if (lines.size() > max_lines)
+            return -2;   // the output arrays are too small
+
+        return encode_lines(lines, max_cpu, shaped, deshaped, errcodes, sizes);
     }
     catch (...) {
         return -99; // unexpected exception
     }
-}
\ No newline at end of file
+}
@@ -6,6 +6,8 @@
 #define EXPORT
 #endif
 
+#define API_SHAPED_BYTES        128     // bytes per telegram in the shaped output array (a short telegram uses the first 43)
+#define API_DESHAPED_BYTES      104     // bytes per telegram in the deshaped output array (a short telegram uses the first 27)
 
 extern "C"
 {
@@ -16,5 +18,33 @@ extern "C"
         char* out_buf,
         size_t out_buf_size);
 
+    // converts n_lines input lines (the format of one line of the input file), one telegram per line.
+    // The results of line i are written to:
+    //   shaped[i*API_SHAPED_BYTES ..]     the shaped telegram, the same bytes as the hex output (zero padded)
+    //   deshaped[i*API_DESHAPED_BYTES ..] the user data, the same bytes as the hex output (zero padded)
+    //   errcodes[i]                       the error code, ERR_NO_INPUT if the line is empty or only contains comments
+    //   sizes[i]                          the nr of bits of the telegram (1023 or 341), 0 if there is no telegram
+    // Uses a thread pool with one thread per cpu that is created at the first call and kept for the next calls.
+    // Each call uses at most max_cpu of its threads (0 = all).
+    EXPORT int encode_telegram_lines(const char* const* input_lines,
+        size_t n_lines,
+        unsigned int max_cpu,
+        uint8_t* shaped,
+        uint8_t* deshaped,
+        int* errcodes,
+        int* sizes);
+
+    // like encode_telegram_lines, for the lines in one buffer of input_size chars, separated by '\n'.
+    // Sets *n_lines to the nr of lines, returns -2 without converting if this is more than max_lines.
+    EXPORT int encode_telegram_buffer(const char* input,
+        size_t input_size,
+        unsigned int max_cpu,
+        uint8_t* shaped,
+        uint8_t* deshaped,
+        int* errcodes,
+        int* sizes,
+        size_t max_lines,
+        size_t* n_lines);
+
     // tbd: add get_version
-}
\ No newline at end of file
+}
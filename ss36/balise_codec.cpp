@@ -12,31 +12,57 @@
 
 #include "balise_codec.h"
 
-string read_from_file(string filename)
-// reads the balise data from filename and returns the information in one long string
+telegram_batch read_telegrams_from_file(const string filename, unsigned int max_cpu)
+// reads the telegrams from filename, using max_cpu cores:
+// the file is mapped into memory and split in chunks of whole lines (see split_lines),
+// the chunks are parsed in place by a thread pool and the telegrams are joined in the order of the file
 {
-    string s;
-
-    // read the file into a string:
-    ifstream f(filename);
-    if (f.is_open())
+    mapped_file file(filename);
+    string_view contents;
+    vector<string_view> chunks;
+    vector<telegram_batch> parts;
+    telegram_batch telegrams;
+    unsigned int i, n_threads, n_chunks;
+    size_t count = 0;
+
+    if (!file.is_open())
     {
-        getline(f, s, '\0');
-        f.close();
-        eprintf(VERB_FLOW, "Read in telegrams from %s\n", filename.c_str());
-        return s;
+        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " reading input file ('%s'): %s. \n", filename.c_str(), strerror(errno));
+        exit(ERR_NO_INPUT);
     }
-    else
-    {
-        const char* errmsg = strerror(errno);
-        //const size_t errmsglen = 100;
-        //char errmsg[errmsglen];
-        //strerror_s(errmsg, errmsglen, errno);
 
-        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " reading input file ('%s'): %s. \n", filename.c_str(), errmsg);
+    contents = file.contents();
+    eprintf(VERB_FLOW, "Read in telegrams from %s (%zu chars)\n", filename.c_str(), contents.length());
 
-        exit(ERR_NO_INPUT);
+    // one chunk per thread would leave threads idle if the lines take different amounts of time, too small chunks cost overhead:
+    n_threads = (max_cpu == 0) ? std::thread::hardware_concurrency() : max_cpu;
+    n_chunks = (n_threads <= 1) ? 1 : (unsigned int)min((size_t)n_threads * PARSE_CHUNKS_PER_THREAD, contents.length() / PARSE_MIN_CHUNK_SIZE + 1);
+
+    if (n_chunks <= 1)
+        return parse_content_string(contents);
+
+    chunks = split_lines(contents, n_chunks);
+    parts.resize(chunks.size());
+
+    BS::thread_pool pool(limit_thread_count(max_cpu, (unsigned int)chunks.size()));
+    eprintf(VERB_FLOW, "Parsing %d chunks of the input file with %d threads.\n", (int)chunks.size(), (int)pool.get_thread_count());
+
+    for (i = 0; i < chunks.size(); i++)
+        pool.detach_task([&parts, &chunks, i] { parts[i] = parse_content_string(chunks[i]); });
+    pool.wait();
+
+    // join the parts in the order of the file, free each part after it was copied:
+    for (telegram_batch& part : parts)
+        count += part.size();
+    telegrams.reserve(count);
+
+    for (telegram_batch& part : parts)
+    {
+        telegrams.insert(telegrams.end(), part.begin(), part.end());
+        telegram_batch().swap(part);
     }
+
+    return telegrams;
 }
 
 void convert_telegram(telegram* p_telegram)  
@@ -102,32 +128,18 @@ void convert_telegram(telegram* p_telegram)
                 // make this a long telegram before shaping it
                 p_telegram->make_userdata_long();
 
-            // shape the telegram:
-            p_telegram->shape_opt();
-
-            if (p_telegram->errcode != ERR_SB_ESB_OVERFLOW)
-            // there was no overflow of SB+ESB, check the telegram:
+            // use the shaped telegram from the cache if it is there, else shape the telegram:
+            if (shape_cache.is_open() && use_cached_telegram(p_telegram))
             {
-                // show check result and the telegram:
-                eprintf(VERB_GLOB, "Created shaped telegram, performing checks:\n");
-
-                p_telegram->errcode = ERR_NO_ERR;  // reset the error code (still set from shaping)
-                p_telegram->check_shaped_deshaped();  // no errors should occur, this is checked in the next line
+                show_created_telegram(p_telegram);     // use_cached_telegram has checked it
+                break;
+            }
 
-                if (p_telegram->errcode != ERR_NO_ERR)
-                    eprintf(VERB_QUIET, ERROR_COLOR "ERROR:" ANSI_COLOR_RESET" Created telegram that does not pass the checks. Err=%d\n", p_telegram->errcode);
+            p_telegram->shape_opt();
+            check_created_telegram(p_telegram);
 
-                // show the output:
-                eprintf(VERB_GLOB, "OUTPUT: Shaped telegram: \n");
-                p_telegram->print_contents_fancy(VERB_GLOB);
-                eprintf(VERB_GLOB, "(hex:) ");
-                p_telegram->align(a_enc);  // shift the bits to the left to prepare for printing
-                p_telegram->contents.print_hex(VERB_GLOB, p_telegram->size);
-                eprintf(VERB_GLOB, "\n");
-            }
-            else
-                eprintf(VERB_ALL, "Skipped checks of overflowed telegram\n");
-            
+            if (shape_cache.is_open() && (p_telegram->errcode == ERR_NO_ERR))
+                store_cached_telegram(p_telegram);
             break;
         }
         default:
@@ -139,313 +151,997 @@ void convert_telegram(telegram* p_telegram)
     }
 }
 
-void telegram_calc_all(telegram* p_start_telegram)
-// converts all possible variants of this p_telegram, inserts them into the linked list of telegrams after p_telegram
+void check_created_telegram(telegram* p_telegram)
+// checks and shows the telegram that was just shaped (if there was no overflow of SB+ESB)
 {
-    int counter = 0;
-    telegram *p_telegram = p_start_telegram, *p_temp_telegram = NULL, *p_prev_telegram = NULL, *p_original_next = p_start_telegram->next;
-    bool cont = true;
+    if (p_telegram->errcode != ERR_SB_ESB_OVERFLOW)
+    // there was no overflow of SB+ESB, check the telegram:
+    {
+        // show check result and the telegram:
+        eprintf(VERB_GLOB, "Created shaped telegram, performing checks:\n");
 
-    // skip this telegram if there is an error in its input
-    if (p_telegram->errcode != ERR_NO_ERR)
-        return;
+        p_telegram->errcode = ERR_NO_ERR;  // reset the error code (still set from shaping)
+        p_telegram->check_shaped_deshaped();  // no errors should occur, this is checked in the next line
 
-    while (cont)
+        if (p_telegram->errcode != ERR_NO_ERR)
+            eprintf(VERB_QUIET, ERROR_COLOR "ERROR:" ANSI_COLOR_RESET" Created telegram that does not pass the checks. Err=%d\n", p_telegram->errcode);
+
+        show_created_telegram(p_telegram);
+    }
+    else
+        eprintf(VERB_ALL, "Skipped checks of overflowed telegram\n");
+}
+
+void show_created_telegram(telegram* p_telegram)
+// shows the telegram that was just shaped or taken from the cache
+{
+    eprintf(VERB_GLOB, "OUTPUT: Shaped telegram: \n");
+    p_telegram->print_contents_fancy(VERB_GLOB);
+    eprintf(VERB_GLOB, "(hex:) ");
+    p_telegram->align(a_enc);  // shift the bits to the left to prepare for printing
+    p_telegram->contents.print_hex(VERB_GLOB, p_telegram->size);
+    eprintf(VERB_GLOB, "\n");
+}
+
+void report_no_valid_sb_esb(telegram* p_telegram)
+// SB+ESB overflowed without finding any correct telegram: show the telegram and quit
+// This should only veeeeery rarely happen: 10^-100 (see subset 36, A1.1.1)
+{
+    eprintf(VERB_QUIET, ERROR_COLOR "\n\nERROR:" ANSI_COLOR_RESET " No valid combination of Scrambling Bits and Extra Shaping Bits found for the telegram below. \n");
+    eprintf(VERB_QUIET, "Please make a minor change in the telegram contents and try again. See Subset-036.\n");
+    eprintf(VERB_QUIET, "Also: please send a copy of the input telegram to the writer of this program (fokke@bronsema.net). Thanks :-)\n");
+    eprintf(VERB_QUIET, "Contents of input telegram: \n");// , telegram->input_string);
+    p_telegram->align(a_enc);  // shift the bits to the left to prepare for printing
+    p_telegram->deshaped_contents.print_hex(VERB_QUIET, p_telegram->number_of_userbits);
+    eprintf(VERB_QUIET, "\n\n");
+
+    exit(ERR_SB_ESB_OVERFLOW);
+}
+
+void telegram_calc_all_word10(const telegram* p_start_telegram, int w10, t_calc_all_part* part)
+// calculates all variants of p_start_telegram of which word10 = w10, in the order of telegram_calc_all, and stores them in part.
+// After the last ESB of a variant the enumeration always continues with a new word10: either w10+1 or, if the SB of that 
+// variant were the last ones with w10, w10+2. In the latter case part->skip_next is set (see merge_calc_all_parts).
+// part->errcode is set if a created telegram does not pass the checks, which ends the enumeration.
+{
+    telegram current(p_start_telegram);
+    longnum_userdata Utick;
+    uint16_t q[SCRAMBLER_MAX_WORDS];    // U' scrambled with S=0, see scrambler.h
+    int n_iter = 0;
+    bool inc_sb = true;
+
+    part->variants.clear();
+    part->errcode = ERR_NO_ERR;
+    part->skip_next = false;
+
+    if (current.force_long)
+        // make this a long telegram before shaping it
+        current.make_userdata_long();
+
+    current.word9 = -1;
+    current.word10 = w10 - 1;   // set_next_sb_esb_opt starts at word10 = w10
+    current.prepare_shaping(Utick, q);
+
+    while (current.search_sb_esb(Utick, q, inc_sb, w10, NULL, &n_iter) == ERR_NO_ERR)
     {
-        convert_telegram(p_telegram);
-        p_telegram->align(a_calc);
-        //eprintf(VERB_GLOB, "i=%d; sb=%d; esb=%d\n", i, p_telegram->get_scrambling_bits(), p_telegram->get_extra_shaping_bits());
-        if (p_telegram->action != act_shape)
-            return;
+        check_created_telegram(&current);
+        current.align(a_calc);
 
-        if (p_telegram->errcode == ERR_NO_ERR) 
-        // calculation went ok, there was no overflow of ESB+SB or other error
-        // make a copy of the current telegram and add it after the current telegram
+        if (current.errcode != ERR_NO_ERR)
         {
-            p_temp_telegram = new telegram(p_telegram);  // new telegram with identical contents as p_telegram
-            if (!p_temp_telegram)
-            {
-                eprintf(VERB_QUIET, "Error allocating memory for a new telegram, quitting.\n");
-                exit(ERR_MEM_ALLOC);
-            }
+            part->errcode = current.errcode;
+            return;
+        }
 
-            if (!p_temp_telegram->set_next_esb_opt())   // increase the ESB
-                // ESB overflowed, set the next SB and set word9 to -1 to trigger the rescrambling with the new SB
-            {
-                p_temp_telegram->set_next_sb_esb_opt(); // small chance on overflow, this will be dealt with when the new telegram is calculated
-                p_temp_telegram->word9 = -1;
-            }
+        // store a copy of the current telegram and continue with the next ESB
+        part->variants.push_back(current);
 
-            // add the new telegram to the end of the list, right after the current telegram:
-            p_telegram->next = p_temp_telegram; // p_temp_telegram->next was already memcopied
-            counter++;
-        }
-        else
-        // an error occurred
+        if (!current.set_next_esb_opt())
+        // ESB overflowed: the next SB are set and the shaping continues at the next word10 (word9 = -1)
         {
-            if (p_telegram->errcode == ERR_SB_ESB_OVERFLOW)
-            // an overflow of SB+ESB occurred (note: error could also be ERR_INPUT_ERROR, but such a telegram will be skipped)
-            {
-                if (counter > 0)
-                // At least one telegram was calculated. Delete the current telegram, set the last next-pointer to the original value and return.
-                {
-                    if (p_prev_telegram)
-                    {
-                        p_prev_telegram->next = p_original_next;
-                        delete p_telegram;
-                        eprintf(VERB_FLOW, "Finished 'calc_all' for telegram at address %p.\n", p_start_telegram);
-                        return;
-                    }
-                }
-                else
-                {
-                // SB+ESB overflowed without finding any correct telegram.
-                // This should only veeeeery rarely happen: 10^-100 (see subset 36, A1.1.1)
-                    eprintf(VERB_QUIET, ERROR_COLOR "\n\nERROR:" ANSI_COLOR_RESET " No valid combination of Scrambling Bits and Extra Shaping Bits found for the telegram below. \n");
-                    eprintf(VERB_QUIET, "Please make a minor change in the telegram contents and try again. See Subset-036.\n");
-                    eprintf(VERB_QUIET, "Also: please send a copy of the input telegram to the writer of this program (fokke@bronsema.net). Thanks :-)\n");
-                    eprintf(VERB_QUIET, "Contents of input telegram: \n");// , telegram->input_string);
-                    p_telegram->align(a_enc);  // shift the bits to the left to prepare for printing
-                    p_telegram->deshaped_contents.print_hex(VERB_QUIET, p_telegram->number_of_userbits);
-                    eprintf(VERB_QUIET, "\n\n");
-
-                    exit(ERR_SB_ESB_OVERFLOW);
-                }
-            }
+            current.set_next_sb_esb_opt();
+            part->skip_next = (current.word10 > w10);
+            return;
         }
 
-        p_prev_telegram = p_telegram;
-        p_telegram = p_telegram->next;
+        inc_sb = false;
     }
 }
 
-void convert_telegrams_multithreaded(telegram * telegrams, unsigned int max_cpu, bool calc_all)
-// Converts the telegrams in the linked list pointed to by *telegrams using max_cpu cores
-// If calc_all, calculate all possible shapes of each input telegram
-// Uses a thread pool for multitasking
-// Shows progress during the calculation
+void merge_calc_all_parts(telegram* p_start_telegram, t_calc_all_part* parts, telegram_batch& variants)
+// appends the variants in the N_TW_001 parts of p_start_telegram (one for each word10) to variants, in the order of word10
+// skips the parts that are not reached in the enumeration, stops at the first error
 {
-    unsigned int telegram_counter = 0, progress_counter = 0, telegram_count = 0, thread_count = 0;
-    telegram* p_telegram = telegrams;
-    void (*func)(telegram*); 
+    int i;
 
-    // count the number of telegrams, determine the action to be performed:
-    while (p_telegram)
+    for (i = 0; i < N_TW_001; i++)
     {
-        if ((p_telegram->contents.get_order() > 0) && (p_telegram->deshaped_contents.get_order() > 0))
-            p_telegram->action = act_check;
+        variants.insert(variants.end(), parts[i].variants.begin(), parts[i].variants.end());
+
+        if (parts[i].errcode != ERR_NO_ERR)
+            return;
+
+        if (parts[i].skip_next)
+            i++;
+    }
+
+    if (variants.size() == 0)
+        report_no_valid_sb_esb(p_start_telegram);
+
+    eprintf(VERB_FLOW, "Finished 'calc_all' for telegram at address %p.\n", p_start_telegram);
+}
+
+void calc_all_part(telegram* p_telegram, int w10, t_calc_all_part* part)
+// the part of calc_all of p_telegram with word10 = w10 (see convert_telegrams_multithreaded), the action must have been set
+// a telegram that is not shaped is converted in place by its first part
+{
+    if (p_telegram->errcode != ERR_NO_ERR)
+        return;
+
+    if (p_telegram->action == act_shape)
+        telegram_calc_all_word10(p_telegram, w10, part);
+    else if (w10 == FIRST_TW_001)
+        convert_telegram(p_telegram);
+}
+
+void telegram_calc_all(telegram* p_start_telegram, telegram_batch& variants)
+// converts all possible variants of p_start_telegram and appends them to variants, starting with the first shape of p_start_telegram
+// variants stays empty if p_start_telegram is not shaped (because of its action or an error in its input); 
+// if it is to be deshaped or checked, this is done in place
+{
+    int w10;
+    vector<t_calc_all_part> parts(N_TW_001);
+
+    // skip this telegram if there is an error in its input
+    if (p_start_telegram->errcode != ERR_NO_ERR)
+        return;
+
+    if (p_start_telegram->action != act_shape)
+    {
+        convert_telegram(p_start_telegram);
+        return;
+    }
+
+    for (w10 = FIRST_TW_001; w10 <= LAST_TW_001; w10++)
+        telegram_calc_all_word10(p_start_telegram, w10, &parts[w10 - FIRST_TW_001]);
+
+    merge_calc_all_parts(p_start_telegram, parts.data(), variants);
+}
+
+void set_telegram_action(telegram* p_telegram)
+// determines the action to be performed on the telegram (shape, deshape or check)
+{
+    if ((p_telegram->contents.get_order() > 0) && (p_telegram->deshaped_contents.get_order() > 0))
+        p_telegram->action = act_check;
+    else
+        if (p_telegram->contents.get_order() > 0)
+            p_telegram->action = act_deshape;
         else
-            if (p_telegram->contents.get_order() > 0)
-                p_telegram->action = act_deshape;
-            else
-                p_telegram->action = act_shape;
+            p_telegram->action = act_shape;
+}
 
-        telegram_count++;
-        p_telegram = p_telegram->next;
+unsigned int remove_duplicate_telegrams(telegram_batch& telegrams, telegram_batch& unique, vector<unsigned int>& source)
+// Moves the telegrams to unique, except the telegrams to be shaped of which the user data, size and force_long are equal to
+// those of an earlier telegram: these only have to be shaped once. source[i] is the index in unique of the result of telegram i.
+// Returns the nr of duplicates; if 0, unique stays empty and the telegrams are not moved.
+{
+    unordered_map<uint64_t, unsigned int> first;    // the hash of the key of a telegram to be shaped -> its index in telegrams
+    vector<t_cache_slot> keys;                      // the keys of the telegrams to be shaped
+    vector<bool> is_duplicate(telegrams.size(), false);
+    unsigned int i, n_duplicates = 0;
+    telegram* p_telegram;
+
+    source.assign(telegrams.size(), 0);
+    keys.resize(telegrams.size());
+
+    for (i = 0; i < telegrams.size(); i++)
+    {
+        p_telegram = &telegrams[i];
+        set_telegram_action(p_telegram);
+        if ((p_telegram->action != act_shape) || (p_telegram->errcode != ERR_NO_ERR))
+            continue;
+
+        get_cache_key(p_telegram, keys[i]);
+        auto found = first.find(keys[i].hash);
+        if (found == first.end())
+            first[keys[i].hash] = i;
+        else if (same_cache_key(keys[found->second], keys[i]))
+        // the same key as an earlier telegram, use its result
+        {
+            source[i] = found->second;
+            is_duplicate[i] = true;
+            n_duplicates++;
+        }
     }
-    
-    // don't start more threads than there are telegrams:
+
+    if (n_duplicates == 0)
+        return 0;
+
+    // move the other telegrams to unique and translate the indices:
+    unique.reserve(telegrams.size() - n_duplicates);
+    for (i = 0; i < telegrams.size(); i++)
+        if (is_duplicate[i])
+            source[i] = source[source[i]];
+        else
+        {
+            source[i] = (unsigned int)unique.size();
+            unique.push_back(std::move(telegrams[i]));
+        }
+
+    return n_duplicates;
+}
+
+void restore_duplicate_telegrams(telegram_batch& telegrams, telegram_batch& unique, const vector<unsigned int>& source)
+// undoes remove_duplicate_telegrams after the conversion of unique: each telegram gets the result of its source in unique
+{
+    vector<bool> is_source(telegrams.size(), false);
+    vector<bool> seen(unique.size(), false);
+    unsigned int i;
+    string input_string;
+
+    // the first telegram that refers to an element of unique is the one that was moved there:
+    for (i = 0; i < telegrams.size(); i++)
+        if (!seen[source[i]])
+        {
+            seen[source[i]] = true;
+            is_source[i] = true;
+        }
+
+    // the duplicates come after their source: copy them (keeping their own input line) before the source is moved back
+    for (i = (unsigned int)telegrams.size(); i-- > 0; )
+        if (is_source[i])
+            telegrams[i] = std::move(unique[source[i]]);
+        else
+        {
+            input_string = std::move(telegrams[i].input_string);
+            telegrams[i] = unique[source[i]];
+            telegrams[i].input_string = std::move(input_string);
+        }
+
+    unique.clear();
+}
+
+unsigned int limit_thread_count(unsigned int max_cpu, unsigned int task_count)
+// returns the nr of threads to be used for task_count tasks: don't start more threads than there are tasks
+{
     if (max_cpu == 0)
     // no max_cpu specified
     {
-        if (telegram_count < std::thread::hardware_concurrency())    
-        // and less telegrams than cpu's
+        if (task_count < std::thread::hardware_concurrency())    
+        // and less tasks than cpu's
         {
-            max_cpu = telegram_count;
+            max_cpu = task_count;
         }
     }
-    else if (telegram_count < max_cpu)
-    // max_cpu specified and less telegrams than max_cpu
-        max_cpu = telegram_count;
-     
-    BS::thread_pool pool(max_cpu);
+    else if (task_count < max_cpu)
+    // max_cpu specified and less tasks than max_cpu
+        max_cpu = task_count;
+
+    return max_cpu;
+}
+
+unsigned int take_chunk(std::atomic<unsigned int>& next, unsigned int count, unsigned int chunk_size, unsigned int n_threads, unsigned int* first)
+// takes the next chunk of telegrams [*first, *first + returned size) from the shared index next, returns 0 if there are none left
+// if chunk_size is 0, the size is adapted to the amount of work left (guided scheduling): large chunks at the start
+// to keep the overhead low, down to single telegrams at the end so no thread waits on a long chunk of a slow thread
+{
+    unsigned int current = next.load(), size;
+
+    do
+    {
+        if (current >= count)
+            return 0;
+
+        size = chunk_size;
+        if (size == 0)
+            size = (count - current) / (CHUNK_GUIDED_FACTOR * n_threads);
+        if (size == 0)
+            size = 1;
+        if (size > count - current)
+            size = count - current;
+    } while (!next.compare_exchange_weak(current, current + size));
+
+    *first = current;
+    return size;
+}
+
+void convert_telegrams_multithreaded(telegram_batch& telegrams, unsigned int max_cpu, bool calc_all, unsigned int chunk_size)
+// Converts the telegrams in the batch using max_cpu cores, in a thread pool that is created for this batch (see convert_telegrams_in_pool)
+{
+    unsigned int work_count = calc_all ? (unsigned int)telegrams.size() * N_TW_001 : (unsigned int)telegrams.size();
+
+    if (work_count == 0)
+        return;
+
+    // don't start more threads than there is work:
+    BS::thread_pool pool(limit_thread_count(max_cpu, work_count));
     eprintf(VERB_FLOW, "Created thread pool with %d threads.\n", (int)pool.get_thread_count());
 
-    // initialise and determine the function needed to perform the calculation: 
-    p_telegram = telegrams;
-    telegram_counter = 0;
+    convert_telegrams_in_pool(telegrams, pool, calc_all, chunk_size);
+}
+
+void merge_thread_counters(void)
+// adds the counters of the shaping search of this thread to the totals (--stats and --check_profile)
+{
+    stats_merge_thread();
+    check_order_merge_thread();
+}
+
+void convert_telegrams_in_pool(telegram_batch& telegrams, BS::thread_pool<>& pool, bool calc_all, unsigned int chunk_size, unsigned int max_tasks)
+// Converts the telegrams in the batch using the threads of pool, which may be shared with other callers
+// If calc_all, calculate all possible shapes of each input telegram; these replace the input telegram in the batch.
+// The work of calc_all is divided in N_TW_001 parts per telegram (one for each word10, see telegram_calc_all_word10), 
+// so the variants of one telegram are calculated by all threads. The parts are merged afterwards in the order of word10.
+// Submits one task per thread, each task takes chunks of work from a shared index until none are left 
+// (see take_chunk; chunk_size = 0 for the adaptive size). max_tasks > 0 limits the nr of tasks, so at most max_tasks threads
+// of a shared pool work on this batch. 
+// Shows progress during the calculation and the idle time of the threads afterwards
+{
+    unsigned int i, telegram_count = (unsigned int)telegrams.size(), n_threads;
+    unsigned int work_count = calc_all ? telegram_count * N_TW_001 : telegram_count;    // nr of telegrams or parts of telegrams
+    vector<t_calc_all_part> parts(calc_all ? work_count : 0);   // the results of calc_all for each part
+    telegram_batch all_telegrams;
+    std::atomic<unsigned int> next_work(0), done_count(0), chunk_count(0);
+    vector<double> busy_time;           // the time each thread spent converting telegrams (seconds)
+    double wall_time, idle_time = 0;
+    std::chrono::steady_clock::time_point start;
+    BS::multi_future<void> tasks;       // only wait for the own tasks, the pool may be shared
+
+    if (telegram_count == 0)
+        return;
+
     if (calc_all)
-        func = telegram_calc_all;
-    else
-        func = convert_telegram;
+    // the parts of one telegram need its action before any of them starts
+        for (telegram& t : telegrams)
+            set_telegram_action(&t);
 
-    while (p_telegram)
-    // add the telegram(s) to the thread pool:
-    {
-        future temp = pool.submit_task([func, p_telegram] {func(p_telegram); });  // throw away the returned future, which is not needed
-        eprintf(VERB_FLOW, "Added telegram #%d at address %p to the pool.\n", ++telegram_counter, p_telegram);
+    // don't start more tasks than there is work, or than the caller allows:
+    n_threads = min((unsigned int)pool.get_thread_count(), work_count);
+    if (max_tasks > 0)
+        n_threads = min(n_threads, max_tasks);
+    busy_time.assign(n_threads, 0);
 
-        p_telegram = p_telegram->next;
-    }
+    start = std::chrono::steady_clock::now();
+
+    for (i = 0; i < n_threads; i++)
+    // start one task per thread, the action of each telegram is determined in the task (if not calc_all):
+        tasks.push_back(pool.submit_task([&, i]
+        {
+            unsigned int first, size, j;
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+            while ((size = take_chunk(next_work, work_count, chunk_size, n_threads, &first)) > 0)
+            {
+                for (j = first; j < first + size; j++)
+                {
+                    if (calc_all)
+                        calc_all_part(&telegrams[j / N_TW_001], FIRST_TW_001 + j % N_TW_001, &parts[j]);
+                    else
+                    {
+                        set_telegram_action(&telegrams[j]);
+                        convert_telegram(&telegrams[j]);
+                    }
+                }
+
+                done_count += size;
+                chunk_count++;
+            }
+
+            busy_time[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            merge_thread_counters();
+        }));
     eprintf(VERB_FLOW, "Waiting for threads to finish.\n");
 
     if (verbose >= VERB_PROG)
     // show progress during calculations, update each PROGRESS_UPDATE_PERIOD msec
     // continue until all telegrams were calculated
-    // tbd: this progress message doesn't seem to work correctly under Linux
-        while (!pool.wait_for(std::chrono::milliseconds(PROGRESS_UPDATE_PERIOD)))
+        while (!tasks.wait_for(std::chrono::milliseconds(PROGRESS_UPDATE_PERIOD)))
         {
-            printf("\rUsing %d thread(s), progress: %d / %d telegrams = %d%%     ",
-                (int)pool.get_thread_count(),
-                telegram_count - (int)pool.get_tasks_total(),
-                telegram_count, (int)(100 * (telegram_count - (int)pool.get_tasks_total()) / telegram_count));
+            printf("\rUsing %d thread(s), progress: %d / %d %s = %d%%     ",
+                n_threads, done_count.load(), work_count, calc_all ? "parts of telegrams" : "telegrams", (int)(100 * done_count.load() / work_count));
         }
     else
     // just wait for the tasks to have ended
-      pool.wait();
+      tasks.wait();
+
+    wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (calc_all)
+    // replace each input telegram by its variants, keep the input telegram if it was not shaped
+    {
+        for (i = 0; i < telegram_count; i++)
+            if ((telegrams[i].action == act_shape) && (telegrams[i].errcode == ERR_NO_ERR))
+                merge_calc_all_parts(&telegrams[i], &parts[i * N_TW_001], all_telegrams);
+            else
+                all_telegrams.push_back(telegrams[i]);
+
+        telegrams.swap(all_telegrams);
+    }
 
     if (verbose >= VERB_PROG)
-    // show some progress output
+    // show some progress output and the time the threads were waiting for work (at the end of the run)
     {
-        if (calc_all)
-        // recount the number of telegrams if "calc_all" was set
+        for (i = 0; i < n_threads; i++)
+            idle_time += wall_time - busy_time[i];
+
+        printf("\rFinished calculating %d telegram(s) using %d thread(s).         \n", (int)telegrams.size(), n_threads);
+        printf("Processed %d chunks (%s), idle time of the threads: %.3f of %.3f thread-secs (%.1f%%).\n", chunk_count.load(),
+            chunk_size ? (to_string(chunk_size) + " telegrams each").c_str() : "adaptive size",
+            idle_time, wall_time * n_threads, (wall_time > 0) ? 100 * idle_time / (wall_time * n_threads) : 0.0);
+    }
+
+    return;
+}
+
+
+void shape_telegram_parallel(telegram* p_telegram, BS::thread_pool<>& pool)
+// shapes one telegram, distributing the search of SB and ESB over the threads in pool. The result is identical to shape_opt:
+// the search space is divided in parts with the same word10 (FIRST_TW_001..LAST_TW_001, which hold the first 8 scrambling bits).
+// Each thread takes the next part and searches it in the same order as shape_opt. The lowest word10 with a solution wins:
+// found_word10 holds the lowest solution so far, parts with a higher word10 are not started or are cancelled.
+{
+    unsigned int i, n_workers = (unsigned int)pool.get_thread_count();
+    int n_iter_total = 0;
+    longnum_userdata Utick;
+    uint16_t q[SCRAMBLER_MAX_WORDS];    // U' scrambled with S=0, see scrambler.h
+    std::atomic<int> next_word10(FIRST_TW_001), found_word10(LAST_TW_001 + 1);
+    vector<telegram> workers;           // a copy of the telegram for each thread
+    vector<int> n_iter(n_workers, 0);
+    telegram* p_winner = NULL;
+
+    p_telegram->prepare_shaping(Utick, q);
+    workers.assign(n_workers, *p_telegram);
+
+    for (i = 0; i < n_workers; i++)
+        pool.detach_task([&, i]
         {
-            p_telegram = telegrams;
-            telegram_count = 0;
-            while (p_telegram)
+            int w10;
+            telegram& worker = workers[i];
+
+            while ((w10 = next_word10.fetch_add(1)) < found_word10.load())
             {
-                p_telegram = p_telegram->next;
-                telegram_count++;
+                worker.word9 = -1;
+                worker.word10 = w10 - 1;    // set_next_sb_esb_opt starts at word10 = w10
+
+                if (worker.search_sb_esb(Utick, q, true, w10, &found_word10, &n_iter[i]) == ERR_NO_ERR)
+                {
+                    // store the lowest word10 with a solution, this thread has no lower parts left:
+                    int current = found_word10.load();
+                    while ((w10 < current) && !found_word10.compare_exchange_weak(current, w10));
+                    merge_thread_counters();
+                    return;
+                }
             }
+
+            worker.word10 = LAST_TW_001 + 1;    // mark this worker as having no solution
+            merge_thread_counters();
+        });
+
+    pool.wait();
+
+    for (i = 0; i < n_workers; i++)
+    {
+        n_iter_total += n_iter[i];
+        if (workers[i].word10 == found_word10.load())
+            p_winner = &workers[i];
+    }
+
+    if (p_winner)
+    // copy the result of the winning thread
+    {
+        p_telegram->contents = p_winner->contents;
+        p_telegram->word9 = p_winner->word9;
+        p_telegram->word10 = p_winner->word10;
+        p_telegram->intermediate = p_winner->intermediate;
+        p_telegram->intermediate_sb = p_winner->intermediate_sb;
+        p_telegram->errcode = p_winner->errcode;     // the result of the last candidate checks, reset by check_created_telegram
+        eprintf(VERB_GLOB, "Shaped the telegram in %d combinations of scrambling bits and extra shaping bits (on %d threads).\n", n_iter_total, n_workers);
+    }
+    else
+    // all SB/ESB tried without a solution (see shape_opt)
+    {
+        p_telegram->word10 = LAST_TW_001 + 1;
+        p_telegram->errcode = ERR_SB_ESB_OVERFLOW;
+        eprintf(VERB_ALL, "Overflow of SB/ESB occurred.\n");
+    }
+}
+
+void convert_telegrams_parallel_search(telegram_batch& telegrams, unsigned int max_cpu)
+// Converts the telegrams in the batch one by one, like convert_telegrams_multithreaded
+// The telegrams to be shaped are shaped using all max_cpu cores for one telegram (see shape_telegram_parallel).
+// This gives the lowest latency for a single telegram or a small number of telegrams.
+{
+    unsigned int telegram_count = (unsigned int)telegrams.size(), telegram_counter = 0;
+    telegram* p_telegram;
+
+    // don't start more threads than there are parts of the search space:
+    BS::thread_pool pool(limit_thread_count(max_cpu, N_TW_001));
+    eprintf(VERB_FLOW, "Created thread pool with %d threads for the search of SB/ESB.\n", (int)pool.get_thread_count());
+
+    for (telegram& t : telegrams)
+    {
+        p_telegram = &t;
+        set_telegram_action(p_telegram);
+
+        if ((p_telegram->action == act_shape) && (p_telegram->errcode == ERR_NO_ERR) && (p_telegram->word9 == -1))
+        {
+            eprintf(VERB_GLOB, "INPUT: Unshaped user data of %d bits:\n", p_telegram->number_of_userbits);
+            p_telegram->deshaped_contents.print_fancy(VERB_GLOB, 8, p_telegram->number_of_userbits, NULL);
+
+            if (p_telegram->force_long)
+                // make this a long telegram before shaping it
+                p_telegram->make_userdata_long();
+
+            shape_telegram_parallel(p_telegram, pool);
+            check_created_telegram(p_telegram);
         }
+        else
+            convert_telegram(p_telegram);
+
+        telegram_counter++;
+        if (verbose >= VERB_PROG)
+            printf("\rUsing %d thread(s), progress: %d / %d telegrams = %d%%     ",
+                (int)pool.get_thread_count(), telegram_counter, telegram_count, (int)(100 * telegram_counter / telegram_count));
+    }
+
+    merge_thread_counters();
 
+    if (verbose >= VERB_PROG)
         printf("\rFinished calculating %d telegram(s) using %d thread(s).         \n", telegram_count, (int)pool.get_thread_count());
+}
+
+void convert_telegrams_single_thread(telegram_batch& telegrams, bool calc_all)
+// Converts the telegrams in the batch one by one in the calling thread
+// If calc_all, calculate all possible shapes of each input telegram; these replace the input telegram in the batch
+{
+    telegram_batch variants, all_telegrams;
+
+    for (telegram& t : telegrams)
+    {
+        set_telegram_action(&t);
+
+        if (!calc_all)
+            convert_telegram(&t);
+        else
+        // replace the telegram by its variants, keep the input telegram if it was not shaped
+        {
+            variants.clear();
+            telegram_calc_all(&t, variants);
+
+            if (variants.size() > 0)
+                all_telegrams.insert(all_telegrams.end(), variants.begin(), variants.end());
+            else
+                all_telegrams.push_back(t);
+        }
     }
 
-    return;
+    if (calc_all)
+        telegrams.swap(all_telegrams);
+
+    merge_thread_counters();
 }
 
+t_stream_result convert_stream_chunk(const string& chunk, const t_stream_param& param)
+// parses, converts and formats the lines in chunk (one task of convert_stream)
+{
+    t_stream_result result;
+    telegram_batch telegrams = parse_content_string(chunk);
+    telegram_batch unique;
+    vector<unsigned int> source;
+    unsigned int n_duplicates = 0;
+
+    if (param.force_long)
+        for (telegram& t : telegrams)
+            t.force_long = true;
+
+    // shape each user data in the chunk only once (calc_all returns all variants of each telegram):
+    if (!param.calc_all)
+        n_duplicates = remove_duplicate_telegrams(telegrams, unique, source);
+
+    convert_telegrams_single_thread((n_duplicates > 0) ? unique : telegrams, param.calc_all);
+
+    if (n_duplicates > 0)
+        restore_duplicate_telegrams(telegrams, unique, source);
+
+    result.telegram_count = (unsigned int)telegrams.size();
+    result.errcode = get_first_error_code(telegrams);
+    result.output = output_telegrams_to_string(telegrams, param.format, param.error_only, false, param.calc_all);
+
+    return result;
+}
+
+int convert_stream(const t_stream_param& param)
+// Converts the telegrams in the file param.input_file and writes the results to param.output_file (stderr if empty, like eprintf), with bounded memory:
+// the input is read in chunks of STREAM_CHUNK_LINES lines, each chunk is parsed, converted and formatted by one task in the thread pool.
+// At most STREAM_PENDING_PER_THREAD chunks per thread are in flight; the oldest one is written as soon as it is ready, 
+// so the output is in the same order as the input.
+// Returns the first error code in the output (see get_first_error_code)
+{
+    int fd = fileno(stderr);    // the output goes to the same stream as eprintf if no output file is given
+    ifstream f(param.input_file);
+    string line, chunk;
+    unsigned int lines_in_chunk = 0, telegram_count = 0, max_pending;
+    int first_errcode = ERR_NO_ERR;
+    deque<future<t_stream_result>> pending;     // the chunks in flight, in the order of the input
+    t_stream_result result;
+
+    if (!f.is_open())
+    {
+        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " reading input file ('%s'): %s. \n", param.input_file.c_str(), strerror(errno));
+        exit(ERR_NO_INPUT);
+    }
+
+    if (param.output_file != "")
+    {
+        fd = open_output_file(param.output_file);
+        eprintf(VERB_FLOW, "Streaming output to file: '%s'.\n", param.output_file.c_str());
+    }
+
+    BS::thread_pool pool(param.max_cpu);
+    max_pending = STREAM_PENDING_PER_THREAD * (unsigned int)pool.get_thread_count();
+    eprintf(VERB_FLOW, "Created thread pool with %d threads, streaming chunks of %d lines.\n", (int)pool.get_thread_count(), STREAM_CHUNK_LINES);
+
+    // write the header (the output of an empty batch):
+    telegram_batch no_telegrams;
+    output_telegrams_to_fd(no_telegrams, param.format, param.error_only, true, param.calc_all, fd);
+
+    while (f.good() || (chunk.length() > 0) || (pending.size() > 0))
+    {
+        if (f.good() && getline(f, line))
+        // add the line to the current chunk
+        {
+            chunk += line;
+            chunk += LINE_DELIM;
+            lines_in_chunk++;
+        }
+
+        if ((lines_in_chunk == STREAM_CHUNK_LINES) || (!f.good() && (chunk.length() > 0)))
+        // the chunk is full or the input ended: hand it to the pool
+        {
+            pending.push_back(pool.submit_task([chunk, &param] { return convert_stream_chunk(chunk, param); }));
+            chunk.clear();
+            lines_in_chunk = 0;
+        }
+
+        if ((pending.size() >= max_pending) || (!f.good() && (chunk.length() == 0) && (pending.size() > 0)))
+        // too many chunks in flight or the input ended: write the oldest chunk when it is ready
+        {
+            result = pending.front().get();
+            pending.pop_front();
+
+            output_string_to_fd(result.output, fd);
+            telegram_count += result.telegram_count;
+            if (first_errcode == ERR_NO_ERR)
+                first_errcode = result.errcode;
+
+            if ((verbose >= VERB_PROG) && (param.output_file != ""))
+                printf("\rUsing %d thread(s), streamed %d telegrams     ", (int)pool.get_thread_count(), telegram_count);
+        }
+    }
+
+    if (param.output_file != "")
+        close_fd(fd);
+
+    if ((verbose >= VERB_PROG) && (param.output_file != ""))
+        printf("\rFinished streaming %d telegram(s) using %d thread(s).         \n", telegram_count, (int)pool.get_thread_count());
+
+    return first_errcode;
+}
 
 // tbd: make a struct out of the parameters?
-string output_telegrams_to_string(telegram* telegramlist, const string format, bool error_only, bool include_header, bool calc_all)
+string output_header(bool calc_all)
+// returns the header line of the output
+{
+    if (calc_all)
+        return string("deshaped") + CSV_SEPARATOR + "shaped" + CSV_SEPARATOR + "errorcode"
+                + CSV_SEPARATOR + "sb" + CSV_SEPARATOR + "esb"
+                + CSV_SEPARATOR + "word9" + CSV_SEPARATOR + "word10\n";
+    else
+        return string("deshaped") + CSV_SEPARATOR + "shaped" + CSV_SEPARATOR + "errorcode\n";
+}
+
+int input_error_separator_count(const telegram* p_telegram)
+// returns the nr of CSV_SEPARATORs to add to the input string of a telegram that was not parsed because of an error in its input,
+// to stick to the output format as much as possible
+{
+    int count = 0, n = 0;
+    size_t i;
+
+    // count the number of CSV_SEPARATORs included in the string:
+    for (i = 0; i < p_telegram->input_string.length(); i++)
+        if (p_telegram->input_string[i] == CSV_SEPARATOR)
+            count++;
+
+    // determine the correct number of CVS_SEPARATORs to be added to the end:
+    if ((count <= 1) || (p_telegram->input_string.back() != CSV_SEPARATOR))
+        n++;
+
+    if (count == 0)
+        n++;
+
+    return n;
+}
+
+size_t output_line_length(telegram* p_telegram, bool hex, bool calc_all)
+// returns the exact nr of chars of the output line of the telegram, including the newline (see write_output_line)
+{
+    size_t length;
+
+    if (p_telegram->errcode == ERR_INPUT_ERROR)
+        return p_telegram->input_string.length() + input_error_separator_count(p_telegram) + decimal_length(ERR_INPUT_ERROR) + 1;
+
+    // the deshaped contents, the shaped contents and the error code, separated by CSV_SEPARATORs:
+    length = HEX_LENGTH(((int)p_telegram->number_of_userbits - 1) / 8 + 1) + 1;
+    length += (hex ? HEX_LENGTH((p_telegram->size - 1) / 8 + 1) : BASE64_LENGTH(p_telegram->size / 8 + 1)) + 1;
+    length += decimal_length(p_telegram->errcode);
+
+    if (calc_all)
+    // the SB, ESB, word9 and word10, each preceded by a CSV_SEPARATOR
+    {
+        p_telegram->align(a_calc);
+        length += 4 + decimal_length(p_telegram->get_scrambling_bits()) + decimal_length(p_telegram->get_extra_shaping_bits())
+                    + decimal_length(p_telegram->word9) + decimal_length(p_telegram->word10);
+    }
+
+    return length + 1;
+}
+
+char* write_output_line(telegram* p_telegram, bool hex, bool calc_all, t_encode_hex* encode_hex, t_encode_base64* encode_base64, char* out)
+// writes the csv-line of the telegram to out, returns out + output_line_length()
+// <decoded hex>;<encoded hex/base64>;errorcode[;sb;esb;word9;word10]\n, or <input>;[;]errorcode\n if the input could not be parsed
+{
+    uint8_t bytes[WORDS_IN_LONGNUM * sizeof(t_word)];
+    int i, n_bytes;
+
+    if (p_telegram->errcode == ERR_INPUT_ERROR)
+    // the telegram was not parsed because of an error in the input data
+    // output the original line, CSV_SEPARATOR(s), error code
+    {
+        memcpy(out, p_telegram->input_string.data(), p_telegram->input_string.length());
+        out += p_telegram->input_string.length();
+
+        for (i = input_error_separator_count(p_telegram); i > 0; i--)
+            *out++ = CSV_SEPARATOR;
+
+        out = encode_decimal(ERR_INPUT_ERROR, out);
+        *out++ = '\n';
+
+        return out;
+    }
+
+    p_telegram->align(a_enc);
+
+    // output the deshaped contents followed by a ;
+    n_bytes = ((int)p_telegram->number_of_userbits - 1) / 8 + 1;
+    p_telegram->deshaped_contents.write_to_array(bytes, n_bytes);
+    out = encode_hex(bytes, n_bytes, out);
+    *out++ = CSV_SEPARATOR;
+
+    // output the shaped contents, depending on format, followed by a ;
+    if (hex)
+    {
+        n_bytes = (p_telegram->size - 1) / 8 + 1;
+        p_telegram->contents.write_to_array(bytes, n_bytes);
+        out = encode_hex(bytes, n_bytes, out);
+    }
+    else
+    {
+        n_bytes = p_telegram->size / 8 + 1;
+        p_telegram->contents.write_to_array(bytes, n_bytes);
+        out = encode_base64(bytes, n_bytes, out);
+    }
+    *out++ = CSV_SEPARATOR;
+
+    // add the error code:
+    out = encode_decimal(p_telegram->errcode, out);
+
+    // add the SB and ESB if calculating all shapings:
+    if (calc_all)
+    {
+        p_telegram->align(a_calc);
+        *out++ = CSV_SEPARATOR;
+        out = encode_decimal(p_telegram->get_scrambling_bits(), out);
+        *out++ = CSV_SEPARATOR;
+        out = encode_decimal(p_telegram->get_extra_shaping_bits(), out);
+        *out++ = CSV_SEPARATOR;
+        out = encode_decimal(p_telegram->word9, out);
+        *out++ = CSV_SEPARATOR;
+        out = encode_decimal(p_telegram->word10, out);
+    }
+
+    *out++ = '\n';
+
+    return out;
+}
+
+string output_telegrams_to_string(telegram_batch& telegrams, const string format, bool error_only, bool include_header, bool calc_all)
 // Returns the telegrams in the same string format in which it is read in:
 // One telegram is written on one line as a line in a csv-file: <decoded hex>;<encoded hex/base64 (param format);errorcode\n
 // Ready to be output to screen, file, returned to python function, ...
 // If error_only, only include the telegrams that have an error
 // If include_header, print a header on the first line
 // if format is "hex", output encoded data as hex. If not, output as base64.
+// The exact size of the output is determined first, the lines are then written into the string without reallocations
 {
-    string output_result = "", line, csv_separators = "";
-    int count, i;
-    telegram* p_telegram = telegramlist;
+    string output_result, header;
+    size_t length;
+    char* out;
+    bool hex = (format == "hex");
+    t_encode_hex* encode_hex = get_encode_hex();
+    t_encode_base64* encode_base64 = get_encode_base64();
 
     eprintf(VERB_FLOW, "Creating the output string.\n");
 
     if (include_header)
-        if (calc_all)
-            output_result = string("deshaped") + CSV_SEPARATOR + "shaped" + CSV_SEPARATOR + "errorcode" 
-                            + CSV_SEPARATOR + "sb" + CSV_SEPARATOR + "esb"
-                            + CSV_SEPARATOR + "word9" + CSV_SEPARATOR + "word10\n";
-        else
-            output_result = string("deshaped") + CSV_SEPARATOR + "shaped" + CSV_SEPARATOR + "errorcode\n";
+        header = output_header(calc_all);
 
-    while (p_telegram)
-    // iterate over telegrams and create a csv-line for each telegram
-    {
-        if (!(error_only && (p_telegram->errcode == ERR_NO_ERR)))
+    // first pass: determine the size of the output
+    length = header.length();
+    for (telegram& t : telegrams)
+        if (!(error_only && (t.errcode == ERR_NO_ERR)))
         // skip this telegram if (only errors should be outputted and telegram has no error)
-        {
-            if (p_telegram->errcode == ERR_INPUT_ERROR)
-            // the telegram was not parsed because of an error in the input data
-            // output the original line, CSV_SEPARATOR(s), error code
-            {
-                // Try to add some CSV_SEPARATORs to stick to the output format as much as possible
-                csv_separators = "";
-                count = 0;
+            length += output_line_length(&t, hex, calc_all);
 
-                // count the number of CSV_SEPARATORs included in the string:
-                for (i = 0; i < p_telegram->input_string.length(); i++)
-                    if (p_telegram->input_string[i] == CSV_SEPARATOR)
-                        count++;
+    // second pass: write the header and the lines
+    output_result.resize(length);
+    out = &output_result[0];
 
-                // determine the correct number of CVS_SEPARATORs and add them to the end (pointed to by i-1):
-                if ( (count <= 1) || (p_telegram->input_string.at((size_t)(i - 1)) != CSV_SEPARATOR) )
-                    csv_separators.push_back(CSV_SEPARATOR);
+    memcpy(out, header.data(), header.length());
+    out += header.length();
 
-                if (count == 0)
-                    csv_separators.push_back(CSV_SEPARATOR);
+    for (telegram& t : telegrams)
+        if (!(error_only && (t.errcode == ERR_NO_ERR)))
+            out = write_output_line(&t, hex, calc_all, encode_hex, encode_base64, out);
 
-                // add the line and the separators to the output result:
-                output_result += p_telegram->input_string + csv_separators + to_string(ERR_INPUT_ERROR) + "\n";
-            }
-            else
-            // output the line to a csv-format
-            {
-                p_telegram->align(a_enc);
+    if (out != output_result.data() + length)
+    {
+        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " creating the output: %d chars written, %d expected.\n", (int)(out - output_result.data()), (int)length);
+        exit(ERR_LOGICAL_ERROR);
+    }
+
+    return output_result;
+}
 
-                // output the deshaped contents followed by a ;
-                p_telegram->deshaped_contents.sprint_hex(line, p_telegram->number_of_userbits);
-                output_result += line;
-                output_result += CSV_SEPARATOR;
+int open_output_file(const string filename)
+// opens the indicated file for writing, returns its file descriptor. Quits if the file can not be opened.
+{
+    int fd = open_output_fd(filename);
 
-                // output the shaped contents, depending on format, followed by a ;
-                if (format == "hex")
-                    p_telegram->contents.sprint_hex(line, p_telegram->size);
-                else
-                    p_telegram->contents.sprint_base64(line, p_telegram->size);
+    if (fd < 0)
+    {
+        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " opening output file %s, quitting. Errtext=%s\n", filename.c_str(), strerror(errno));
+        exit(ERR_OUTPUT_FILE);
+    }
 
-                output_result += line + CSV_SEPARATOR;
+    return fd;
+}
 
-                // add the error code and the newline:
-                output_result += to_string(p_telegram->errcode);
-                
-                // add the SB and ESB if calculating all shapings:
-                if (calc_all)
-                {
-                    p_telegram->align(a_calc);
-                    output_result += CSV_SEPARATOR + to_string(p_telegram->get_scrambling_bits()) + CSV_SEPARATOR +
-                        to_string(p_telegram->get_extra_shaping_bits()) +
-                        CSV_SEPARATOR + to_string(p_telegram->word9) + CSV_SEPARATOR + to_string(p_telegram->word10);
-                }
-                output_result += "\n";
+void output_string_to_fd(const string& output_string, int fd)
+// writes the output to the file descriptor fd. Quits on a write error.
+{
+    if (!write_to_fd(fd, output_string.data(), output_string.length()))
+    {
+        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " writing the output, quitting. Errtext=%s\n", strerror(errno));
+        exit(ERR_OUTPUT_FILE);
+    }
+}
+
+void output_telegrams_to_fd(telegram_batch& telegrams, const string format, bool error_only, bool include_header, bool calc_all, int fd)
+// writes the telegrams to the file descriptor fd, in the format of output_telegrams_to_string, with one write of the whole output
+{
+    output_string_to_fd(output_telegrams_to_string(telegrams, format, error_only, include_header, calc_all), fd);
+}
+
+void output_shape_stats(bool print, const string json_file)
+// prints the counters of the shaping search (if print) and writes them to json_file (if set), see shape_stats.h
+{
+    shape_stats stats = get_shape_stats();
+
+    if (print)
+        print_shape_stats(VERB_QUIET, stats);
+
+    if ((json_file != "") && !write_shape_stats_json(stats, json_file))
+        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " writing the statistics to %s: %s\n", json_file.c_str(), strerror(errno));
+}
+
+int init_check_profile(bool adaptive, const string profile_file)
+// sets the order of the candidate checks: from the profile in profile_file (if it exists), adapted during the conversion if adaptive
+// returns ERR_INPUT_ERROR if the profile file exists but can not be read
+{
+    check_profile profile;
+    FILE* f;
+
+    if (profile_file != "")
+    {
+        f = fopen(profile_file.c_str(), "r");
+        if (f != NULL)
+        {
+            fclose(f);
+            if (!profile.load(profile_file))
+            {
+                eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " in check profile %s\n", profile_file.c_str());
+                return ERR_INPUT_ERROR;
             }
+            eprintf(VERB_FLOW, "Read check profile %s.\n", profile_file.c_str());
         }
-
-        p_telegram = p_telegram->next;
     }
 
-    return output_result;
+    if (adaptive)
+        init_check_order(order_adaptive, profile);
+    else if (profile_file != "")
+        init_check_order(order_profile, profile);
+
+    return ERR_NO_ERR;
 }
 
-void output_telegrams_to_file(const string& output_string, const string filename)
-// writes the output to the indicated file
+void save_check_profile(const string profile_file)
+// writes the loaded check profile plus the statistics of this run to profile_file (if set)
 {
-    FILE* fp = NULL;
+    int is_long, i;
+    t_candidate_check order[N_CANDIDATE_CHECKS];
+    check_profile profile;
+
+    if (profile_file == "")
+        return;
 
-    // open the indicated file:
-    fp = fopen(filename.c_str(), "w");
-    if (!fp)
-    //if (fopen_s(&fp, filename.c_str(), "w"))
+    profile = get_check_profile();
+    if (!profile.save(profile_file))
     {
-        const char* errmsg = strerror(errno);
-        //const size_t errmsglen = 100;
-        //char errmsg[errmsglen];
-        //strerror_s(errmsg, errmsglen, errno);
-        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " opening output file %s, quitting. Errtext=%s\n", filename.c_str(), errmsg);
-        exit(ERR_OUTPUT_FILE);
+        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " writing the check profile to %s: %s\n", profile_file.c_str(), strerror(errno));
+        return;
     }
-    else
+
+    for (is_long = 0; is_long < 2; is_long++)
     {
-        eprintf(VERB_FLOW, "Writing output to file: '%s'.\n", filename.c_str());
-        fputs(output_string.c_str(), fp);
-        fclose(fp);
+        profile.get_order(is_long, order);
+        eprintf(VERB_PROG, "Check order for %s telegrams:", is_long ? "long" : "short");
+        for (i = 0; i < N_CANDIDATE_CHECKS; i++)
+            eprintf(VERB_PROG, " %s", check_name(order[i]));
+        eprintf(VERB_PROG, "\n");
     }
 }
 
-int get_first_error_code(telegram* telegramlist)
-// returns the first error code in the telegram list
+int open_shape_cache(const string cache_file, unsigned int n_slots)
+// opens the cache of shaped telegrams (see result_cache.h), created with n_slots slots if it does not exist yet or is not valid
+// returns ERR_INPUT_ERROR if the file can not be opened, is not a cache file or is in use by another process
 {
-    telegram *p_telegram = telegramlist;
+    if (cache_file == "")
+        return ERR_NO_ERR;
 
-    // iterate over the telegrams and find the first error code != ERR_NO_ERR
-    while (p_telegram)
+    if (!shape_cache.open(cache_file, n_slots, VER_FILEVERSION_STR))
     {
-        if (p_telegram->errcode != ERR_NO_ERR)
-            return p_telegram->errcode;
-
-        p_telegram = p_telegram->next;
+        if (errno == EBUSY)
+            eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " opening the cache %s: it is in use by another process.\n", cache_file.c_str());
+        else if (errno == EEXIST)
+            eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " opening the cache %s: the file exists and is not a cache file.\n", cache_file.c_str());
+        else
+            eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " opening the cache %s: %s\n", cache_file.c_str(), strerror(errno));
+        return ERR_INPUT_ERROR;
     }
 
+    eprintf(VERB_FLOW, "Opened the cache %s.\n", cache_file.c_str());
+    return ERR_NO_ERR;
+}
+
+void close_shape_cache(void)
+// shows the use of the cache of shaped telegrams and closes it
+{
+    if (!shape_cache.is_open())
+        return;
+
+    eprintf(VERB_PROG, "Cache: %llu hit(s), %llu miss(es), %llu invalid.\n", (unsigned long long)shape_cache.hits.load(),
+        (unsigned long long)shape_cache.misses.load(), (unsigned long long)shape_cache.rejected.load());
+    shape_cache.close();
+}
+
+int get_first_error_code(const telegram_batch& telegrams)
+// returns the first error code in the batch of telegrams
+{
+    // iterate over the telegrams and find the first error code != ERR_NO_ERR
+    for (const telegram& t : telegrams)
+        if (t.errcode != ERR_NO_ERR)
+            return t.errcode;
+
     // no error found, return ERR_NO_ERR
     return ERR_NO_ERR;
 }
@@ -16,11 +16,21 @@
 #define MAX_ACTIVE_THREADS 100                  // max amount of threads to spawn. Array size of list of thread handles.
 constexpr char CSV_SEPARATOR = ';';				// separator to be used in output (comma separated values)
 #define PROGRESS_UPDATE_PERIOD 250              // update the progress indicator each PROGRESS_UPDATE_PERIOD msec
+#define CHUNK_GUIDED_FACTOR 4                   // adaptive chunks hold 1/(CHUNK_GUIDED_FACTOR * #threads) of the remaining telegrams
+#define STREAM_CHUNK_LINES 256                  // nr of input lines per task in the streaming mode
+#define STREAM_PENDING_PER_THREAD 4             // max nr of chunks in flight per thread in the streaming mode
+#define PARSE_CHUNKS_PER_THREAD 4               // nr of chunks of the input file per thread when parsing in parallel
+#define PARSE_MIN_CHUNK_SIZE 65536              // min nr of chars in a chunk of the input file when parsing in parallel
 #define VER_FILEVERSION_STR         "9 (December 23rd, 2025)"
  
 //#include "..\version.h"
-#include "parse_input.h"        // parse the input into a structured linked list
+#include "parse_input.h"        // parse the input into a batch of telegrams
 #include "telegram.h"           // subset 36 - related functions
+#include "scrambler.h"          // keystreams used in the parallel search
+#include "text_codec.h"         // hex and base64 output
+#include "mapped_file.h"        // reading the input file without copying it
+#include "shape_stats.h"        // counters of the shaping search (--stats)
+#include "result_cache.h"       // shaped telegrams of earlier runs (--cache)
 #include "useful_functions.h"   // supporting functions
 #include "colors.h"             // pretty colors in the output
 #include <time.h>               // to time the execution
@@ -29,14 +39,71 @@ constexpr char CSV_SEPARATOR = ';';				// separator to be used in output (comma
 #include <errno.h>              // for errno
 #include <string.h>             // for strerror
 #include <future>
+#include <vector>
+#include <deque>
+#include <unordered_map>
 #include "BS_thread_pool.hpp"
 
-string read_from_file(string filename);
+typedef struct
+{
+    string input_file;          // the file to read the telegrams from
+    string output_file;         // the file to write the results to (stderr if empty, like eprintf)
+    string format;              // output format of the shaped telegrams ("hex" or base64)
+    bool error_only;            // only output the telegrams with an error
+    bool calc_all;              // calculate all shapes of each telegram
+    bool force_long;            // force the long format when shaping
+    unsigned int max_cpu;       // max nr of threads (0 = all)
+} t_stream_param;
+
+typedef struct
+{
+    string output;              // the formatted output of the chunk
+    int errcode;                // the first error code in the chunk
+    unsigned int telegram_count;    // nr of telegrams in the output
+} t_stream_result;
+
+typedef struct
+{
+    telegram_batch variants;    // the variants found with one value of word10, in the order of telegram_calc_all
+    int errcode;                // the error code of a created telegram that did not pass the checks (ends the enumeration)
+    bool skip_next;             // true if the enumeration skips the next word10 (see telegram_calc_all_word10)
+} t_calc_all_part;
+
+telegram_batch read_telegrams_from_file(const string filename, unsigned int max_cpu);
 void convert_telegram(telegram* p_telegram);
-void telegram_calc_all(telegram* p_start_telegram);
-void convert_telegrams_multithreaded(telegram* telegrams, unsigned int max_cpu, bool calc_all);
-string output_telegrams_to_string(telegram *telegramlist, const string format, bool error_only, bool include_header, bool calc_all);
-void output_telegrams_to_file(const string& output_string, const string filename);
-int get_first_error_code(telegram *telegramlist);
+void check_created_telegram(telegram* p_telegram);
+void show_created_telegram(telegram* p_telegram);
+void report_no_valid_sb_esb(telegram* p_telegram);
+void telegram_calc_all_word10(const telegram* p_start_telegram, int w10, t_calc_all_part* part);
+void merge_calc_all_parts(telegram* p_start_telegram, t_calc_all_part* parts, telegram_batch& variants);
+void calc_all_part(telegram* p_telegram, int w10, t_calc_all_part* part);
+void telegram_calc_all(telegram* p_start_telegram, telegram_batch& variants);
+void set_telegram_action(telegram* p_telegram);
+unsigned int remove_duplicate_telegrams(telegram_batch& telegrams, telegram_batch& unique, vector<unsigned int>& source);
+void restore_duplicate_telegrams(telegram_batch& telegrams, telegram_batch& unique, const vector<unsigned int>& source);
+unsigned int limit_thread_count(unsigned int max_cpu, unsigned int task_count);
+unsigned int take_chunk(std::atomic<unsigned int>& next, unsigned int count, unsigned int chunk_size, unsigned int n_threads, unsigned int* first);
+void convert_telegrams_multithreaded(telegram_batch& telegrams, unsigned int max_cpu, bool calc_all, unsigned int chunk_size = 0);
+void convert_telegrams_in_pool(telegram_batch& telegrams, BS::thread_pool<>& pool, bool calc_all, unsigned int chunk_size = 0, unsigned int max_tasks = 0);
+void shape_telegram_parallel(telegram* p_telegram, BS::thread_pool<>& pool);
+void convert_telegrams_parallel_search(telegram_batch& telegrams, unsigned int max_cpu);
+void convert_telegrams_single_thread(telegram_batch& telegrams, bool calc_all);
+t_stream_result convert_stream_chunk(const string& chunk, const t_stream_param& param);
+int convert_stream(const t_stream_param& param);
+string output_header(bool calc_all);
+int input_error_separator_count(const telegram* p_telegram);
+size_t output_line_length(telegram* p_telegram, bool hex, bool calc_all);
+char* write_output_line(telegram* p_telegram, bool hex, bool calc_all, t_encode_hex* encode_hex, t_encode_base64* encode_base64, char* out);
+string output_telegrams_to_string(telegram_batch& telegrams, const string format, bool error_only, bool include_header, bool calc_all);
+int open_output_file(const string filename);
+void output_string_to_fd(const string& output_string, int fd);
+void output_telegrams_to_fd(telegram_batch& telegrams, const string format, bool error_only, bool include_header, bool calc_all, int fd);
+void output_shape_stats(bool print, const string json_file);
+void merge_thread_counters(void);
+int init_check_profile(bool adaptive, const string profile_file);
+void save_check_profile(const string profile_file);
+int open_shape_cache(const string cache_file, unsigned int n_slots);
+void close_shape_cache(void);
+int get_first_error_code(const telegram_batch& telegrams);
 
 #endif
\ No newline at end of file
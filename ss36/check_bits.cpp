@@ -0,0 +1,142 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+#include "check_bits.h"
+
+#define REMAINDER_HI_MASK   (((uint64_t)1 << (N_CHECKBITS - 64)) - 1)     // bits 64..84 of the remainder, in [1]
+
+// polynomials for a long telegram (f = 0b11011011111, not used, using fg instead):
+static const t_word g_long[3] = { 0b11010101001000111011101000010011, 0b01110011100110100111101000101110, 0b101110001000 };
+static const t_word fg_long[3] = { 0xC063B091, 0x890C6F72, 0x003EC171 };    // calculated f*g: 0x003EC171 890C6F72 C063B091
+
+// polynomials for a short telegram (f = 0b10110101011, not used, using fg instead):
+static const t_word g_short[3] = { 0b11001010010010100011110001001011, 0b10010000110000101111111011110111, 0b100111110111 };
+static const t_word fg_short[3] = { 0x021B6D65, 0x87757959, 0x002BB94D };   // calculated f*g: 0x002BB94D 87757959 021B6D65
+
+const check_bits_tables check_bits_long(fg_long, g_long);
+const check_bits_tables check_bits_short(fg_short, g_short);
+
+check_bits_tables::check_bits_tables(const t_word* new_fg, const t_word* new_g)
+// generates the tables by multiplying each byte value with x, one bit at a time, reducing modulo f*g at each step
+// the tables are generated once when the library is loaded, which takes a few microseconds
+{
+    int b, k, i, j;
+    uint64_t r0, r1, carry;
+    uint64_t fg0, fg1;
+    uint64_t esb_bit[N_ESB][2];     // (x^(85+j)) mod f*g, the contribution of bit j of the ESB
+
+    for (i = 0; i < 3; i++)
+    {
+        fg[i] = new_fg[i];
+        g[i] = new_g[i];
+    }
+
+    // bits 0..84 of f*g, the x^85 term is shifted out:
+    fg0 = (uint64_t)fg[0] | ((uint64_t)fg[1] << 32);
+    fg1 = fg[2] & REMAINDER_HI_MASK;
+
+    for (b = 0; b < 256; b++)
+    {
+        r0 = b;
+        r1 = 0;
+
+        for (k = 0; k < CHECK_BITS_N_SLICES; k++)
+        {
+            // multiply with x^85 for the first table, with x^8 for the next ones
+            for (i = 0; i < (k == 0 ? N_CHECKBITS : 8); i++)
+            {
+                carry = (r1 >> (N_CHECKBITS - 65)) & 1;
+                r1 = ((r1 << 1) | (r0 >> 63)) & REMAINDER_HI_MASK;
+                r0 <<= 1;
+
+                if (carry)
+                {
+                    r0 ^= fg0;
+                    r1 ^= fg1;
+                }
+            }
+
+            table[k][b][0] = r0;
+            table[k][b][1] = r1;
+        }
+    }
+
+    // the contribution of each ESB bit: the previous bit times x
+    r0 = 0;
+    r1 = (uint64_t)1 << (N_CHECKBITS - 65);     // x^84
+    for (j = 0; j < N_ESB; j++)
+    {
+        carry = (r0 >> 63) & 1;
+        r0 <<= 1;
+        r1 = (r1 << 1) | carry;
+        if ((r1 >> (N_CHECKBITS - 64)) & 1)
+        {
+            r0 ^= fg0;
+            r1 ^= fg1 | ((uint64_t)1 << (N_CHECKBITS - 64));
+        }
+
+        esb_bit[j][0] = r0;
+        esb_bit[j][1] = r1;
+    }
+
+    // combine them into the tables for the low and high half of the ESB
+    for (k = 0; k < 2; k++)
+        for (b = 0; b < (1 << CHECK_BITS_ESB_SPLIT); b++)
+        {
+            esb_table[k][b][0] = 0;
+            esb_table[k][b][1] = 0;
+
+            for (j = 0; j < CHECK_BITS_ESB_SPLIT; j++)
+                if ((b >> j) & 1)
+                {
+                    esb_table[k][b][0] ^= esb_bit[k * CHECK_BITS_ESB_SPLIT + j][0];
+                    esb_table[k][b][1] ^= esb_bit[k * CHECK_BITS_ESB_SPLIT + j][1];
+                }
+        }
+}
+
+void check_bits_tables::feed(t_remainder& r, t_word in32) const
+// feeds the next 32 bits of the telegram into the remainder: r = (r * x^32 + in32) mod f*g
+{
+    int k;
+    const uint64_t* t;
+    t_word top = (t_word)((r[1] << (64 - (N_CHECKBITS - CHECK_BITS_STEP))) | (r[0] >> (N_CHECKBITS - CHECK_BITS_STEP)));    // bits 84..53
+
+    r[1] = ((r[1] << CHECK_BITS_STEP) | (r[0] >> (64 - CHECK_BITS_STEP))) & REMAINDER_HI_MASK;
+    r[0] = (r[0] << CHECK_BITS_STEP) | in32;
+
+    for (k = 0; k < CHECK_BITS_N_SLICES; k++)
+    {
+        t = table[k][(top >> (8 * k)) & 0xFF];
+        r[0] ^= t[0];
+        r[1] ^= t[1];
+    }
+}
+
+void check_bits_tables::add_esb(t_remainder& r, t_esb esb) const
+// adds the contribution of the extra shaping bits to the remainder of a telegram of which the ESB are 0
+{
+    const uint64_t* lo = esb_table[0][esb & ((1 << CHECK_BITS_ESB_SPLIT) - 1)];
+    const uint64_t* hi = esb_table[1][(esb >> CHECK_BITS_ESB_SPLIT) & ((1 << CHECK_BITS_ESB_SPLIT) - 1)];
+
+    r[0] ^= lo[0] ^ hi[0];
+    r[1] ^= lo[1] ^ hi[1];
+}
+
+void check_bits_tables::get_check_bits(const t_remainder& r, longnum_checkbits& check_bits) const
+// adds (=xor) g to the remainder, writes the check bits to bits 0..84 of check_bits
+{
+    check_bits.fill(0);
+    check_bits[0] = (t_word)r[0] ^ g[0];
+    check_bits[1] = (t_word)(r[0] >> 32) ^ g[1];
+    check_bits[2] = (t_word)r[1] ^ g[2];
+}
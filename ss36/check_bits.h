@@ -0,0 +1,61 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * check_bits - table driven (slice-by-4) calculation of the check bits described in subset 36, paragraph 4.3.2.4
+ *
+ * The check bits are the remainder of the telegram (with bits 0..84 cleared) divided by f*g (degree 85), xor-ed with g.
+ * The remainder R is calculated like a CRC, feeding in the telegram 32 bits at a time, starting at the highest word:
+ *      R = (R * x^32 + in32) mod f*g
+ *        = ((R << 32) mod x^85) ^ in32 ^ T0[b0] ^ T1[b1] ^ T2[b2] ^ T3[b3]
+ * with b3..b0 the bytes of the 32 bits of R that are shifted out (bits 84..53) and Tk[b] = (b * x^(85+8k)) mod f*g.
+ * This replaces 32 iterations of the bitwise division (each with a shift and xor of a 1024-bit longnum) by 4 table lookups.
+ *
+ * The division is linear in GF(2), so the remainder of a telegram with extra shaping bits E is the remainder of the same
+ * telegram with E=0, xor-ed with (E * x^85) mod f*g. The contribution of E is looked up in two tables of 5 bits each.
+ * Changing only the ESB therefore costs 2 table lookups instead of a division.
+*/
+
+#ifndef CHECK_BITS_H
+#define CHECK_BITS_H
+
+#include "telegram.h"
+
+#define CHECK_BITS_STEP         32                  // nr of bits processed per step (=one t_word)
+#define CHECK_BITS_N_SLICES     (CHECK_BITS_STEP / 8)   // nr of tables, one for each byte in a step
+#define CHECK_BITS_ESB_WORD     (N_CHECKBITS / BITS_IN_WORD)    // the word that contains the ESB (bits 85..94 are in word 2)
+#define CHECK_BITS_ESB_MASK     (((1 << N_ESB) - 1) << (N_CHECKBITS % BITS_IN_WORD))    // the ESB within that word
+#define CHECK_BITS_ESB_SPLIT    (N_ESB / 2)         // nr of ESB bits per table
+
+typedef uint64_t t_remainder[2];        // remainder of the division by f*g: bits 0..63 in [0], bits 64..84 in [1]
+
+class check_bits_tables
+{
+public:
+    t_word          fg[3];                                  // the polynomial f*g (order 86)
+    t_word          g[3];                                   // the polynomial g, added to the remainder
+    uint64_t        table[CHECK_BITS_N_SLICES][256][2];     // Tk[b] = (b * x^(85+8k)) mod f*g
+    uint64_t        esb_table[2][1 << CHECK_BITS_ESB_SPLIT][2]; // contribution of the low and high half of the ESB: (e * x^(85+5k)) mod f*g
+
+    check_bits_tables(const t_word* new_fg, const t_word* new_g);
+
+    void feed(t_remainder& r, t_word in32) const;
+    void add_esb(t_remainder& r, t_esb esb) const;
+    void get_check_bits(const t_remainder& r, longnum_checkbits& check_bits) const;
+};
+
+// the tables for the polynomials of subset 36, for a long and a short telegram:
+extern const check_bits_tables check_bits_long;
+extern const check_bits_tables check_bits_short;
+
+#endif
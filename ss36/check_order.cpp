@@ -0,0 +1,223 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+#include "check_order.h"
+#include "telegram.h"
+#include <mutex>
+#include <string.h>
+#include <fstream>
+#include <algorithm>
+#include <math.h>
+
+t_check_order_mode check_order_mode = order_canonical;
+
+static const char* check_names[N_CANDIDATE_CHECKS] = { "alphabet", "off_synch", "aperiodicity", "undersampling" };
+static const t_candidate_check canonical_order[N_CANDIDATE_CHECKS] = { check_alphabet, check_off_synch, check_aperiodicity, check_undersampling };
+
+static check_profile initial_profile;       // loaded from the profile file, read-only during the conversion
+static t_candidate_check initial_order[2][N_CANDIDATE_CHECKS];
+static check_profile total_profile;         // initial_profile + the merged statistics of the threads
+static std::mutex total_profile_lock;
+
+class thread_check_state
+// the statistics and order of one thread
+{
+public:
+    check_profile recorded;         // since the last merge
+    check_profile seen;             // since the start of the thread, for the adaptive order
+    t_candidate_check order[2][N_CANDIDATE_CHECKS];
+    uint32_t candidates[2] = { 0, 0 };
+    bool order_set = false;
+};
+
+static thread_local thread_check_state thread_state;
+
+const char* check_name(t_candidate_check check)
+// returns the name of a check, as used in the profile file
+{
+    return check_names[check];
+}
+
+check_profile::check_profile()
+// creates an empty profile
+{
+    clear();
+}
+
+void check_profile::clear(void)
+// sets all statistics to 0
+{
+    memset(stats, 0, sizeof(stats));
+}
+
+void check_profile::add(const check_profile& other)
+// adds the statistics of other
+{
+    int is_long, c;
+
+    for (is_long = 0; is_long < 2; is_long++)
+        for (c = 0; c < N_CANDIDATE_CHECKS; c++)
+        {
+            stats[is_long][c].runs += other.stats[is_long][c].runs;
+            stats[is_long][c].rejects += other.stats[is_long][c].rejects;
+            stats[is_long][c].samples += other.stats[is_long][c].samples;
+            stats[is_long][c].ns += other.stats[is_long][c].ns;
+        }
+}
+
+void check_profile::get_order(int is_long, t_candidate_check* order) const
+// fills order with the checks sorted by their expected cost per rejection, lowest first
+// checks without timing or without rejections go last, in the canonical order
+{
+    double score[N_CANDIDATE_CHECKS];
+    const t_check_stats* s = stats[is_long];
+    int c;
+
+    for (c = 0; c < N_CANDIDATE_CHECKS; c++)
+    {
+        order[c] = canonical_order[c];
+        if ((s[c].samples == 0) || (s[c].rejects == 0))
+            score[c] = HUGE_VAL;
+        else
+            score[c] = ((double)s[c].ns / s[c].samples) / ((double)s[c].rejects / s[c].runs);
+    }
+
+    std::stable_sort(order, order + N_CANDIDATE_CHECKS, [&score](t_candidate_check a, t_candidate_check b) { return score[a] < score[b]; });
+}
+
+bool check_profile::load(const string filename)
+// reads the statistics from filename (see check_order.h), returns false if the file could not be read or has an error
+{
+    ifstream file(filename);
+    string line;
+    char name[32];
+    int size, c;
+    unsigned long long runs, rejects, samples, ns;
+
+    if (!file.is_open())
+        return false;
+
+    while (getline(file, line))
+    {
+        if ((line.length() == 0) || (line[0] == '#'))
+            continue;
+
+        if (sscanf(line.c_str(), "%d;%31[^;];%llu;%llu;%llu;%llu", &size, name, &runs, &rejects, &samples, &ns) != 6)
+            return false;
+
+        for (c = 0; c < N_CANDIDATE_CHECKS; c++)
+            if (strcmp(name, check_names[c]) == 0)
+                break;
+
+        if ((c == N_CANDIDATE_CHECKS) || ((size != s_long) && (size != s_short)))
+            return false;
+
+        stats[size == s_long][c] = { runs, rejects, samples, ns };
+    }
+
+    return true;
+}
+
+bool check_profile::save(const string filename) const
+// writes the statistics to filename (see check_order.h)
+{
+    FILE* f = fopen(filename.c_str(), "w");
+    int is_long, c;
+
+    if (f == NULL)
+        return false;
+
+    fprintf(f, "# balise_codec check profile: size;check;runs;rejects;samples;ns\n");
+    for (is_long = 0; is_long < 2; is_long++)
+        for (c = 0; c < N_CANDIDATE_CHECKS; c++)
+            fprintf(f, "%d;%s;%llu;%llu;%llu;%llu\n", is_long ? s_long : s_short, check_names[c],
+                (unsigned long long)stats[is_long][c].runs, (unsigned long long)stats[is_long][c].rejects,
+                (unsigned long long)stats[is_long][c].samples, (unsigned long long)stats[is_long][c].ns);
+
+    return (fclose(f) == 0);
+}
+
+void init_check_order(t_check_order_mode mode, const check_profile& profile)
+// sets the mode and the profile that the order starts with
+{
+    int is_long;
+
+    check_order_mode = mode;
+    initial_profile = profile;
+    total_profile = profile;
+
+    for (is_long = 0; is_long < 2; is_long++)
+        initial_profile.get_order(is_long, initial_order[is_long]);
+}
+
+bool get_check_order(int is_long, t_candidate_check* order)
+// fills order with the checks in the order of the current mode, returns true if this candidate should be timed
+{
+    thread_check_state& st = thread_state;
+    check_profile current;
+
+    if (!st.order_set)
+    {
+        memcpy(st.order, initial_order, sizeof(initial_order));
+        st.order_set = true;
+    }
+
+    st.candidates[is_long]++;
+    if ((check_order_mode == order_adaptive) && (st.candidates[is_long] % CHECK_ORDER_UPDATE_PERIOD == 0))
+    // recalculate the order of this thread from the initial profile and what it has seen itself
+    {
+        current = initial_profile;
+        current.add(st.seen);
+        current.get_order(is_long, st.order[is_long]);
+    }
+
+    memcpy(order, st.order[is_long], sizeof(st.order[is_long]));
+    return (st.candidates[is_long] % CHECK_ORDER_SAMPLE_PERIOD == 0);
+}
+
+void record_check(int is_long, t_candidate_check check, bool rejected, bool timed, int64_t ns)
+// records a check of a candidate in the statistics of this thread
+{
+    t_check_stats* s;
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        s = (i == 0) ? &thread_state.recorded.stats[is_long][check] : &thread_state.seen.stats[is_long][check];
+        s->runs++;
+        if (rejected)
+            s->rejects++;
+        if (timed)
+        {
+            s->samples++;
+            s->ns += ns;
+        }
+    }
+}
+
+void check_order_merge_thread(void)
+// adds the statistics of this thread to the total and clears them
+{
+    if (check_order_mode == order_canonical)
+        return;
+
+    std::lock_guard<std::mutex> guard(total_profile_lock);
+    total_profile.add(thread_state.recorded);
+    thread_state.recorded.clear();
+}
+
+check_profile get_check_profile(void)
+// returns the loaded profile plus the statistics of all merged threads
+{
+    std::lock_guard<std::mutex> guard(total_profile_lock);
+    return total_profile;
+}
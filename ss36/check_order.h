@@ -0,0 +1,100 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * check_order - the order in which perform_candidate_checks runs the checks of a candidate telegram
+ *
+ * The canonical order of subset 36 (alphabet, off-synch-parsing, aperiodicity, undersampling) is used by default.
+ * With a profile (--check_profile) or adaptive ordering (--adaptive_checks) the checks are ordered by their expected
+ * cost per rejection: (average time of the check) / (fraction of the candidates it rejects), lowest first.
+ * This is the optimal order for independent filters: a candidate is rejected by the cheapest discriminating check.
+ * The statistics are kept per telegram size, as the checks of a long telegram cost and reject differently.
+ *
+ * Each thread counts in its own thread_local statistics: the rejections always, the time of one candidate in
+ * CHECK_ORDER_SAMPLE_PERIOD (the clock is expensive compared to the alphabet check). With adaptive ordering each thread
+ * recalculates its order every CHECK_ORDER_UPDATE_PERIOD candidates, from the loaded profile and its own statistics.
+ *
+ * The order is only used by the search of the ESB (telegram::perform_candidate_checks_ordered), which stops at the first
+ * check that rejects the candidate. The order never changes the result: a candidate passes all checks in any order, and
+ * the search only uses the error and its location to skip ESB after an off-synch-parsing or aperiodicity error in the shaped
+ * user data. The checks before the rejecting one in the canonical order are only run if this skip depends on them.
+ * Checking a given telegram always uses the canonical order and returns the first error in that order.
+ * With the canonical order (the default) the search does not call get_check_order and record_check at all.
+ *
+ * Profile file: one line per size and check: <size>;<check>;<runs>;<rejects>;<samples>;<ns of the samples>
+*/
+
+#ifndef CHECK_ORDER_H
+#define CHECK_ORDER_H
+
+#include <stdint.h>
+#include <string>
+#include <chrono>
+
+using namespace std;
+
+#define CHECK_ORDER_SAMPLE_PERIOD   64      // time one in this many candidates
+#define CHECK_ORDER_UPDATE_PERIOD   4096    // recalculate the adaptive order after this many candidates
+
+enum t_candidate_check { check_alphabet, check_off_synch, check_aperiodicity, check_undersampling, N_CANDIDATE_CHECKS };   // in the canonical order
+enum t_check_order_mode { order_canonical, order_profile, order_adaptive };
+
+typedef struct
+{
+    uint64_t runs;          // nr of candidates checked
+    uint64_t rejects;       // nr of candidates rejected
+    uint64_t samples;       // nr of timed checks
+    uint64_t ns;            // total time of the timed checks
+} t_check_stats;
+
+class check_profile
+{
+public:
+    t_check_stats stats[2][N_CANDIDATE_CHECKS];     // [is_long][check]
+
+    check_profile();
+    void clear(void);
+    void add(const check_profile& other);
+    void get_order(int is_long, t_candidate_check* order) const;
+    bool load(const string filename);
+    bool save(const string filename) const;
+};
+
+extern t_check_order_mode check_order_mode;     // set before the conversion starts
+
+// sets the mode and the profile that the order starts with (and that is used as is with order_profile)
+void init_check_order(t_check_order_mode mode, const check_profile& profile);
+
+// fills order with the checks in the order of the current mode (order_profile or order_adaptive), for a long telegram if is_long.
+// returns true if the time of the checks of this candidate should be recorded.
+bool get_check_order(int is_long, t_candidate_check* order);
+
+// records a check of a candidate, ns is only used if get_check_order asked for timing
+void record_check(int is_long, t_candidate_check check, bool rejected, bool timed, int64_t ns);
+
+// adds the statistics of this thread to the total and clears them
+void check_order_merge_thread(void);
+
+inline int64_t check_order_clock(void)
+// returns the current time in ns, for timing the checks
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// returns the loaded profile plus the statistics of all merged threads
+check_profile get_check_profile(void);
+
+// returns the name of a check, as used in the profile file
+const char* check_name(t_candidate_check check);
+
+#endif
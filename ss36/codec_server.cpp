@@ -0,0 +1,343 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+#include "codec_server.h"
+
+#if defined(_WIN32)
+
+int run_server(const string socket_path, const t_stream_param& param)
+// the server needs Unix domain sockets
+{
+    eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET ": --serve is not available on this platform.\n");
+    return ERR_LOGICAL_ERROR;
+}
+
+int run_client(const string socket_path, const string input_file, const string literal, const string output_file)
+// the client needs Unix domain sockets
+{
+    eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET ": --client is not available on this platform.\n");
+    return ERR_LOGICAL_ERROR;
+}
+
+#else
+
+#include "undersampling.h"
+#include "gf2_clmul.h"
+#include "cpu_features.h"
+#include <sys/socket.h>     // socket, bind, listen, accept, connect, shutdown
+#include <sys/un.h>         // sockaddr_un
+#include <unistd.h>         // read, close, unlink
+#include <sys/stat.h>       // lstat
+#include <signal.h>         // signal
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class connection_queue
+// the tasks of one connection in the order of the requests: filled by the reader, emptied by the writer
+{
+public:
+    std::mutex lock;
+    std::condition_variable changed;
+    deque<future<t_stream_result>> pending;
+    bool input_ended = false;
+};
+
+static char serve_socket_path[sizeof(((struct sockaddr_un*)0)->sun_path)];     // removed when the server is stopped
+
+static void stop_server(int signum)
+// removes the socket and stops the server (signal handler of SIGINT and SIGTERM)
+{
+    (void)signum;
+    unlink(serve_socket_path);
+    _exit(ERR_NO_ERR);
+}
+
+static int create_socket(const string socket_path, struct sockaddr_un* addr)
+// creates a Unix domain socket and fills addr with socket_path. Returns the socket or -1 (see errno).
+{
+    if (socket_path.length() >= sizeof(addr->sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, socket_path.c_str(), socket_path.length());
+
+    return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+static void write_responses(int fd, connection_queue* queue)
+// writes the results of the tasks of the connection in the order of the requests, followed by the trailer with the first error code
+// keeps taking the results after a write error (the client has gone), so the reader is never blocked
+{
+    future<t_stream_result> task;
+    t_stream_result result;
+    int first_errcode = ERR_NO_ERR;
+    bool connected = true;
+    string trailer;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(queue->lock);
+            queue->changed.wait(guard, [queue] { return (queue->pending.size() > 0) || queue->input_ended; });
+
+            if (queue->pending.size() == 0)
+                break;
+
+            task = std::move(queue->pending.front());
+            queue->pending.pop_front();
+        }
+        queue->changed.notify_all();        // there is room for the next task
+
+        result = task.get();
+        if (first_errcode == ERR_NO_ERR)
+            first_errcode = result.errcode;
+
+        if (connected)
+            connected = write_to_fd(fd, result.output.data(), result.output.length());
+    }
+
+    trailer = string(1, SERVE_TRAILER) + to_string(first_errcode) + LINE_DELIM;
+    if (connected)
+        write_to_fd(fd, trailer.data(), trailer.length());
+}
+
+static void submit_request(connection_queue* queue, BS::thread_pool<>& pool, const string& chunk, const t_stream_param& param)
+// hands the lines in chunk to the pool as one task, waits if the connection has too many tasks in flight
+{
+    std::unique_lock<std::mutex> guard(queue->lock);
+
+    queue->changed.wait(guard, [queue] { return queue->pending.size() < SERVE_PENDING_PER_CONNECTION; });
+    queue->pending.push_back(pool.submit_task([chunk, &param] { return convert_stream_chunk(chunk, param); }));
+    queue->changed.notify_all();
+}
+
+static void serve_connection(int fd, BS::thread_pool<>& pool, const t_stream_param& param)
+// reads the requests of one connection until the client closes its side, each block of complete lines is one task
+// a second thread writes the answers as soon as they are ready
+{
+    connection_queue queue;
+    char buf[SERVE_READ_SIZE];
+    string header = output_header(param.calc_all), partial;
+    long long n;
+    size_t last;
+
+    if (!write_to_fd(fd, header.data(), header.length()))
+    {
+        close(fd);
+        return;
+    }
+
+    std::thread writer(write_responses, fd, &queue);
+
+    while (((n = read(fd, buf, sizeof(buf))) > 0) || ((n < 0) && (errno == EINTR)))
+    {
+        if (n <= 0)
+            continue;
+
+        // hand the complete lines to the pool, keep the incomplete last line:
+        partial.append(buf, (size_t)n);
+        last = partial.rfind(LINE_DELIM);
+        if (last == string::npos)
+            continue;
+
+        submit_request(&queue, pool, partial.substr(0, last + 1), param);
+        partial.erase(0, last + 1);
+    }
+
+    // the last line does not need to end with LINE_DELIM:
+    if (partial.length() > 0)
+        submit_request(&queue, pool, partial, param);
+
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.input_ended = true;
+    }
+    queue.changed.notify_all();
+
+    writer.join();
+    close(fd);
+}
+
+int run_server(const string socket_path, const t_stream_param& param)
+// serves the requests on socket_path until the process is stopped (SIGINT or SIGTERM), converts with the parameters in param
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    int listen_fd, fd;
+
+    if ((lstat(socket_path.c_str(), &st) == 0) && !S_ISSOCK(st.st_mode))
+    {
+        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " creating socket %s: the path exists and is not a socket\n", socket_path.c_str());
+        return ERR_SOCKET;
+    }
+
+    listen_fd = create_socket(socket_path, &addr);
+    if (listen_fd >= 0)
+    {
+        unlink(socket_path.c_str());    // remove the socket of a previous server (checked above that it is a socket)
+        if ((bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (listen(listen_fd, SERVE_BACKLOG) != 0))
+        {
+            close(listen_fd);
+            listen_fd = -1;
+        }
+    }
+
+    if (listen_fd < 0)
+    {
+        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " creating socket %s: %s\n", socket_path.c_str(), strerror(errno));
+        return ERR_SOCKET;
+    }
+
+    memcpy(serve_socket_path, addr.sun_path, sizeof(serve_socket_path));
+    signal(SIGINT, stop_server);
+    signal(SIGTERM, stop_server);
+    signal(SIGPIPE, SIG_IGN);           // a client that disconnects gives a write error instead
+
+    // create the pool and the tables that are otherwise created at their first use:
+    BS::thread_pool pool(param.max_cpu);
+    get_cpu_features();
+    get_deinterleave();
+    gf2_get_kernels();
+    get_encode_hex();
+    get_decode_hex();
+    get_decode_base64();
+    get_scrambler_keystreams();
+
+    eprintf(VERB_PROG, "Serving requests on %s with %d threads. Stop with Ctrl-C.\n", socket_path.c_str(), (int)pool.get_thread_count());
+
+    while (true)
+    {
+        fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " accepting a connection on %s: %s\n", socket_path.c_str(), strerror(errno));
+            break;
+        }
+
+        eprintf(VERB_FLOW, "Accepted a connection.\n");
+        std::thread(serve_connection, fd, std::ref(pool), std::cref(param)).detach();
+    }
+
+    // the connections still use the pool, stop the process:
+    close(listen_fd);
+    unlink(serve_socket_path);
+    exit(ERR_SOCKET);
+}
+
+static void send_request(int fd, const string input_file, const string literal)
+// sends the literal or the contents of the input file, then closes the sending side of the connection
+{
+    string_view contents;
+
+    if (literal != "")
+    {
+        write_to_fd(fd, literal.data(), literal.length());
+        write_to_fd(fd, "\n", 1);
+    }
+    else
+    {
+        mapped_file file(input_file);
+        contents = file.contents();
+        write_to_fd(fd, contents.data(), contents.length());
+    }
+
+    shutdown(fd, SHUT_WR);
+}
+
+int run_client(const string socket_path, const string input_file, const string literal, const string output_file)
+// sends the request to the server on socket_path and writes the answer without the trailer line to output_file (stderr if empty)
+// the request is sent by a second thread, so a large input and a large answer can not block each other
+{
+    struct sockaddr_un addr;
+    int fd, out_fd = fileno(stderr), errcode;
+    char buf[SERVE_READ_SIZE];
+    string answer;
+    long long n;
+    size_t last, previous;
+
+    if (literal == "")
+    {
+        if (input_file == "")
+        {
+            eprintf(VERB_QUIET, ERROR_COLOR "ERROR: No input specified, quitting.\n" ANSI_COLOR_RESET);
+            return ERR_NO_INPUT;
+        }
+
+        if (!mapped_file(input_file).is_open())
+        {
+            eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " reading input file ('%s'): %s. \n", input_file.c_str(), strerror(errno));
+            return ERR_NO_INPUT;
+        }
+    }
+
+    fd = create_socket(socket_path, &addr);
+    if ((fd < 0) || (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0))
+    {
+        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET " connecting to the server on %s: %s\n", socket_path.c_str(), strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return ERR_SOCKET;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    if (output_file != "")
+        out_fd = open_output_file(output_file);
+
+    std::thread sender(send_request, fd, input_file, literal);
+
+    while (((n = read(fd, buf, sizeof(buf))) > 0) || ((n < 0) && (errno == EINTR)))
+    {
+        if (n <= 0)
+            continue;
+
+        // write the complete lines, except the last one: this may be the trailer
+        answer.append(buf, (size_t)n);
+        last = answer.rfind(LINE_DELIM);
+        if ((last == string::npos) || (last == 0))
+            continue;
+
+        previous = answer.rfind(LINE_DELIM, last - 1);
+        if (previous == string::npos)
+            continue;
+
+        output_string_to_fd(answer.substr(0, previous + 1), out_fd);
+        answer.erase(0, previous + 1);
+    }
+
+    sender.join();
+    close(fd);
+
+    if ((answer.length() > 0) && (answer[0] == SERVE_TRAILER))
+        errcode = atoi(answer.c_str() + 1);
+    else
+    // the server stopped before the end of the answer
+    {
+        output_string_to_fd(answer, out_fd);
+        eprintf(VERB_QUIET, ERROR_COLOR "Error" ANSI_COLOR_RESET ": the server on %s closed the connection before the end of the answer.\n", socket_path.c_str());
+        errcode = ERR_LOGICAL_ERROR;
+    }
+
+    if (output_file != "")
+        close_fd(out_fd);
+
+    return errcode;
+}
+
+#endif
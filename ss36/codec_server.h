@@ -0,0 +1,51 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * codec_server - persistent server that converts telegrams for clients over a Unix domain socket (--serve / --client)
+ *
+ * The server creates the thread pool and the tables once, and then accepts connections on the socket.
+ * Protocol: the client sends lines in the format of the input file, separated by '\n', and closes its side of the connection
+ * (shutdown) after the last line. The server answers with:
+ *  - the header line of the output (see output_header)
+ *  - the output lines of the requests, in the order of the requests
+ *  - a trailer line "#<error code>", the first error code in the output (see get_first_error_code), after which it closes the connection
+ * The requests are pipelined: each block of lines that is read from a connection is one task in the shared thread pool (see
+ * convert_stream_chunk), so the lines of one connection and the lines of different connections are converted at the same time.
+ * The conversion parameters (format, calc_all, ...) are the ones the server was started with.
+ *
+ * The client sends the literal (-s) or the input file (-i), writes the answer without the trailer line to the output
+ * (like a normal run) and returns the error code of the trailer. So it can replace a normal run in scripts.
+ *
+ * Only available on POSIX systems.
+*/
+
+#ifndef CODEC_SERVER_H
+#define CODEC_SERVER_H
+
+#include "balise_codec.h"
+
+#define SERVE_BACKLOG                   64      // nr of connections that wait to be accepted
+#define SERVE_READ_SIZE                 65536   // nr of chars read from a connection at once (one task)
+#define SERVE_PENDING_PER_CONNECTION    16      // max nr of tasks in flight per connection
+#define SERVE_TRAILER                   '#'     // first char of the trailer line with the error code
+
+// serves the requests on socket_path until the process is stopped, converts with the parameters in param
+// returns ERR_SOCKET if the socket could not be created
+int run_server(const string socket_path, const t_stream_param& param);
+
+// sends the literal (or the contents of input_file if literal is empty) to the server on socket_path,
+// writes the answer to output_file (stderr if empty). Returns the error code sent by the server, ERR_SOCKET if it can not be reached.
+int run_client(const string socket_path, const string input_file, const string literal, const string output_file);
+
+#endif
@@ -0,0 +1,76 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+#include "cpu_features.h"
+
+#if defined(SS36_X64) && defined(_MSC_VER)
+#include <intrin.h>             // __cpuid
+#endif
+
+#if defined(SS36_ARM64) && defined(__linux__)
+#include <sys/auxv.h>           // getauxval
+#include <asm/hwcap.h>          // HWCAP_PMULL
+#endif
+
+#if defined(SS36_ARM64) && defined(_WIN32)
+#include <windows.h>            // IsProcessorFeaturePresent
+#endif
+
+static t_cpu_features detect_cpu_features(void)
+// queries the cpu for the optional instructions
+{
+    t_cpu_features features = { false, false, false, false };
+
+#if defined(SS36_X64)
+#if defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    features.pclmul = (info[2] & (1 << 1)) != 0;    // CPUID.01H:ECX.PCLMULQDQ[bit 1]
+    features.ssse3 = (info[2] & (1 << 9)) != 0;     // CPUID.01H:ECX.SSSE3[bit 9]
+
+    if (max_leaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        features.bmi2 = (info[1] & (1 << 8)) != 0;  // CPUID.(EAX=07H, ECX=0H):EBX.BMI2[bit 8]
+    }
+#else
+    __builtin_cpu_init();
+    features.pclmul = __builtin_cpu_supports("pclmul");
+    features.bmi2 = __builtin_cpu_supports("bmi2");
+    features.ssse3 = __builtin_cpu_supports("ssse3");
+#endif
+#endif
+
+#if defined(SS36_ARM64)
+#if defined(__linux__)
+    features.pmull = (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+#elif defined(_WIN32)
+    features.pmull = IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != 0;
+#elif defined(__APPLE__)
+    features.pmull = true;      // all Apple ARM cpu's have the crypto extension
+#endif
+#endif
+
+    return features;
+}
+
+const t_cpu_features& get_cpu_features(void)
+// returns the features of the cpu this program is running on. Detected once, at the first call (thread safe).
+{
+    static const t_cpu_features features = detect_cpu_features();
+
+    return features;
+}
@@ -0,0 +1,44 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * cpu_features - runtime detection of the optional instructions used by the ss36 library
+ *
+ * The library is compiled for the baseline instruction set of the platform (x64 or ARMv8). Kernels that need
+ * additional instructions are compiled in separate files (see CMakeLists.txt) and are only called if the
+ * instructions are reported as available by the functions below.
+*/
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SS36_X64                        // compiling for x64
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define SS36_ARM64                      // compiling for 64-bit ARM
+#endif
+
+typedef struct
+{
+    bool pclmul;        // x64: carry-less multiplication (PCLMULQDQ)
+    bool bmi2;          // x64: bit manipulation instructions 2 (PEXT)
+    bool ssse3;         // x64: supplemental SSE3 (PSHUFB)
+    bool pmull;         // ARM: 64-bit polynomial multiplication (PMULL, part of the crypto extension)
+} t_cpu_features;
+
+// returns the features of the cpu this program is running on. Detected once, at the first call.
+const t_cpu_features& get_cpu_features(void);
+
+#endif
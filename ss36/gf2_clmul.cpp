@@ -0,0 +1,107 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+#include "gf2_kernels.h"
+#include "cpu_features.h"
+
+static inline void clmul64_portable(uint64_t a, uint64_t b, uint64_t* lo, uint64_t* hi)
+// 64x64->128 bit carry-less multiplication, shift-and-xor without branches
+{
+    int i;
+    uint64_t mask, l = a & (0 - (b & 1)), h = 0;
+
+    for (i = 1; i < 64; i++)
+    {
+        mask = 0 - ((b >> i) & 1);
+        l ^= (a << i) & mask;
+        h ^= (a >> (64 - i)) & mask;
+    }
+
+    *lo = l;
+    *hi = h;
+}
+
+const t_gf2_kernels gf2_kernels_portable = { "portable", gf2_multiply_kernel<clmul64_portable>, gf2_divide_kernel<clmul64_portable> };
+
+gf2_barrett::gf2_barrett(const uint64_t* new_p)
+// pre-calculates mu = floor(x^(d+64) / P) with a bitwise long division. P shall have 1 <= degree <= GF2_BARRETT_MAX_DEGREE.
+{
+    int i, s;
+    uint64_t rem[3] = { 0, 0, 0 };      // x^(d+64) needs at most 192 bits
+    uint64_t sp[3];
+
+    p[0] = new_p[0];
+    p[1] = new_p[1];
+
+    // find the degree of P
+    for (d = GF2_BARRETT_MAX_DEGREE; d > 0; d--)
+        if ((p[d / 64] >> (d % 64)) & 1)
+            break;
+
+    mu = 0;
+    rem[(d + 64) / 64] = (uint64_t)1 << ((d + 64) % 64);
+
+    for (i = d + 64; i >= d; i--)
+    // iterate over the bits of the dividend, from high to low
+    {
+        if (((rem[i / 64] >> (i % 64)) & 1) == 0)
+            continue;
+
+        // rem ^= P << s, with s = i - d in 0..64
+        s = i - d;
+        if (s == 0)
+        {
+            sp[0] = p[0];
+            sp[1] = p[1];
+            sp[2] = 0;
+        }
+        else if (s == 64)
+        {
+            sp[0] = 0;
+            sp[1] = p[0];
+            sp[2] = p[1];
+        }
+        else
+        {
+            sp[0] = p[0] << s;
+            sp[1] = (p[1] << s) | (p[0] >> (64 - s));
+            sp[2] = p[1] >> (64 - s);
+        }
+
+        rem[0] ^= sp[0];
+        rem[1] ^= sp[1];
+        rem[2] ^= sp[2];
+
+        // the quotient bit x^64 is always set and implicit, only the lower 64 bits are stored:
+        if (s < 64)
+            mu |= (uint64_t)1 << s;
+    }
+}
+
+const t_gf2_kernels* gf2_get_hw_kernels(void)
+// returns the hardware backend if the cpu supports one, NULL if not
+{
+    static const t_gf2_kernels* hw_kernels =
+        (gf2_kernels_pclmul != NULL && get_cpu_features().pclmul) ? gf2_kernels_pclmul :
+        (gf2_kernels_pmull != NULL && get_cpu_features().pmull) ? gf2_kernels_pmull :
+        NULL;
+
+    return hw_kernels;
+}
+
+const t_gf2_kernels* gf2_get_kernels(void)
+// returns the fastest backend that the cpu supports
+{
+    static const t_gf2_kernels* kernels = (gf2_get_hw_kernels() != NULL) ? gf2_get_hw_kernels() : &gf2_kernels_portable;
+
+    return kernels;
+}
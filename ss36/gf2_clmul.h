@@ -0,0 +1,72 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * gf2_clmul - GF(2) polynomial arithmetic on arrays of 64-bit limbs, using carry-less multiplication
+ *
+ * A polynomial is stored as an array of uint64_t, limb 0 holds the coefficients of x^0..x^63.
+ * The kernels use one 64x64->128 bit carry-less multiplication as building block. It is implemented with:
+ * - PCLMULQDQ on x64 (gf2_clmul_x86.cpp)
+ * - PMULL on ARMv8 with the crypto extension (gf2_clmul_arm.cpp)
+ * - a portable shift-and-xor loop (gf2_clmul.cpp)
+ * The backend is selected at runtime, based on get_cpu_features().
+ *
+ * Division by a polynomial P of degree d (1 <= d <= 127) is done with Barrett reduction, 64 bits per step:
+ *      mu = floor(x^(d+64) / P)                         (pre-calculated once per P, see class gf2_barrett)
+ *      T  = floor(A / x^d)                              (A = current remainder * x^64 + next limb, so T has 64 bits)
+ *      q  = floor(T * mu / x^64) = T ^ hi64(T * mu')    (mu = x^64 + mu', the x^64 term is implicit)
+ *      A  = A ^ q * P                                   (new remainder, degree < d)
+ * In GF(2) there are no carries, so q is exact and no correction steps are needed.
+*/
+
+#ifndef GF2_CLMUL_H
+#define GF2_CLMUL_H
+
+#include <stdint.h>
+
+#define GF2_BARRETT_MAX_DEGREE 127      // max degree of the divisor P in the Barrett reduction (remainder fits in 2 limbs)
+
+class gf2_barrett
+// the pre-calculated constants for the reduction modulo P
+{
+public:
+    uint64_t    p[2];           // the divisor P
+    int         d;              // degree of P
+    uint64_t    mu;             // lower 64 bits of floor(x^(d+64) / P)
+
+    gf2_barrett(const uint64_t* new_p);
+};
+
+typedef struct
+// one backend: a set of kernels that use the same carry-less multiplication
+{
+    const char* name;
+
+    // r = a * b, truncated to n limbs (a, b and r have n limbs, r may not overlap a or b)
+    void (*multiply)(const uint64_t* a, const uint64_t* b, uint64_t* r, int n);
+
+    // divides num (n limbs) by P: fills quotient (n limbs, may be NULL) and remainder (2 limbs)
+    void (*divide)(const gf2_barrett& b, const uint64_t* num, int n, uint64_t* quotient, uint64_t* remainder);
+} t_gf2_kernels;
+
+extern const t_gf2_kernels gf2_kernels_portable;        // always available
+extern const t_gf2_kernels* const gf2_kernels_pclmul;   // NULL if not compiled for x64
+extern const t_gf2_kernels* const gf2_kernels_pmull;    // NULL if not compiled for ARM64
+
+// returns the hardware backend if the cpu supports one, NULL if not
+const t_gf2_kernels* gf2_get_hw_kernels(void);
+
+// returns the fastest backend that the cpu supports
+const t_gf2_kernels* gf2_get_kernels(void);
+
+#endif
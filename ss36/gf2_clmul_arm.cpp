@@ -0,0 +1,38 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+// The PMULL backend of gf2_clmul.h. Compiled with +crypto (see CMakeLists.txt), only called if get_cpu_features().pmull.
+
+#include "gf2_kernels.h"
+#include "cpu_features.h"
+
+#if defined(SS36_ARM64) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES) || defined(_MSC_VER))
+
+#include <arm_neon.h>       // vmull_p64
+
+static inline void clmul64_pmull(uint64_t a, uint64_t b, uint64_t* lo, uint64_t* hi)
+// 64x64->128 bit carry-less multiplication with one PMULL
+{
+    uint64x2_t r = vreinterpretq_u64_p128(vmull_p64((poly64_t)a, (poly64_t)b));
+
+    *lo = vgetq_lane_u64(r, 0);
+    *hi = vgetq_lane_u64(r, 1);
+}
+
+static const t_gf2_kernels kernels_pmull = { "pmull", gf2_multiply_kernel<clmul64_pmull>, gf2_divide_kernel<clmul64_pmull> };
+const t_gf2_kernels* const gf2_kernels_pmull = &kernels_pmull;
+
+#else
+
+const t_gf2_kernels* const gf2_kernels_pmull = NULL;
+
+#endif
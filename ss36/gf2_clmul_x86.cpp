@@ -0,0 +1,38 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+// The PCLMULQDQ backend of gf2_clmul.h. Compiled with -mpclmul (see CMakeLists.txt), only called if get_cpu_features().pclmul.
+
+#include "gf2_kernels.h"
+#include "cpu_features.h"
+
+#if defined(SS36_X64) && (defined(__PCLMUL__) || defined(_MSC_VER))
+
+#include <wmmintrin.h>      // _mm_clmulepi64_si128
+
+static inline void clmul64_pclmul(uint64_t a, uint64_t b, uint64_t* lo, uint64_t* hi)
+// 64x64->128 bit carry-less multiplication with one PCLMULQDQ
+{
+    __m128i r = _mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)a), _mm_cvtsi64_si128((long long)b), 0x00);
+
+    *lo = (uint64_t)_mm_cvtsi128_si64(r);
+    *hi = (uint64_t)_mm_cvtsi128_si64(_mm_srli_si128(r, 8));
+}
+
+static const t_gf2_kernels kernels_pclmul = { "pclmul", gf2_multiply_kernel<clmul64_pclmul>, gf2_divide_kernel<clmul64_pclmul> };
+const t_gf2_kernels* const gf2_kernels_pclmul = &kernels_pclmul;
+
+#else
+
+const t_gf2_kernels* const gf2_kernels_pclmul = NULL;
+
+#endif
@@ -0,0 +1,100 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * gf2_kernels - the algorithms of gf2_clmul.h, templated on the 64x64 bit carry-less multiplication CLMUL
+ *
+ * Only to be included by the backend files. Each backend file is compiled with its own instruction set,
+ * so all functions here are static: every backend gets its own copy, the linker can not mix them up.
+*/
+
+#ifndef GF2_KERNELS_H
+#define GF2_KERNELS_H
+
+#include "gf2_clmul.h"
+#include <string.h>
+
+typedef void t_clmul64(uint64_t a, uint64_t b, uint64_t* lo, uint64_t* hi);
+
+template <t_clmul64 CLMUL>
+static void gf2_multiply_kernel(const uint64_t* a, const uint64_t* b, uint64_t* r, int n)
+// schoolbook multiplication of the limbs, truncated to n limbs
+{
+    int i, j;
+    uint64_t lo, hi;
+
+    memset(r, 0, n * sizeof(uint64_t));
+
+    for (i = 0; i < n; i++)
+    {
+        if (a[i] == 0)
+            continue;
+
+        for (j = 0; i + j < n; j++)
+        {
+            CLMUL(a[i], b[j], &lo, &hi);
+            r[i + j] ^= lo;
+            if (i + j + 1 < n)
+                r[i + j + 1] ^= hi;
+        }
+    }
+}
+
+template <t_clmul64 CLMUL>
+static void gf2_divide_kernel(const gf2_barrett& b, const uint64_t* num, int n, uint64_t* quotient, uint64_t* remainder)
+// Barrett reduction of num, one limb per step starting at the most significant limb (see gf2_clmul.h)
+{
+    int k, d = b.d;
+    uint64_t r0 = 0, r1 = 0;        // remainder so far (degree < d)
+    uint64_t a0, t, q, lo, hi, lo2, hi2;
+
+    for (k = n - 1; k >= 0; k--)
+    {
+        // A = (r1:r0:a0), T = bits d..d+63 of A
+        a0 = num[k];
+        if (d < 64)
+            t = (a0 >> d) | (r0 << (64 - d));
+        else if (d == 64)
+            t = r0;
+        else
+            t = (r0 >> (d - 64)) | (r1 << (128 - d));
+
+        CLMUL(t, b.mu, &lo, &hi);
+        q = t ^ hi;
+
+        // remainder = (A ^ q*P) mod x^d, only the lower 2 limbs of q*P are needed:
+        CLMUL(q, b.p[0], &lo, &hi);
+        CLMUL(q, b.p[1], &lo2, &hi2);
+
+        if (d <= 64)
+        {
+            r0 = a0 ^ lo;
+            if (d < 64)
+                r0 &= ((uint64_t)1 << d) - 1;
+            r1 = 0;
+        }
+        else
+        {
+            r1 = (r0 ^ hi ^ lo2) & (((uint64_t)1 << (d - 64)) - 1);
+            r0 = a0 ^ lo;
+        }
+
+        if (quotient != NULL)
+            quotient[k] = q;
+    }
+
+    remainder[0] = r0;
+    remainder[1] = r1;
+}
+
+#endif
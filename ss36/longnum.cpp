@@ -12,13 +12,15 @@
 
 #include "longnum.h"
 
-longnum::longnum(int with)
+template <int N_BITS>
+longnum_t<N_BITS>::longnum_t(int with)
 // constructor, initialise value
 {
     fill(with);
 }
 
-longnum::longnum(t_word* init_val, int count)   
+template <int N_BITS>
+longnum_t<N_BITS>::longnum_t(t_word* init_val, int count)   
 // constructor, fills with indicated values
 {
     int i;
@@ -27,15 +29,17 @@ longnum::longnum(t_word* init_val, int count)
         value[i] = init_val[i];
 }
 
-longnum longnum::operator << (int count) const
+template <int N_BITS>
+longnum_t<N_BITS> longnum_t<N_BITS>::operator << (int count) const
 // shift left << operator overload
 {
-    longnum result = *this;
+    longnum_t result = *this;
     result <<= count;
     return result;
 }
 
-longnum& longnum::operator <<= (int count) 
+template <int N_BITS>
+longnum_t<N_BITS>& longnum_t<N_BITS>::operator <<= (int count) 
 // shifts the bits in longnum left with count bits, returns the result by reference
 // if count >= #bits, longnum = 0 
 // if count <= 0, do nothing
@@ -45,7 +49,7 @@ longnum& longnum::operator <<= (int count)
     if (count <= 0)
         return *this;
 
-    if (count >= BITS_IN_LONGNUM)
+    if (count >= BITS)
     //  fill with 0's if all bits are shifted out
     {
         fill(0);
@@ -57,7 +61,7 @@ longnum& longnum::operator <<= (int count)
 
     if (wordshift > 0)
         // first shift whole words:
-        for (i = WORDS_IN_LONGNUM - 1; i >= 0; i--)
+        for (i = WORDS - 1; i >= 0; i--)
             if (i >= wordshift)
                 value[i] = value[i - wordshift];
             else
@@ -65,7 +69,7 @@ longnum& longnum::operator <<= (int count)
 
     if (bitshift > 0)
         // then shift bits within the word
-        for (i = WORDS_IN_LONGNUM - 1; i >= wordshift; i--)
+        for (i = WORDS - 1; i >= wordshift; i--)
         {
             value[i] = (value[i] << bitshift);
             if (i > wordshift)
@@ -76,15 +80,17 @@ longnum& longnum::operator <<= (int count)
     return *this;
 }
 
-longnum longnum::operator >> (int count) const
+template <int N_BITS>
+longnum_t<N_BITS> longnum_t<N_BITS>::operator >> (int count) const
 // shift right >> operator overload
 {
-    longnum result = *this;
+    longnum_t result = *this;
     result >>= count;
     return result;
 }
 
-longnum& longnum::operator >>= (int count)
+template <int N_BITS>
+longnum_t<N_BITS>& longnum_t<N_BITS>::operator >>= (int count)
 // shifts the bits in longnum right with count bits
 // if count >= #bits, longnum = 0 
 // if count <= 0, do nothing
@@ -94,7 +100,7 @@ longnum& longnum::operator >>= (int count)
     if (count <= 0)
         return *this;
 
-    if (count >= BITS_IN_LONGNUM)
+    if (count >= BITS)
     {
         fill(0);
         return *this;
@@ -105,18 +111,18 @@ longnum& longnum::operator >>= (int count)
 
     if (wordshift > 0)
         // first shift whole words:
-        for (i = 0; i < WORDS_IN_LONGNUM; i++)
-            if (i < WORDS_IN_LONGNUM - wordshift)
+        for (i = 0; i < WORDS; i++)
+            if (i < WORDS - wordshift)
                 value[i] = value[i + wordshift];
             else
                 value[i] = 0;
 
     if (bitshift > 0)
         // then shift bits within the word    
-        for (i = 0; i < WORDS_IN_LONGNUM - wordshift; i++)
+        for (i = 0; i < WORDS - wordshift; i++)
         {
             value[i] = value[i] >> bitshift;
-            if (i < (WORDS_IN_LONGNUM - 1))
+            if (i < (WORDS - 1))
                 // and copy the bits from the word to the left (except when we're looking at the last word)
                 value[i] |= (value[i + 1] << (BITS_IN_WORD - bitshift));
         }
@@ -124,34 +130,59 @@ longnum& longnum::operator >>= (int count)
     return *this;
 }
 
-longnum longnum::operator ^ (const longnum& xor_with) const
+template <int N_BITS>
+longnum_t<N_BITS> longnum_t<N_BITS>::operator ^ (const longnum_t& xor_with) const
 // performs a xor between value and xor_with, returns the result by reference
-// note: no check on size of the longnums, as they are all of equal length WORDS_IN_LONGNUM
+// note: no check on size of the longnums, as both are of the same type (WORDS words)
 // note: this function is equal to addition and subtraction in GF2 (see overloads of + and -)
 {
-    longnum ln_result = *this;
+    longnum_t ln_result = *this;
     ln_result ^= xor_with;
     return ln_result;
 }
 
-longnum& longnum::operator ^= (const longnum& xor_with)
+template <int N_BITS>
+longnum_t<N_BITS>& longnum_t<N_BITS>::operator ^= (const longnum_t& xor_with)
 // ^= operator overload
 {
     int i;
 
-    for (i = 0; i < WORDS_IN_LONGNUM; i++)
+    for (i = 0; i < WORDS; i++)
         value[i] = value[i] ^ xor_with.value[i];
 
     return *this;
 }
 
-t_word& longnum::operator [] (int i)
+template <int N_BITS>
+longnum_t<N_BITS> longnum_t<N_BITS>::operator & (const longnum_t& and_with) const
+// performs an and between value and and_with, returns the result
+{
+    longnum_t ln_result = *this;
+    ln_result &= and_with;
+    return ln_result;
+}
+
+template <int N_BITS>
+longnum_t<N_BITS>& longnum_t<N_BITS>::operator &= (const longnum_t& and_with)
+// &= operator overload
+{
+    int i;
+
+    for (i = 0; i < WORDS; i++)
+        value[i] = value[i] & and_with.value[i];
+
+    return *this;
+}
+
+template <int N_BITS>
+t_word& longnum_t<N_BITS>::operator [] (int i)
 // returns the indicated t_word, operator [] overload
 {
     return value[i];
 }
 
-void longnum::fill(int new_value)
+template <int N_BITS>
+void longnum_t<N_BITS>::fill(int new_value)
 // sets all bits in longnum to the indicated value (0 or 1) or random (-1)
 {
     int i = 0;
@@ -160,7 +191,7 @@ void longnum::fill(int new_value)
     if (new_value == FILL_RANDOM)
     // fill with random values
     {
-        for (i = 0; i < WORDS_IN_LONGNUM; i++)
+        for (i = 0; i < WORDS; i++)
             value[i] = ((rand() << 16) | rand());
         return;
     }
@@ -169,19 +200,20 @@ void longnum::fill(int new_value)
         // set new_word to all 1's if value is true, otherwise keep it at 0
         new_word = ~new_word;
 
-    for (i = 0; i < WORDS_IN_LONGNUM; i++)
+    for (i = 0; i < WORDS; i++)
         // iterate and fill
         value[i] = new_word;
 }
 
-t_word longnum::get_word(const int bitnum) const
+template <int N_BITS>
+t_word longnum_t<N_BITS>::get_word(const int bitnum) const
 // returns the t_word at bit position bitnum [0..#BITS-1]
 // fills the highest part of the return values with 0's if the last word is requested
 {
     int word_index, bit_index;
     t_word retval = 0;
 
-    if ((bitnum >= BITS_IN_LONGNUM) || (bitnum < 0))
+    if ((bitnum >= BITS) || (bitnum < 0))
     // return 0 if bitnum out of range
         return 0;
 
@@ -190,7 +222,7 @@ t_word longnum::get_word(const int bitnum) const
 
     retval = (value[word_index] >> bit_index);
 
-    if ((bit_index > 0) && (word_index < WORDS_IN_LONGNUM-1))
+    if ((bit_index > 0) && (word_index < WORDS-1))
         // check needed to prevent <<BITS_IN_WORD, which != 0
         // also, shift in from higher word is not needed for highest word
         retval |= (value[word_index + 1] << (BITS_IN_WORD - bit_index));
@@ -198,7 +230,8 @@ t_word longnum::get_word(const int bitnum) const
     return retval;
 }
 
-t_word longnum::get_word_wraparound(const int size, const int bitnum) const
+template <int N_BITS>
+t_word longnum_t<N_BITS>::get_word_wraparound(const int size, const int bitnum) const
 /** returns the t_word @ position bitnum, wraps around @ size or bit 0 if needed.
  *
  * description:
@@ -208,33 +241,29 @@ t_word longnum::get_word_wraparound(const int size, const int bitnum) const
  * if size-BITS_IN_WORD+1 <= bitnum < size:
  *      lower bits are [bitnum .. size]
  *      higher bits are [0..size-bitnum]
+ * both cases read whole words (see get_word), the second case splices the two parts together
 */
 {
-    int i, n=0;
-    t_word retval = 0;
+    int n = 0, n_low;
 
     if (size)
         n = (bitnum % size + size) % size;  // n is new bitnum, guaranteed to lie within the boundaries of size. Use of weird modulo to deal with negative bitnums. 
 
-    for (i = n + BITS_IN_WORD - 1; i >= n; i--)
-        // iterate over the bits and determine the right bit to fetch
-    {
-        retval <<= 1;    
+    n_low = size - n;   // nr of bits before the wraparound
 
-        if (i < size)
-            retval |= get_bit(i);
-        else
-            retval |= get_bit(i - size);
-    }
+    if (n_low >= BITS_IN_WORD)
+        // no wraparound needed
+        return get_word(n);
 
-    return retval;
+    return (get_word(n) & (((t_word)1 << n_low) - 1)) | (get_word(0) << n_low);
 }
 
-int longnum::get_bit(const int bitnum) const
+template <int N_BITS>
+int longnum_t<N_BITS>::get_bit(const int bitnum) const
 // returns the requested value (0 or 1) of the bit at bitnum [0..N-1]
 // returns 0 if bitnum is out of range
 {
-    if ((bitnum < 0) || (bitnum >= BITS_IN_LONGNUM))
+    if ((bitnum < 0) || (bitnum >= BITS))
         // requested bit is out of range, return 0
         return 0;
 
@@ -244,10 +273,11 @@ int longnum::get_bit(const int bitnum) const
     return ((value[word_index] & (1 << bit_index)) > 0);
 }
 
-void longnum::set_bit(const int bitnum, const int newvalue)
+template <int N_BITS>
+void longnum_t<N_BITS>::set_bit(const int bitnum, const int newvalue)
 // sets bit #bitnum in longnum to the indicated value 0 or 1. Bitnum = [0..N-1].
 {
-    if ((bitnum < 0) || (bitnum >= BITS_IN_LONGNUM))
+    if ((bitnum < 0) || (bitnum >= BITS))
         // requested bit is out of range, do nothing and return
         return;
 
@@ -262,54 +292,71 @@ void longnum::set_bit(const int bitnum, const int newvalue)
         value[word_index] &= ~t;
 }
 
-bool longnum::operator == (const longnum ln2)
+template <int N_BITS>
+bool longnum_t<N_BITS>::operator == (const longnum_t ln2)
 // returns true if contents of ln1 and ln2 are the same, false otherwise, == operator overload
 {
-    return (memcmp(value, ln2.value, sizeof(t_longnum)) == 0);
+    return (memcmp(value, ln2.value, sizeof(value)) == 0);
 }
 
-bool longnum::operator != (const longnum ln2)
+template <int N_BITS>
+bool longnum_t<N_BITS>::operator != (const longnum_t ln2)
 // returns true if contents of ln1 and ln2 differ, false if they are equal, != operator overload
 {
     return !(*this == ln2); 
 }
 
-void longnum::write_at_location(unsigned int location, const t_word* newvalue, int n_bits)
+template <int N_BITS>
+void longnum_t<N_BITS>::write_at_location(unsigned int location, const t_word* newvalue, int n_bits)
 // writes the first n bits of newvalue (array of t_word) to longnum @ bitposition location [0..N-1]
 // stops when the last bit of longnum is reached
+// writes one t_word of newvalue at a time, each of them touches at most two words of longnum
 {
-    if (location >= BITS_IN_LONGNUM) 
+    int i, n, word_index, bit_index;
+    uint64_t mask, bits;
+
+    if (location >= BITS) 
     // location outside of longnum; don't do anything
         return;
 
-    if (location + n_bits >= BITS_IN_LONGNUM)
+    if (location + n_bits >= BITS)
     // shorten n_bits to stay within longword
-        n_bits = BITS_IN_LONGNUM - location;
+        n_bits = BITS - location;
 
-    for (int i = 0; i < n_bits; i++)
+    for (i = 0; i < n_bits; i += BITS_IN_WORD)
     // iterate over newvalues, put them in the right place
     {
-        int n_word = i / BITS_IN_WORD;
-        int n_bit = i % BITS_IN_WORD;
-
-        set_bit(location + i, (newvalue[n_word] >> n_bit) & 1);
+        n = (n_bits - i < BITS_IN_WORD) ? n_bits - i : BITS_IN_WORD;
+        word_index = (location + i) / BITS_IN_WORD;
+        bit_index = (location + i) % BITS_IN_WORD;
+
+        // the n bits to be written, shifted to their place in the two words [word_index+1 : word_index]:
+        mask = (((uint64_t)1 << n) - 1) << bit_index;
+        bits = ((uint64_t)newvalue[i / BITS_IN_WORD] << bit_index) & mask;
+
+        value[word_index] = (value[word_index] & ~(t_word)mask) | (t_word)bits;
+        if ((mask >> BITS_IN_WORD) != 0)
+            // the bits continue in the next word (which exists, as n_bits was shortened)
+            value[word_index + 1] = (value[word_index + 1] & ~(t_word)(mask >> BITS_IN_WORD)) | (t_word)(bits >> BITS_IN_WORD);
     }
 }
 
-void longnum::write_at_location(unsigned int location, const t_word newvalue, int n_bits)
+template <int N_BITS>
+void longnum_t<N_BITS>::write_at_location(unsigned int location, const t_word newvalue, int n_bits)
 // writes the first n_bits of newvalue to the longnum
 {
     write_at_location(location, &newvalue, n_bits);
 }
 
-int longnum::get_order(void) const
+template <int N_BITS>
+int longnum_t<N_BITS>::get_order(void) const
 // returns the order of longnum (position of highest bit that is 1, 0 if longnum==0)
 {
-    int wordnum = WORDS_IN_LONGNUM - 1;
+    int wordnum = WORDS - 1;
     int i;
 
     // coming from the MSB, find the first word that is > 0:
-    while ((value[wordnum] == 0) && (wordnum >= 0))
+    while ((wordnum >= 0) && (value[wordnum] == 0))
         wordnum--;
 
     if (wordnum >= 0)
@@ -330,29 +377,106 @@ int longnum::get_order(void) const
     return -1;
 }
 
-void longnum::read_from_array(uint8_t* arr, int n)
-// converts the first n bytes [0..n] in the char array arr to a longnum ln (setting bits [n*8-1 .. 0] )
+static inline int count_trailing_zeros(t_word w)
+// returns the position of the lowest bit that is 1 in w (w shall be != 0)
 {
-    int j;
-    t_word newbyte;
+#if defined(__GNUC__)
+    return __builtin_ctz(w);
+#else
+    int n = 0;
 
-    for (j = n - 1; j >= 0; j--)
+    while (!(w & 1))
+    {
+        w >>= 1;
+        n++;
+    }
+
+    return n;
+#endif
+}
+
+template <int N_BITS>
+int longnum_t<N_BITS>::get_next_bit(int bitnum) const
+// returns the position of the first bit that is 1 at or above bitnum, or -1 if there is none
+{
+    int word_index;
+    t_word w;
+
+    if ((bitnum < 0) || (bitnum >= BITS))
+        return -1;
+
+    word_index = bitnum / BITS_IN_WORD;
+    w = value[word_index] & (~(t_word)0 << (bitnum % BITS_IN_WORD));   // mask out the bits below bitnum
+
+    while (w == 0)
     {
-        newbyte = (t_word)arr[j] & 0xFF;
-        write_at_location((n - j - 1) * 8, &newbyte, 8);
+        if (++word_index == WORDS)
+            return -1;
+        w = value[word_index];
     }
+
+    return word_index * BITS_IN_WORD + count_trailing_zeros(w);
 }
 
-void longnum::write_to_array(uint8_t* arr, int n) const
+template <int N_BITS>
+void longnum_t<N_BITS>::read_from_array(const uint8_t* arr, int n, int shift)
+// converts the first n bytes [0..n] in the char array arr (most significant byte first) to the longnum, shifted right by shift bits [0..7]:
+// sets bits [n*8-1-shift .. 0], clears the other bits. The bytes beyond the longnum are ignored.
+// builds each word from the 5 bytes it overlaps, so the shift to the alignment a_calc costs nothing extra (see telegram::parse_input)
+{
+    int i, k, j;
+    uint64_t w;
+
+    for (i = 0; i < WORDS; i++)
+    {
+        w = 0;
+        for (k = 4; k >= 0; k--)
+        {
+            j = 4 * i + k;      // byte j, counted from the least significant byte
+            w = (w << 8) | (((j < n) && (j < 4 * WORDS)) ? arr[n - 1 - j] : 0);
+        }
+
+        value[i] = (t_word)(w >> shift);
+    }
+}
+
+template <int N_BITS>
+void longnum_t<N_BITS>::write_to_array(uint8_t* arr, int n) const
 // converts the first n bytes [0..n] in longnum ln to the char array arr 
+// reads the bytes straight from the words, the bytes beyond the longnum are 0 (like get_word)
 {
     int j;
 
     for (j = n - 1; j >= 0; j--)
-        arr[n - j - 1] = get_word(j * 8) & 0xFF;
+        arr[n - j - 1] = (j / 4 < WORDS) ? (uint8_t)(value[j / 4] >> (8 * (j % 4))) : 0;
+}
+
+template <int N_BITS>
+void longnum_t<N_BITS>::read_from_limbs(const uint64_t* limbs, int n)
+// sets the longnum to the first n 64-bit limbs (limb 0 = bits 0..63), the higher bits are cleared
+{
+    int i;
+
+    fill(0);
+
+    for (i = 0; (i < 2 * n) && (i < WORDS); i++)
+        value[i] = (t_word)(limbs[i / 2] >> (32 * (i % 2)));
 }
 
-void longnum::print_bin(int v) const
+template <int N_BITS>
+void longnum_t<N_BITS>::write_to_limbs(uint64_t* limbs) const
+// copies the longnum into LIMBS_IN_LONGNUM 64-bit limbs (limb 0 = bits 0..63)
+{
+    int i;
+
+    memset(limbs, 0, LIMBS * sizeof(uint64_t));
+
+    for (i = 0; i < WORDS; i++)
+        limbs[i / 2] |= (uint64_t)value[i] << (32 * (i % 2));
+}
+
+template <int N_BITS>
+void longnum_t<N_BITS>::print_bin(int v) const
 // prints longnum in a structured way, nibble by nibble
 // ends with the order of longnum and a CR
 // uses v as verbosity level
@@ -379,7 +503,8 @@ void longnum::print_bin(int v) const
     printf(" order: %d\n", order);
 }
 
-void longnum::print_hex(int v, int n) const
+template <int N_BITS>
+void longnum_t<N_BITS>::print_hex(int v, int n) const
 // prints the hex values in longnum (n bits) using verbosity level v
 // write per byte (instead of per whole word) to prevent unwanted leading 0's
 {
@@ -391,7 +516,8 @@ void longnum::print_hex(int v, int n) const
         printf("%02X", get_word(j * 8) & 0xFF);
 }
 
-int longnum::sprint_hex(string& line, int n) const
+template <int N_BITS>
+int longnum_t<N_BITS>::sprint_hex(string& line, int n) const
 // writes the first n bits in longnum to *line in hex format    
 // returns the amount of chars written
 // write per byte (instead of per whole word) to prevent unwanted leading 0's 
@@ -413,11 +539,12 @@ int longnum::sprint_hex(string& line, int n) const
     return (int)line.length();
 }
 
-int longnum::sprint_base64(string& line, int n) const
+template <int N_BITS>
+int longnum_t<N_BITS>::sprint_base64(string& line, int n) const
 // writes the first n bits in longnum to *line in base64 format
 // returns the amount of chars written
 {
-    uint8_t arr[WORDS_IN_LONGNUM*8] = { 0 };
+    uint8_t arr[WORDS*8] = { 0 };
 
     write_to_array(arr, n/8+1);
     b64_encode(arr, n/8+1, line);
@@ -425,7 +552,8 @@ int longnum::sprint_base64(string& line, int n) const
     return (int)line.length();
 }
 
-void longnum::print_fancy(int v, int wordlength, int size, t_longnum_layout* longnum_layout) const
+template <int N_BITS>
+void longnum_t<N_BITS>::print_fancy(int v, int wordlength, int size, t_longnum_layout* longnum_layout) const
 /**
  * prints the longnum binary, in a structured way, with colors! 8-o
  *
@@ -504,15 +632,17 @@ void longnum::print_fancy(int v, int wordlength, int size, t_longnum_layout* lon
     printf("\nOrder: %d\n", get_order());
 }
 
-longnum longnum::operator * (const longnum& with) const
+template <int N_BITS>
+longnum_t<N_BITS> longnum_t<N_BITS>::operator * (const longnum_t& with) const
 // * operator overload, performs a GF2-multiplication
 {
-    longnum result = *this;
+    longnum_t result = *this;
     result *= with;
     return result;
 }
 
-longnum& longnum::operator *= (const longnum& q)
+template <int N_BITS>
+longnum_t<N_BITS>& longnum_t<N_BITS>::operator *= (const longnum_t& q)
 /* performs a GF2 - multiplication of values with q, returns the result
 
 From https://www.moria.us/articles/demystifying-the-lfsr/:
@@ -527,14 +657,34 @@ uint32_t mod2_multiply(uint32_t p, uint32_t q) {
   return result;
 }
 */
+{
+    const t_gf2_kernels* kernels = gf2_get_hw_kernels();
+    uint64_t a[LIMBS], b[LIMBS], r[LIMBS];
+
+    if (kernels == NULL)
+        // no carry-less multiplication available in this cpu
+        return GF2_multiply_portable(q);
+
+    // multiply 64 bits at a time:
+    write_to_limbs(a);
+    q.write_to_limbs(b);
+    kernels->multiply(a, b, r, LIMBS);
+    read_from_limbs(r, LIMBS);
+
+    return *this;
+}
+
+template <int N_BITS>
+longnum_t<N_BITS>& longnum_t<N_BITS>::GF2_multiply_portable(const longnum_t& q)
+// performs a GF2 - multiplication of values with q bit by bit, returns the result (see operator *=)
 {
     int i;
-    longnum result;
+    longnum_t result;
 
     // clear all bits in result:
     result.fill(0);
 
-    for (i = 0; i < BITS_IN_LONGNUM; i++)
+    for (i = 0; i < BITS; i++)
     // iterate over all the bits:
         if (q.get_bit(i))
             result ^= *this << i;
@@ -543,33 +693,38 @@ uint32_t mod2_multiply(uint32_t p, uint32_t q) {
     return *this;
 }
 
-longnum longnum::operator + (const longnum& q) const
+template <int N_BITS>
+longnum_t<N_BITS> longnum_t<N_BITS>::operator + (const longnum_t& q) const
 // GF2 addition is a simple ^
 {
     return *this ^ q;
 }
 
-longnum& longnum::operator += (const longnum& q)
+template <int N_BITS>
+longnum_t<N_BITS>& longnum_t<N_BITS>::operator += (const longnum_t& q)
 // += operator overload, perform a GF2 addition
 {
     *this ^= q;
     return *this;
 }
 
-longnum longnum::operator - (const longnum& q) const
+template <int N_BITS>
+longnum_t<N_BITS> longnum_t<N_BITS>::operator - (const longnum_t& q) const
 // GF2 subtraction is a simple ^
 {
     return *this ^ q;
 }
 
-longnum& longnum::operator -= (const longnum& q)
+template <int N_BITS>
+longnum_t<N_BITS>& longnum_t<N_BITS>::operator -= (const longnum_t& q)
 // -= operator overload, perform a GF2 subtraction
 {
     *this ^= q;
     return *this;
 }
 
-longnum& longnum::GF2_division(const longnum& denominator, longnum& quotient, longnum& remainder)
+template <int N_BITS>
+longnum_t<N_BITS>& longnum_t<N_BITS>::GF2_division(const longnum_t& denominator, longnum_t& quotient, longnum_t& remainder)
 // performs a GF2-division of this / denominator, fills quotient and remainder, returns the quotient (=self)
 // returns without doing anything if divider q==0
 
@@ -593,6 +748,30 @@ struct division_result mod2_divide(uint32_t p, uint32_t q) {
       .remainder = remainder,
   };
 }*/
+// Uses Barrett reduction if the cpu supports carry-less multiplication and the denominator has an order of 2..128 (see gf2_clmul.h).
+{
+    int q_order = denominator.get_order();
+    const t_gf2_kernels* kernels = gf2_get_hw_kernels();
+    uint64_t num[LIMBS], den[LIMBS], quot[LIMBS], rem[2];
+
+    if ((kernels == NULL) || (q_order < 2) || (q_order > GF2_BARRETT_MAX_DEGREE + 1))
+        return GF2_division_portable(denominator, quotient, remainder);
+
+    write_to_limbs(num);
+    denominator.write_to_limbs(den);
+
+    gf2_barrett barrett(den);
+    kernels->divide(barrett, num, LIMBS, quot, rem);
+
+    quotient.read_from_limbs(quot, LIMBS);
+    remainder.read_from_limbs(rem, 2);
+
+    return *this;
+}
+
+template <int N_BITS>
+longnum_t<N_BITS>& longnum_t<N_BITS>::GF2_division_portable(const longnum_t& denominator, longnum_t& quotient, longnum_t& remainder)
+// performs a GF2-division of this / denominator bit by bit, fills quotient and remainder, returns the quotient (=self) (see GF2_division)
 {
     int q_order = denominator.get_order();
 
@@ -621,6 +800,11 @@ struct division_result mod2_divide(uint32_t p, uint32_t q) {
     return *this;
 }
 
+// the sizes for which longnum_t is used, see longnum.h and telegram.h:
+template class longnum_t<85>;               // check bits (longnum_checkbits)
+template class longnum_t<830>;              // user data of a long or short telegram (longnum_userdata)
+template class longnum_t<BITS_IN_LONGNUM>;  // longnum
+
 /*
 void longnum::reverse (t_longnum longnum)
 // reverses the bit order of longnum. Currently unused and therefore commented out.
@@ -30,10 +30,12 @@
 #include <string>
 #include <string.h>
 // TBD: both needed?
+#include "gf2_clmul.h"
  
  
 
-// longnum is an array[0..WORDS_IN_LONGNUM] of unsigned int32
+// longnum_t<N_BITS> is an array of (N_BITS+31)/32 unsigned int32, instantiated in longnum.cpp for the sizes that are used
+// longnum is longnum_t<BITS_IN_LONGNUM>: an array[0..WORDS_IN_LONGNUM] of unsigned int32
 // MSB of longnum is bit 7 of int WORDS_IN_LONGNUM
 // LSB of longnum is bit 0 of int 0
 // WORDS_IN_LONGNUM shall be at least 2. Max size depends on computer memory and speed.
@@ -48,6 +50,7 @@ typedef t_word t_longnum[WORDS_IN_LONGNUM];       // type of longnum. Note: size
 // define the parameters of the longnum:
 const int BITS_IN_WORD = sizeof(t_word) * 8;                        // nr of bits in one t_word
 const int BITS_IN_LONGNUM = sizeof(t_word) * 8 * WORDS_IN_LONGNUM;    // nr of bits in one t_longnum
+const int LIMBS_IN_LONGNUM = (WORDS_IN_LONGNUM + 1) / 2;              // nr of 64-bit limbs needed to store one longnum (see gf2_clmul.h)
 
 #define FILL_RANDOM -1
 
@@ -55,33 +58,48 @@ const int BITS_IN_LONGNUM = sizeof(t_word) * 8 * WORDS_IN_LONGNUM;    // nr of b
 extern const int BITS_IN_WORD;        // nr of bits in one word. 
 extern const int BITS_IN_LONGNUM;     // total nr of bits in the longnum: BITS_IN_WORD * WORDS_IN_LONGNUM
 
-class longnum {
+template <int N_BITS>
+class longnum_t {
+
+	template <int N_BITS_FROM> friend class longnum_t;
+
+public:
+	static const int WORDS = (N_BITS + BITS_IN_WORD - 1) / BITS_IN_WORD;	// nr of t_words
+	static const int BITS = WORDS * BITS_IN_WORD;							// nr of bits that can be stored (N_BITS rounded up to whole words)
+	static const int LIMBS = (WORDS + 1) / 2;								// nr of 64-bit limbs needed to store the value (see gf2_clmul.h)
 
 private:
-	t_longnum value;  // the actual values of the longnum
+	t_word value[WORDS];  // the actual values of the longnum
 
 public:
-	longnum(int with = 0);   // constructor, default set to 0
-	longnum(t_word* init_val, int count);   // constructor, fills with indicated values
-	longnum operator << (int count) const;
-	longnum& operator <<= (int count);
-	longnum operator >> (int count) const;
-	longnum& operator >>= (int count);
-	longnum operator ^ (const longnum& xor_with) const;
-	longnum& operator ^= (const longnum& xor_with);
+	longnum_t(int with = 0);   // constructor, default set to 0
+	longnum_t(t_word* init_val, int count);   // constructor, fills with indicated values
+	template <int N_BITS_FROM>
+	longnum_t(const longnum_t<N_BITS_FROM>& from);   // conversion from a longnum of another size
+	longnum_t operator << (int count) const;
+	longnum_t& operator <<= (int count);
+	longnum_t operator >> (int count) const;
+	longnum_t& operator >>= (int count);
+	longnum_t operator ^ (const longnum_t& xor_with) const;
+	longnum_t& operator ^= (const longnum_t& xor_with);
+	longnum_t operator & (const longnum_t& and_with) const;
+	longnum_t& operator &= (const longnum_t& and_with);
 	t_word& operator [] (int i);
 	void fill(int value);
 	t_word get_word(int bitnum) const;
 	t_word get_word_wraparound(int size, int bitnum) const;
 	int get_bit(int bitnum) const;
 	void set_bit(int bitnum, int value);  
-	bool operator == (const longnum ln2);
-	bool operator != (const longnum ln2);
+	bool operator == (const longnum_t ln2);
+	bool operator != (const longnum_t ln2);
 	void write_at_location(unsigned int location, const t_word* newvalue, int n_bits);		// write an array of t_words   
 	void write_at_location(unsigned int location, const t_word newvalue, int n_bits);		// write one t_word
 	int get_order(void) const;
-	void read_from_array(uint8_t* arr, int n);
+	int get_next_bit(int bitnum) const;
+	void read_from_array(const uint8_t* arr, int n, int shift = 0);
 	void write_to_array(uint8_t* arr, int n) const;
+	void read_from_limbs(const uint64_t* limbs, int n);
+	void write_to_limbs(uint64_t* limbs) const;
 	void print_bin(int v) const;
 	void print_hex(int v, int n) const;
 	int sprint_hex(string& line, int n) const;
@@ -89,17 +107,34 @@ public:
 	void print_fancy(int verbosity, int wordlength, int size, t_longnum_layout* longnum_layout) const;
 
 //	Binary Galois Field operations:
-	longnum operator * (const longnum& q) const;
-	longnum& operator *= (const longnum& q);
-	longnum operator + (const longnum& q) const;
-	longnum& operator += (const longnum& q);
-	longnum operator - (const longnum& q) const;
-	longnum& operator -= (const longnum& q);
+	longnum_t operator * (const longnum_t& q) const;
+	longnum_t& operator *= (const longnum_t& q);
+	longnum_t operator + (const longnum_t& q) const;
+	longnum_t& operator += (const longnum_t& q);
+	longnum_t operator - (const longnum_t& q) const;
+	longnum_t& operator -= (const longnum_t& q);
 
-	longnum& GF2_division(const longnum& denominator, longnum& quotient, longnum& remainder);
+	longnum_t& GF2_division(const longnum_t& denominator, longnum_t& quotient, longnum_t& remainder);
+	longnum_t& GF2_multiply_portable(const longnum_t& q);
+	longnum_t& GF2_division_portable(const longnum_t& denominator, longnum_t& quotient, longnum_t& remainder);
 
 	//void reverse (t_longnum longnum);
 	//int find_bit_pattern (t_longnum longnum, unsigned int findme, int n);
 };
 
+template <int N_BITS>
+template <int N_BITS_FROM>
+longnum_t<N_BITS>::longnum_t(const longnum_t<N_BITS_FROM>& from)
+// conversion constructor: copies the lower words of a longnum of another size, clears the remaining words
+// if from is larger, its higher words are dropped
+{
+	int i;
+
+	for (i = 0; i < WORDS; i++)
+		value[i] = (i < from.WORDS) ? from.value[i] : 0;
+}
+
+// the default size, used throughout the library:
+typedef longnum_t<BITS_IN_LONGNUM> longnum;
+
 #endif
\ No newline at end of file
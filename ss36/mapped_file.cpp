@@ -0,0 +1,147 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+#include "mapped_file.h"
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <windows.h>        // CreateFileA, CreateFileMappingA, MapViewOfFile
+#else
+#include <fcntl.h>          // open
+#include <sys/mman.h>       // mmap
+#include <sys/stat.h>       // fstat
+#include <unistd.h>         // close
+#endif
+
+mapped_file::mapped_file(const string filename)
+// opens and maps the file. Use is_open() to see if this succeeded (see errno).
+{
+    opened = false;
+    data = NULL;
+    size = 0;
+    mapping = NULL;
+
+#if defined(_WIN32)
+    LARGE_INTEGER file_size;
+
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = NULL;
+
+    file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+        return;
+
+    opened = true;
+    if (!GetFileSizeEx(file_handle, &file_size) || (GetFileType(file_handle) != FILE_TYPE_DISK))
+    {
+        opened = read_into_buffer(filename);
+        return;
+    }
+
+    if (file_size.QuadPart == 0)
+        return;
+
+    mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping_handle != NULL)
+        mapping = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+
+    if (mapping == NULL)
+    {
+        opened = read_into_buffer(filename);
+        return;
+    }
+
+    data = (const char*)mapping;
+    size = (size_t)file_size.QuadPart;
+#else
+    struct stat st;
+    void* p;
+    int fd = open(filename.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        return;
+
+    opened = true;
+    if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode))
+    // not a regular file, can not be mapped
+    {
+        close(fd);
+        opened = read_into_buffer(filename);
+        return;
+    }
+
+    if (st.st_size > 0)
+    {
+        p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            close(fd);
+            opened = read_into_buffer(filename);
+            return;
+        }
+
+        mapping = p;
+        data = (const char*)p;
+        size = (size_t)st.st_size;
+        madvise(p, size, MADV_SEQUENTIAL);
+    }
+
+    // the mapping stays valid after closing the file:
+    close(fd);
+#endif
+}
+
+mapped_file::~mapped_file(void)
+// unmaps the file
+{
+#if defined(_WIN32)
+    if (mapping != NULL)
+        UnmapViewOfFile(mapping);
+    if (mapping_handle != NULL)
+        CloseHandle(mapping_handle);
+    if (file_handle != INVALID_HANDLE_VALUE)
+        CloseHandle(file_handle);
+#else
+    if (mapping != NULL)
+        munmap(mapping, size);
+#endif
+}
+
+bool mapped_file::is_open(void) const
+// returns true if the file could be opened
+{
+    return opened;
+}
+
+string_view mapped_file::contents(void) const
+// returns a view on the contents of the file
+{
+    return string_view(data, size);
+}
+
+bool mapped_file::read_into_buffer(const string filename)
+// reads the file into buffer, for files that can not be mapped. Returns true if success.
+{
+    ifstream f(filename, ios::binary);
+    stringstream s;
+
+    if (!f.is_open())
+        return false;
+
+    s << f.rdbuf();
+    buffer = s.str();
+    data = buffer.data();
+    size = buffer.length();
+
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * mapped_file - read-only view on the contents of a file, without copying it into a string
+ *
+ * The file is mapped into memory (mmap on POSIX, a file mapping on Windows): the pages are read in by the OS when they are
+ * touched, so the threads that parse different parts of the file also read them in parallel.
+ * Files that can not be mapped (pipes, devices) are read into a buffer instead. An empty file gives an empty view.
+ * The view is valid until the mapped_file is destroyed.
+*/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <string_view>
+using namespace std;
+
+class mapped_file
+{
+public:
+    mapped_file(const string filename);
+    ~mapped_file(void);
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    bool is_open(void) const;
+    string_view contents(void) const;
+
+private:
+    bool        opened;         // true if the file was opened
+    const char* data;           // the contents of the file
+    size_t      size;           // nr of chars in the file
+    void*       mapping;        // the mapping, NULL if the file is not mapped
+    string      buffer;         // the contents of a file that could not be mapped
+#if defined(_WIN32)
+    void*       file_handle;    // the handles of the file and the mapping object
+    void*       mapping_handle;
+#endif
+
+    bool read_into_buffer(const string filename);
+};
+
+#endif
@@ -12,65 +12,57 @@
 
 #include "parse_input.h"
 
-telegram* parse_input_line(const char* line_orig)
-// parses the input line, creates and fills the telegram
-// returns a pointer to a telegram if all went well, NULL if the line is empty (or only contains comments),
-// ERR_INPUT_ERROR if the contents of the line could not be parsed
+bool parse_input_line(string_view line, telegram_batch& telegrams)
+// parses the input line, creates and fills the telegram at the end of telegrams
+// returns true if a telegram was added, false if the line is empty (or only contains comments)
+// the errcode of the telegram is ERR_INPUT_ERROR if the contents of the line could not be parsed
+// the line is parsed in place: only the input string of the telegram (used in the output) is copied
 {
-    char* p=NULL, line[MAX_ARRAY_SIZE];
+    size_t p;
     telegram* p_telegram;
 
-    //strcpy_s(line, line_orig);
-    strncpy(line, line_orig, sizeof(line));
-    line[sizeof(line) - 1] = '\0';
+    // like a C-string of at most MAX_ARRAY_SIZE-1 chars: the line ends at the first \0
+    line = line.substr(0, min(line.find('\0'), (size_t)MAX_ARRAY_SIZE - 1));
 
     // first remove any comments (starting with '#') from the line
-    p = strchr(line, '#');
-    if (p != NULL)
-        *p = '\0'; // end the line at the start of the comments
-    else
-        p = &(line[strlen(line)]);  // point p to end of string
+    p = line.find('#');
+    if (p != string_view::npos)
+        line = line.substr(0, p); // end the line at the start of the comments
 
     // then clear trailing spaces, CR's, LF's, tabs, separators
-    p--;
-    while ((*p == '\n') || (*p == '\r') || (*p == ' ') || (*p == '\t') || (*p == ';') || (*p == ','))
-    {
-        *p = '\0';
-        p--;
-    }
+    while ((line.length() > 0) && ((line.back() == '\n') || (line.back() == '\r') || (line.back() == ' ') ||
+                                   (line.back() == '\t') || (line.back() == ';') || (line.back() == ',')))
+        line.remove_suffix(1);
 
     // check if anything is left; if not, skip to the next line
-    if (line[0] == '\0')
-        return NULL;
+    if (line.length() == 0)
+        return false;
 
-    // create new telegram, fill with dummy values
-    p_telegram = new telegram("", s_long);
-//    p_telegram = new telegram((string)line_orig, s_long);  // does not work as the creator will parse the string
+    // create new telegram at the end of the batch, fill with dummy values
+    telegrams.emplace_back("", s_long);
+    p_telegram = &telegrams.back();
     p_telegram->errcode = ERR_NO_ERR;
-    p_telegram->input_string = line; // _orig;  // do this manually to prevent the creator from parsing the input string
+    p_telegram->input_string = line;    // do this manually to prevent the creator from parsing the input string
 
     // see if there is a comma or semicolon. If so: read in both values
-    p = strchr(line, ',');
-    if (p == NULL)
-        p = strchr(line, ';');
+    p = line.find(',');
+    if (p == string_view::npos)
+        p = line.find(';');
 
-    if (p != NULL)
+    if (p != string_view::npos)
     // comma or semicolon found, p points at it
     {
-        *p = '\0';     // terminate the string at the comma
-        p_telegram->parse_input((string)line);  // parse the first part of the string
+        p_telegram->parse_input(line.substr(0, p));  // parse the first part of the string
         if (p_telegram->errcode != ERR_NO_ERR)
         // something went wrong with the parsing, skip parsing the rest of the line
-            return p_telegram;
-        p++; // increase p to point to the location next to where the ',' or ';' used to be
+            return true;
+        line = line.substr(p + 1); // continue with the part next to the ',' or ';'
     }
-    else
-        p = line;
 
-    p_telegram->parse_input((string)p);  // parse the second part of the string
+    p_telegram->parse_input(line);  // parse the second part of the string
     if (p_telegram->errcode != ERR_NO_ERR)
     // something went wrong with the parsing, skip the rest
-        return p_telegram;
+        return true;
 
     if (p_telegram->number_of_userbits)
     // the unshaped data is set, print it
@@ -85,49 +77,62 @@ telegram* parse_input_line(const char* line_orig)
         p_telegram->contents.print_fancy(VERB_ALL, 16, p_telegram->size, NULL);
     }
 
-    return p_telegram;
+    return true;
 }
 
-telegram* parse_content_string(const string& contents_orig)
-// parses the balise information in contents into a linked list of telegrams
+telegram_batch parse_content_string(string_view contents)
+// parses the balise information in contents into a batch of telegrams, in the order of the lines
+// the lines are parsed in place, they are not copied
 {
     size_t start = 0, found;
-
-    string line;
+    string_view line;
     int linecount = 0;    
-    telegram *p_new_telegram = NULL, *p_start_of_list = NULL, *p_previous_telegram = NULL;
-    string contents = contents_orig + "\n";
+    telegram_batch telegrams;
+
+    // reserve a telegram for each line, so the telegrams are not moved while parsing:
+    telegrams.reserve(count(contents.begin(), contents.end(), LINE_DELIM) + 1);
 
-    for (found = contents.find(LINE_DELIM); found != string::npos; found = contents.find(LINE_DELIM, start))
-    // iterate over the lines (separated by LINE_DELIM in contents)
+    while (start <= contents.length())
+    // iterate over the lines (separated by LINE_DELIM in contents), the last line does not need to end with LINE_DELIM
     {
-        line = contents.substr(start, found - start).c_str();
+        found = contents.find(LINE_DELIM, start);
+        if (found == string_view::npos)
+            found = contents.length();
+
+        line = contents.substr(start, found - start);
         linecount++;
         start = found + 1;
-        eprintf(VERB_GLOB, "\nRead in line #%d:\t\"%s\"", linecount, line.c_str());
-        p_new_telegram = parse_input_line(line.c_str());
-        if (!p_new_telegram)
+        eprintf(VERB_GLOB, "\nRead in line #%d:\t\"%.*s\"", linecount, (int)line.length(), line.data());
+        if (!parse_input_line(line, telegrams))
             eprintf(VERB_GLOB, " -> Skipped line\n");
         else
         {
-            if (p_start_of_list == NULL)
-            // this is the first telegram, point p_start_of_list to it
-                p_start_of_list = p_new_telegram;
-            else
-            // not the first, point next in the previous telegram to the new one
-                p_previous_telegram->next = p_new_telegram;
-
-            // remember the previous telegram for the next line
-            p_previous_telegram = p_new_telegram;
-            
-            //telegramlist.push_back(p_new_telegram);
-
-            if (p_new_telegram->errcode == ERR_NO_ERR)
+            if (telegrams.back().errcode == ERR_NO_ERR)
                 eprintf(VERB_GLOB, " -> parsed OK\n");
             else
                 eprintf(VERB_GLOB, " -> parse error\n");
         }
     }
 
-    return p_start_of_list;
+    return telegrams;
+}
+
+vector<string_view> split_lines(string_view contents, unsigned int n_chunks)
+// splits contents in at most n_chunks chunks of about the same size, each chunk ends after a LINE_DELIM (except the last one)
+// only the ends of the chunks are searched for, the lines in the chunks are found by the parser of each chunk
+{
+    vector<string_view> chunks;
+    size_t start = 0, end;
+    unsigned int i;
+
+    for (i = 1; (i <= n_chunks) && (start < contents.length()); i++)
+    {
+        // end the chunk after the first LINE_DELIM from the end of the i-th part of contents on, the last chunk takes the rest:
+        end = (i < n_chunks) ? contents.find(LINE_DELIM, max(start, contents.length() / n_chunks * i)) : string_view::npos;
+        end = (end == string_view::npos) ? contents.length() : end + 1;
+        chunks.push_back(contents.substr(start, end - start));
+        start = end;
+    }
+
+    return chunks;
 }
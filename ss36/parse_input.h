@@ -15,6 +15,9 @@
 
 #include "telegram.h"
 #include <string.h>
+#include <algorithm>        // count
+#include <string_view>
+#include <vector>
 
 // expected input sizes of shaped telegrams: 
 #define N_CHARS_SHAPED_LONG_HEX          256    // 2 char/byte, 1024 bits/8=128 bytes=256 chars. So: SHR 1 to loose 1 bit to get to 1023 bits in complete telegram.
@@ -32,7 +35,8 @@
 #define LINE_DELIM						'\n'	// line delimiter
 
 // prototypes:
-telegram* parse_content_string(const string& contents);
-telegram* parse_input_line(const char* line);
+telegram_batch parse_content_string(string_view contents);
+bool parse_input_line(string_view line, telegram_batch& telegrams);
+vector<string_view> split_lines(string_view contents, unsigned int n_chunks);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,391 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+#include "result_cache.h"
+#include <string.h>
+#include <errno.h>
+
+#if defined(_WIN32)
+#include <windows.h>        // CreateFileA, CreateFileMappingA, MapViewOfFile
+#else
+#include <fcntl.h>          // open
+#include <sys/mman.h>       // mmap
+#include <sys/stat.h>       // fstat
+#include <sys/file.h>       // flock
+#include <unistd.h>         // close, ftruncate, pread
+#endif
+
+result_cache shape_cache;
+
+result_cache::result_cache(void)
+// creates a closed cache
+{
+    hits = 0;
+    misses = 0;
+    rejected = 0;
+    slots = NULL;
+    n_buckets = 0;
+    mapping = NULL;
+    mapping_size = 0;
+    build_id = 0;
+#if defined(_WIN32)
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = NULL;
+#else
+    fd = -1;
+#endif
+}
+
+result_cache::~result_cache(void)
+// unmaps the file
+{
+    close();
+}
+
+static void set_build(char* build_field, const string build)
+// writes build to the build field of a header, padded with 0's (cut off after RESULT_CACHE_BUILD_SIZE chars)
+{
+    memset(build_field, 0, RESULT_CACHE_BUILD_SIZE);
+    memcpy(build_field, build.data(), min(build.length(), (size_t)RESULT_CACHE_BUILD_SIZE));
+}
+
+static uint32_t build_hash(const string build)
+// returns the hash of build that is stored in each slot (FNV-1a), never 0
+{
+    uint32_t h = 2166136261u;
+
+    for (char c : build)
+        h = (h ^ (uint8_t)c) * 16777619u;
+
+    return (h == 0) ? 1 : h;
+}
+
+static bool valid_header(const t_cache_header& header, size_t file_size, const string build)
+// returns true if header is the header of a cache file of this format and build, of which all slots fit in file_size bytes
+{
+    char expected[RESULT_CACHE_BUILD_SIZE];
+
+    set_build(expected, build);
+
+    return (memcmp(header.magic, RESULT_CACHE_MAGIC, sizeof(header.magic)) == 0) && (header.slot_size == sizeof(t_cache_slot)) &&
+        (header.n_slots > 0) && (header.n_slots % RESULT_CACHE_WAYS == 0) &&
+        (file_size >= sizeof(t_cache_header) + (size_t)header.n_slots * sizeof(t_cache_slot)) &&
+        (memcmp(header.build, expected, sizeof(expected)) == 0);
+}
+
+static bool reusable_file(const t_cache_header& header, size_t n_header, size_t file_size)
+// returns true if the file may be reinitialised: it is empty, or its first n_header bytes in header start like a cache file
+{
+    return (file_size == 0) || ((n_header >= RESULT_CACHE_MAGIC_PREFIX) &&
+        (memcmp(header.magic, RESULT_CACHE_MAGIC, RESULT_CACHE_MAGIC_PREFIX) == 0));
+}
+
+bool result_cache::open(const string filename, uint32_t new_slots, const string build)
+// opens, locks and maps the cache file. Creates it with new_slots slots if it does not exist or is empty. A cache file of
+// another format, build or size (e.g. truncated) is reinitialised with empty slots.
+// returns false if the file could not be opened or mapped (see errno), errno is EBUSY if another process has opened it and
+// EEXIST if the file is not a cache file (it is not changed).
+{
+    t_cache_header header;
+    size_t file_size, old_size, n_header;
+    bool valid;
+
+    close();
+
+    new_slots = (new_slots + RESULT_CACHE_WAYS - 1) / RESULT_CACHE_WAYS * RESULT_CACHE_WAYS;
+    if (new_slots == 0)
+        new_slots = RESULT_CACHE_WAYS;
+
+#if defined(_WIN32)
+    LARGE_INTEGER current_size;
+    DWORD n_read = 0;
+
+    // no sharing: a second process can not open the file while it is open here
+    file_handle = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        errno = (GetLastError() == ERROR_SHARING_VIOLATION) ? EBUSY : EIO;
+        return false;
+    }
+
+    if (!GetFileSizeEx(file_handle, &current_size))
+    {
+        close();
+        errno = EIO;
+        return false;
+    }
+
+    file_size = old_size = (size_t)current_size.QuadPart;
+    memset(&header, 0, sizeof(header));
+    n_header = ReadFile(file_handle, &header, sizeof(header), &n_read, NULL) ? (size_t)n_read : 0;
+    valid = (n_header == sizeof(header)) && valid_header(header, file_size, build);
+
+    if (!valid && !reusable_file(header, n_header, old_size))
+    {
+        close();
+        errno = EEXIST;
+        return false;
+    }
+
+    if (!valid)
+    // a new file or a cache file of another format, build or size: truncate it, the mapping object extends it to file_size (filled with 0's)
+    {
+        file_size = sizeof(t_cache_header) + (size_t)new_slots * sizeof(t_cache_slot);
+        if ((SetFilePointer(file_handle, 0, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER) || !SetEndOfFile(file_handle))
+        {
+            close();
+            errno = EIO;
+            return false;
+        }
+    }
+
+    mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READWRITE, (DWORD)((uint64_t)file_size >> 32), (DWORD)file_size, NULL);
+    if (mapping_handle != NULL)
+        mapping = MapViewOfFile(mapping_handle, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+
+    if (mapping == NULL)
+    {
+        close();
+        errno = ENOMEM;
+        return false;
+    }
+#else
+    struct stat st;
+    void* p;
+    int lock_errno;
+
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return false;
+
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+    // another process has opened the cache (EWOULDBLOCK)
+    {
+        lock_errno = errno;
+        close();
+        errno = (lock_errno == EWOULDBLOCK) ? EBUSY : lock_errno;
+        return false;
+    }
+
+    if (fstat(fd, &st) != 0)
+    {
+        close();
+        return false;
+    }
+
+    file_size = old_size = (size_t)st.st_size;
+    memset(&header, 0, sizeof(header));
+    n_header = (size_t)max(pread(fd, &header, sizeof(header), 0), (ssize_t)0);
+    valid = (n_header == sizeof(header)) && valid_header(header, file_size, build);
+
+    if (!valid && !reusable_file(header, n_header, old_size))
+    {
+        close();
+        errno = EEXIST;
+        return false;
+    }
+
+    if (!valid)
+    // a new file or a cache file of another format, build or size: truncate it and extend it with empty slots (0's)
+    {
+        file_size = sizeof(t_cache_header) + (size_t)new_slots * sizeof(t_cache_slot);
+        if ((ftruncate(fd, 0) != 0) || (ftruncate(fd, (off_t)file_size) != 0))
+        {
+            close();
+            return false;
+        }
+    }
+
+    p = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    mapping = p;
+#endif
+
+    mapping_size = file_size;
+
+    if (!valid)
+    // write the header of the new file
+    {
+        if (old_size > 0)
+            eprintf(VERB_QUIET, ERROR_COLOR "Warning:" ANSI_COLOR_RESET " %s is a cache file of another version or size, it is reinitialised.\n", filename.c_str());
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, RESULT_CACHE_MAGIC, sizeof(header.magic));
+        header.n_slots = new_slots;
+        header.slot_size = sizeof(t_cache_slot);
+        set_build(header.build, build);
+        memcpy(mapping, &header, sizeof(header));
+    }
+
+    slots = (t_cache_slot*)((char*)mapping + sizeof(t_cache_header));
+    n_buckets = header.n_slots / RESULT_CACHE_WAYS;
+    build_id = build_hash(build);
+
+    return true;
+}
+
+bool result_cache::is_open(void) const
+// returns true if the cache file is mapped
+{
+    return (slots != NULL);
+}
+
+void result_cache::close(void)
+// unmaps and unlocks the cache file, the OS writes the changed pages to the file
+{
+#if defined(_WIN32)
+    if (mapping != NULL)
+        UnmapViewOfFile(mapping);
+    if (mapping_handle != NULL)
+        CloseHandle(mapping_handle);
+    if (file_handle != INVALID_HANDLE_VALUE)
+        CloseHandle(file_handle);
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = NULL;
+#else
+    if (mapping != NULL)
+        munmap(mapping, mapping_size);
+    if (fd >= 0)
+        ::close(fd);    // releases the lock
+    fd = -1;
+#endif
+
+    slots = NULL;
+    n_buckets = 0;
+    mapping = NULL;
+    mapping_size = 0;
+}
+
+bool result_cache::lookup(const t_cache_slot& key, t_cache_slot& found)
+// copies the slot with the key of key to found, returns false if not in the cache or stored by another build
+{
+    uint32_t bucket = (uint32_t)(key.hash % n_buckets);
+    t_cache_slot* s = slots + (size_t)bucket * RESULT_CACHE_WAYS;
+    int i;
+
+    std::lock_guard<std::mutex> guard(locks[bucket % RESULT_CACHE_LOCKS]);
+
+    for (i = 0; i < RESULT_CACHE_WAYS; i++)
+        if ((s[i].hash == key.hash) && same_cache_key(s[i], key) && (s[i].build == build_id))
+        {
+            found = s[i];
+            return true;
+        }
+
+    return false;
+}
+
+void result_cache::store(const t_cache_slot& entry)
+// stores entry (with the build of this cache) in its bucket: replaces the slot with the same key, else the first empty slot,
+// else a slot chosen by the hash
+{
+    uint32_t bucket = (uint32_t)(entry.hash % n_buckets);
+    t_cache_slot* s = slots + (size_t)bucket * RESULT_CACHE_WAYS;
+    int i, victim = -1;
+
+    std::lock_guard<std::mutex> guard(locks[bucket % RESULT_CACHE_LOCKS]);
+
+    for (i = 0; i < RESULT_CACHE_WAYS; i++)
+    {
+        if ((s[i].hash == entry.hash) && same_cache_key(s[i], entry))
+        {
+            victim = i;
+            break;
+        }
+
+        if ((s[i].hash == 0) && (victim < 0))
+            victim = i;
+    }
+
+    if (victim < 0)
+        victim = (int)((entry.hash >> 32) % RESULT_CACHE_WAYS);
+
+    s[victim] = entry;
+    s[victim].build = build_id;
+}
+
+void get_cache_key(telegram* p_telegram, t_cache_slot& slot)
+// fills the key fields of slot with the user data, size and force_long of p_telegram (aligns it for the calculations)
+{
+    uint64_t h;
+    int i;
+
+    p_telegram->align(a_calc);
+
+    memset(&slot, 0, sizeof(slot));
+    slot.size = (uint32_t)p_telegram->size;
+    slot.force_long = p_telegram->force_long ? 1 : 0;
+    p_telegram->deshaped_contents.write_to_limbs(slot.userdata);
+
+    // 64-bit multiplicative hash of the key, 0 is reserved for empty slots:
+    h = ((uint64_t)slot.size << 1) | slot.force_long;
+    for (i = 0; i < longnum_userdata::LIMBS; i++)
+    {
+        h = (h ^ slot.userdata[i]) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+    }
+
+    slot.hash = (h == 0) ? 1 : h;
+}
+
+bool same_cache_key(const t_cache_slot& a, const t_cache_slot& b)
+// compares the keys of two slots
+{
+    return (a.size == b.size) && (a.force_long == b.force_long) && (memcmp(a.userdata, b.userdata, sizeof(a.userdata)) == 0);
+}
+
+bool use_cached_telegram(telegram* p_telegram)
+// looks up the shaped contents of p_telegram in shape_cache and verifies them, returns true if they can be used
+// if false, the telegram is unchanged except for its alignment and errcode
+{
+    t_cache_slot key, found;
+
+    get_cache_key(p_telegram, key);
+    if (!shape_cache.lookup(key, found))
+    {
+        shape_cache.misses++;
+        return false;
+    }
+
+    // the shaped contents must be the telegram of the user data with the SB/ESB that the search found when the slot was stored:
+    p_telegram->contents.read_from_limbs(found.shaped, longnum::LIMBS);
+    if (p_telegram->check_stored_telegram((t_sb)found.sb, (t_esb)found.esb) == ERR_NO_ERR)
+    {
+        eprintf(VERB_GLOB, "Found the shaped telegram in the cache.\n");
+        shape_cache.hits++;
+        return true;
+    }
+
+    // not valid, the telegram will be shaped:
+    eprintf(VERB_GLOB, "The shaped telegram in the cache is not valid, shaping the telegram.\n");
+    p_telegram->contents.fill(0);
+    p_telegram->errcode = ERR_NO_ERR;
+    shape_cache.rejected++;
+    return false;
+}
+
+void store_cached_telegram(telegram* p_telegram)
+// stores the shaped contents of p_telegram in shape_cache
+{
+    t_cache_slot entry;
+
+    get_cache_key(p_telegram, entry);
+    p_telegram->contents.write_to_limbs(entry.shaped);
+    entry.sb = (uint16_t)p_telegram->get_scrambling_bits();
+    entry.esb = (uint16_t)p_telegram->get_extra_shaping_bits();
+    shape_cache.store(entry);
+}
@@ -0,0 +1,111 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * result_cache - a file with the shaped telegrams of earlier runs, keyed by the user data, size and force_long
+ *
+ * Input files often contain the same user data many times (the same balise contents at many locations, re-exports of the
+ * same project). The cache file (--cache) is mapped into memory and shared by all threads: before a telegram is shaped,
+ * convert_telegram looks up its shaped contents. A hit is verified with check_stored_telegram: the SB/ESB, control bits and
+ * check bits, and the deshaped contents against the user data. The candidate checks are not repeated, the telegram is the one
+ * that passed them in the search. If the verification fails the telegram is shaped as usual.
+ * The shaped telegram is deterministic, so a hit gives the same output as shaping: the header holds the version of
+ * balise_codec that wrote the file, each slot the (hash of the) version that stored it and the SB/ESB that its search found.
+ * A slot of another version, or of which the shaped contents have other SB/ESB, is not used.
+ *
+ * The file is a set-associative table: the hash of the key selects a bucket of RESULT_CACHE_WAYS slots, a full bucket
+ * replaces one of its slots. Each bucket is protected by one of RESULT_CACHE_LOCKS mutexes. The file is locked while it is
+ * open (flock, or no sharing on Windows), a second process can not open it. An empty file, or a cache file of another format,
+ * version or size (e.g. truncated), is reinitialised with empty slots. Any other file is not changed: opening it is an error.
+*/
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "telegram.h"
+#include <mutex>
+#include <atomic>
+
+#define RESULT_CACHE_MAGIC          "SS36RC02"  // first 8 bytes of a cache file, the last 2 chars are the version of the format
+#define RESULT_CACHE_MAGIC_PREFIX   6           // nr of chars of RESULT_CACHE_MAGIC that are the same in every format
+#define RESULT_CACHE_DEFAULT_SLOTS  65536       // nr of slots of a new cache file (256 bytes each)
+#define RESULT_CACHE_BUILD_SIZE     32          // max nr of chars of the version of balise_codec in the header
+#define RESULT_CACHE_WAYS           8           // nr of slots in a bucket
+#define RESULT_CACHE_LOCKS          64          // nr of mutexes protecting the buckets
+
+typedef struct
+{
+    char        magic[8];                               // RESULT_CACHE_MAGIC
+    uint32_t    n_slots;                                // nr of slots in the file, a multiple of RESULT_CACHE_WAYS
+    uint32_t    slot_size;                              // sizeof(t_cache_slot)
+    char        build[RESULT_CACHE_BUILD_SIZE];         // the version of balise_codec that wrote the file, padded with 0's
+} t_cache_header;
+
+typedef struct
+{
+    uint64_t    hash;                                   // hash of the key, 0 = empty slot
+    uint32_t    size;                                   // key: s_long or s_short
+    uint32_t    force_long;                             // key: force_long of the telegram
+    uint32_t    build;                                  // hash of the version of balise_codec that stored the slot
+    uint16_t    sb;                                     // the SB of the shaped contents
+    uint16_t    esb;                                    // the ESB of the shaped contents
+    uint64_t    userdata[longnum_userdata::LIMBS];      // key: the user data (alignment a_calc)
+    uint64_t    shaped[longnum::LIMBS];                 // the shaped contents (alignment a_calc)
+} t_cache_slot;
+
+class result_cache
+{
+public:
+    std::atomic<uint64_t> hits, misses, rejected;      // lookups that were found, not found or found but not valid
+
+    result_cache(void);
+    ~result_cache(void);
+    result_cache(const result_cache&) = delete;
+    result_cache& operator=(const result_cache&) = delete;
+
+    bool open(const string filename, uint32_t new_slots, const string build);
+    bool is_open(void) const;
+    void close(void);
+    bool lookup(const t_cache_slot& key, t_cache_slot& found);
+    void store(const t_cache_slot& entry);
+
+private:
+    t_cache_slot*   slots;              // the slots in the mapped file, NULL if not opened
+    uint32_t        n_buckets;          // nr of buckets of RESULT_CACHE_WAYS slots
+    void*           mapping;            // the mapping of the file
+    size_t          mapping_size;       // size of the mapping in bytes
+    uint32_t        build_id;           // hash of the version of balise_codec, stored in each slot
+    std::mutex      locks[RESULT_CACHE_LOCKS];
+#if defined(_WIN32)
+    void*           file_handle;        // the handles of the file and the mapping object
+    void*           mapping_handle;
+#else
+    int             fd;                 // the file, kept open for the lock
+#endif
+};
+
+extern result_cache shape_cache;       // the cache used by convert_telegram, if opened
+
+// fills the key fields of slot with the user data, size and force_long of p_telegram (aligns it for the calculations)
+void get_cache_key(telegram* p_telegram, t_cache_slot& slot);
+
+// compares the keys of two slots
+bool same_cache_key(const t_cache_slot& a, const t_cache_slot& b);
+
+// looks up the shaped contents of p_telegram in shape_cache, returns true if found and verified (including the SB/ESB)
+bool use_cached_telegram(telegram* p_telegram);
+
+// stores the shaped contents of p_telegram in shape_cache
+void store_cached_telegram(telegram* p_telegram);
+
+#endif
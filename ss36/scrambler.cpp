@@ -0,0 +1,132 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+#include "scrambler.h"
+
+const scrambler_tables scrambler(H);
+
+scrambler_tables::scrambler_tables(t_H new_h)
+// generates the tables by running the bitwise shift register once for each possible input
+// the tables are generated once when the library is loaded, which takes a few microseconds
+{
+    int i, j;
+    t_S S, S_desc;
+    t_word out, out_desc, bit_in, bit_out;
+
+    h = new_h;
+
+    for (i = 0; i < SCRAMBLER_N_ENTRIES; i++)
+    {
+        // contribution of the input bits: start with S=0 and feed in i (MSB first, identical to scramble_transform_check_user_data)
+        S = 0;
+        S_desc = 0;
+        out = 0;
+        out_desc = 0;
+
+        for (j = SCRAMBLER_STEP - 1; j >= 0; j--)
+        {
+            bit_in = (i >> j) & 1;
+
+            bit_out = (S >> 31) ^ bit_in;
+            out |= bit_out << j;
+            S <<= 1;
+            if (bit_out)
+                S ^= h;
+
+            out_desc |= ((S_desc >> 31) ^ bit_in) << j;
+            S_desc <<= 1;
+            if (bit_in)
+                S_desc ^= h;
+        }
+
+        out_u[i] = (uint16_t)out;
+        desc_u[i] = (uint16_t)out_desc;
+
+        // contribution of the top 10 bits of S: start with S=i<<22 and feed in 0's
+        S = (t_S)i << (32 - SCRAMBLER_STEP);
+        out = 0;
+
+        for (j = SCRAMBLER_STEP - 1; j >= 0; j--)
+        {
+            bit_out = S >> 31;
+            out |= bit_out << j;
+            S <<= 1;
+            if (bit_out)
+                S ^= h;
+        }
+
+        out_s[i] = (uint16_t)out;
+
+        // feedback of the bits in i into the register:
+        feedback[i] = 0;
+        for (j = 0; j < SCRAMBLER_STEP; j++)
+            if ((i >> j) & 1)
+                feedback[i] ^= h << j;
+    }
+}
+
+t_word scrambler_tables::scramble10(t_S& S, t_word in10) const
+// scrambles the 10 bits in in10 (MSB first), returns the 10 scrambled bits and advances S with 10 steps
+{
+    t_word out10 = out_s[S >> (32 - SCRAMBLER_STEP)] ^ out_u[in10 & (SCRAMBLER_N_ENTRIES - 1)];
+
+    S = (S << SCRAMBLER_STEP) ^ feedback[out10];
+
+    return out10;
+}
+
+t_word scrambler_tables::descramble10(t_S& S, t_word in10) const
+// descrambles the 10 bits in in10 (MSB first), returns the 10 descrambled bits and advances S with 10 steps
+{
+    in10 &= SCRAMBLER_N_ENTRIES - 1;
+
+    t_word out10 = (S >> (32 - SCRAMBLER_STEP)) ^ desc_u[in10];
+
+    S = (S << SCRAMBLER_STEP) ^ feedback[in10];
+
+    return out10;
+}
+
+scrambler_keystreams::scrambler_keystreams(const scrambler_tables& tables)
+// runs the scrambler on all-zero user data for each SB, starting at S = determine_S(sb)
+// the same keystream serves long and short telegrams, as the scrambling always starts at the last word
+{
+    int sb, j;
+    t_S S;
+
+    for (sb = 0; sb < SCRAMBLER_N_SB; sb++)
+    {
+        S = telegram::determine_S((t_sb)sb);
+
+        for (j = 0; j < SCRAMBLER_MAX_WORDS; j++)
+            ks[sb][j] = (uint16_t)tables.scramble10(S, 0);
+    }
+}
+
+void scrambler_keystreams::scramble_zero_state(const longnum_userdata& U, int n_words, uint16_t* q, const scrambler_tables& tables) const
+// scrambles the n_words 10-bit words in U starting with S=0: q[j] = Q(U) of word n_words-1-j (the order of scrambling)
+// the scrambled word j for scrambling bits sb is then q[j] ^ ks[sb][j]
+{
+    int j;
+    t_S S = 0;
+
+    for (j = 0; j < n_words; j++)
+        q[j] = (uint16_t)tables.scramble10(S, U.get_word((n_words - 1 - j) * SCRAMBLER_STEP));
+}
+
+const scrambler_keystreams& get_scrambler_keystreams(void)
+// returns the keystreams, generated at the first call (thread safe: initialisation of a static local variable)
+{
+    static const scrambler_keystreams keystreams(scrambler);
+
+    return keystreams;
+}
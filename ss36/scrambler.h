@@ -0,0 +1,72 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * scrambler - table driven implementation of the scrambler described in subset 36, paragraph 4.3.2.2, step 3
+ *
+ * The scrambler is a 32-bit shift register S with coefficients H, of which the output bit is fed back into the register:
+ *      t = S>>31; out = t ^ in; S <<= 1; if (out) S ^= H;
+ * All of these operations are linear in GF(2), so after 10 steps:
+ * - the 10 output bits only depend on the top 10 bits of S and on the 10 input bits: out = out_s[S>>22] ^ out_u[in]
+ * - the new S is the old S shifted 10 bits, xor-ed with the shifted H's triggered by the output bits: S = (S<<10) ^ feedback[out]
+ * The descrambler feeds back the input bit instead of the output bit, so: out = (S>>22) ^ desc_u[in]; S = (S<<10) ^ feedback[in]
+ * This replaces 10 iterations of the bitwise shift register by 3 table lookups, see paragraph 3.1 in the article of ZHUO Peng.
+ *
+ * The complete scrambler is linear in GF(2) in both S and the user bits U, so the scrambled words are:
+ *      scramble(S, U) = scramble(S, 0) ^ scramble(0, U) = K[SB] ^ Q(U)
+ * The keystream K[SB] only depends on the scrambling bits, so it is calculated once for all 4096 SB (scrambler_keystreams).
+ * Q(U) only depends on the user data and is calculated once per telegram. Scrambling a word for a new SB is then one xor.
+*/
+
+#ifndef SCRAMBLER_H
+#define SCRAMBLER_H
+
+#include "telegram.h"
+
+#define SCRAMBLER_STEP      10                      // nr of bits processed per table lookup (=one 10-bit user word)
+#define SCRAMBLER_N_ENTRIES (1 << SCRAMBLER_STEP)   // nr of entries in each table
+#define SCRAMBLER_N_SB      (1 << N_SB)             // nr of possible values of the scrambling bits
+#define SCRAMBLER_MAX_WORDS (N_USERBITS_L / SCRAMBLER_STEP)     // nr of 10-bit words in the user data of a long telegram
+
+class scrambler_tables
+{
+public:
+    t_H             h;                                  // the coefficients with which the tables were generated
+    uint16_t        out_s[SCRAMBLER_N_ENTRIES];         // contribution of the top 10 bits of S to the 10 scrambled bits
+    uint16_t        out_u[SCRAMBLER_N_ENTRIES];         // contribution of the 10 user bits to the 10 scrambled bits
+    uint16_t        desc_u[SCRAMBLER_N_ENTRIES];        // contribution of the 10 scrambled bits to the 10 descrambled bits
+    t_S             feedback[SCRAMBLER_N_ENTRIES];      // xor of H<<j for each bit j that is fed back into the register
+
+    scrambler_tables(t_H new_h);
+
+    t_word scramble10(t_S& S, t_word in10) const;
+    t_word descramble10(t_S& S, t_word in10) const;
+};
+
+// the tables for the coefficients H of subset 36:
+extern const scrambler_tables scrambler;
+
+class scrambler_keystreams
+{
+public:
+    uint16_t        ks[SCRAMBLER_N_SB][SCRAMBLER_MAX_WORDS];    // scrambled words of all-zero user data for each SB, in the order of scrambling (last word first)
+
+    scrambler_keystreams(const scrambler_tables& tables);
+
+    void scramble_zero_state(const longnum_userdata& U, int n_words, uint16_t* q, const scrambler_tables& tables) const;
+};
+
+// returns the keystreams of the tables in scrambler (680kB), which are generated at the first call
+const scrambler_keystreams& get_scrambler_keystreams(void);
+
+#endif
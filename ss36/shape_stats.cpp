@@ -0,0 +1,126 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+#include "shape_stats.h"
+#include "useful_functions.h"
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+
+bool stats_enabled = false;
+thread_local shape_stats thread_stats;
+
+static shape_stats total_stats;         // the merged counts of all threads
+static std::mutex total_stats_lock;
+
+static const char* counter_names[STAT_N_COUNTERS] = { "sb_tried", "sb_ospc_reject", "esb_tried", "check_bits_reuse", "check_bits_full",
+    "alphabet_reject", "off_synch_reject", "aperiodicity_reject", "undersampling_reject", "candidate_passed" };
+static const char* timer_names[STAT_N_TIMERS] = { "scramble_ospc", "check_bits", "alphabet", "off_synch", "aperiodicity", "undersampling" };
+
+shape_stats::shape_stats()
+// creates the counters, all 0
+{
+    clear();
+}
+
+void shape_stats::clear(void)
+// sets all counters and timers to 0
+{
+    memset(count, 0, sizeof(count));
+    memset(ns, 0, sizeof(ns));
+}
+
+void shape_stats::add(const shape_stats& other)
+// adds the counters and timers of other
+{
+    int i;
+
+    for (i = 0; i < STAT_N_COUNTERS; i++)
+        count[i] += other.count[i];
+
+    for (i = 0; i < STAT_N_TIMERS; i++)
+        ns[i] += other.ns[i];
+}
+
+void stats_merge_thread(void)
+// adds the counts of this thread to the total and clears them
+{
+    if (!stats_enabled)
+        return;
+
+    std::lock_guard<std::mutex> guard(total_stats_lock);
+    total_stats.add(thread_stats);
+    thread_stats.clear();
+}
+
+shape_stats get_shape_stats(void)
+// returns the total of the merged counts
+{
+    std::lock_guard<std::mutex> guard(total_stats_lock);
+    return total_stats;
+}
+
+static double percentage(uint64_t part, uint64_t total)
+// returns part as a percentage of total, 0 if total is 0
+{
+    return total ? 100.0 * part / total : 0.0;
+}
+
+void print_shape_stats(int v, const shape_stats& stats)
+// prints the total as a table: the counters with their rate, the time per stage
+{
+    const uint64_t* c = stats.count;
+    uint64_t candidates = c[stat_esb_tried], total_ns = 0;
+    int i;
+
+    for (i = 0; i < STAT_N_TIMERS; i++)
+        total_ns += stats.ns[i];
+
+    eprintf(v, "Shaping statistics:\n");
+    eprintf(v, "  scrambling bits tried:             %12llu\n", (unsigned long long)c[stat_sb_tried]);
+    eprintf(v, "  rejected by OSPC while scrambling: %12llu (%.1f%%)\n", (unsigned long long)c[stat_sb_ospc_reject], percentage(c[stat_sb_ospc_reject], c[stat_sb_tried]));
+    eprintf(v, "  candidates (ESB tried):            %12llu (%.2f per accepted SB)\n", (unsigned long long)candidates,
+        (c[stat_sb_tried] > c[stat_sb_ospc_reject]) ? (double)candidates / (c[stat_sb_tried] - c[stat_sb_ospc_reject]) : 0.0);
+    eprintf(v, "  check bits from intermediate:      %12llu (hit rate %.1f%%)\n", (unsigned long long)c[stat_check_bits_reuse],
+        percentage(c[stat_check_bits_reuse], c[stat_check_bits_reuse] + c[stat_check_bits_full]));
+    eprintf(v, "  rejected by alphabet:              %12llu (%.1f%%)\n", (unsigned long long)c[stat_alphabet_reject], percentage(c[stat_alphabet_reject], candidates));
+    eprintf(v, "  rejected by off-synch-parsing:     %12llu (%.1f%%)\n", (unsigned long long)c[stat_off_synch_reject], percentage(c[stat_off_synch_reject], candidates));
+    eprintf(v, "  rejected by aperiodicity:          %12llu (%.1f%%)\n", (unsigned long long)c[stat_aperiodicity_reject], percentage(c[stat_aperiodicity_reject], candidates));
+    eprintf(v, "  rejected by undersampling:         %12llu (%.1f%%)\n", (unsigned long long)c[stat_undersampling_reject], percentage(c[stat_undersampling_reject], candidates));
+    eprintf(v, "  passed all checks:                 %12llu\n", (unsigned long long)c[stat_candidate_passed]);
+    eprintf(v, "Time per stage (all threads):\n");
+
+    for (i = 0; i < STAT_N_TIMERS; i++)
+        eprintf(v, "  %-34s %9.3f ms (%.1f%%)\n", timer_names[i], stats.ns[i] / 1e6, percentage(stats.ns[i], total_ns));
+}
+
+bool write_shape_stats_json(const shape_stats& stats, const string filename)
+// writes the counters and timers as JSON to filename
+{
+    FILE* f = fopen(filename.c_str(), "w");
+    int i;
+
+    if (f == NULL)
+        return false;
+
+    fprintf(f, "{\n  \"counters\": {\n");
+    for (i = 0; i < STAT_N_COUNTERS; i++)
+        fprintf(f, "    \"%s\": %llu%s\n", counter_names[i], (unsigned long long)stats.count[i], (i + 1 < STAT_N_COUNTERS) ? "," : "");
+
+    fprintf(f, "  },\n  \"ns\": {\n");
+    for (i = 0; i < STAT_N_TIMERS; i++)
+        fprintf(f, "    \"%s\": %llu%s\n", timer_names[i], (unsigned long long)stats.ns[i], (i + 1 < STAT_N_TIMERS) ? "," : "");
+
+    fprintf(f, "  }\n}\n");
+
+    return (fclose(f) == 0);
+}
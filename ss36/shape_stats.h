@@ -0,0 +1,111 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * shape_stats - counters and timers of the stages of the shaping search (see telegram::search_sb_esb)
+ *
+ * The counters are always compiled in, but only updated if stats_enabled is set (--stats): when disabled, each
+ * counter costs one test of a global bool. Each thread counts in its own thread_local shape_stats (no sharing,
+ * no atomics). The conversion functions add the counts of a thread to the global total at the end of each task
+ * (stats_merge_thread), the total is read with get_shape_stats.
+ *
+ * The counters show where the candidates are rejected: the scrambling bits that fail the off-synch-parsing check
+ * during scrambling, the ESB's tried per scrambling bits, the reuse of the intermediate result of the check bits
+ * and the candidates rejected by each check of perform_candidate_checks. The timers add the time spent in each stage.
+*/
+
+#ifndef SHAPE_STATS_H
+#define SHAPE_STATS_H
+
+#include <stdint.h>
+#include <string>
+#include <chrono>
+
+using namespace std;
+
+enum t_stat_counter
+{
+    stat_sb_tried,                  // scrambling bits tried
+    stat_sb_ospc_reject,            // scrambling bits rejected by the off-synch-parsing check during scrambling
+    stat_esb_tried,                 // extra shaping bits tried (= candidate telegrams)
+    stat_check_bits_reuse,          // check bits calculated from the intermediate result of the same scrambling bits
+    stat_check_bits_full,           // check bits calculated from the complete telegram
+    stat_alphabet_reject,           // candidates rejected by the alphabet condition
+    stat_off_synch_reject,          // candidates rejected by the off-synch-parsing condition
+    stat_aperiodicity_reject,       // candidates rejected by the aperiodicity condition
+    stat_undersampling_reject,      // candidates rejected by the undersampling condition
+    stat_candidate_passed,          // candidates that passed all checks
+    STAT_N_COUNTERS
+};
+
+enum t_stat_timer
+{
+    timer_scramble_ospc,            // scrambling and transforming the user data, with the off-synch-parsing check
+    timer_check_bits,               // calculating the check bits
+    timer_alphabet,                 // checking the alphabet condition
+    timer_off_synch,                // checking the off-synch-parsing condition
+    timer_aperiodicity,             // checking the aperiodicity condition
+    timer_undersampling,            // checking the undersampling condition
+    STAT_N_TIMERS
+};
+
+class shape_stats
+{
+public:
+    uint64_t count[STAT_N_COUNTERS];
+    uint64_t ns[STAT_N_TIMERS];         // nanoseconds spent in each stage
+
+    shape_stats();
+    void clear(void);
+    void add(const shape_stats& other);
+};
+
+extern bool stats_enabled;                      // update the counters and timers, set before the conversion starts
+extern thread_local shape_stats thread_stats;   // the counts of this thread since its last stats_merge_thread
+
+inline void stats_count(t_stat_counter c)
+// adds one to counter c of this thread
+{
+    if (stats_enabled)
+        thread_stats.count[c]++;
+}
+
+inline int64_t stats_start(void)
+// returns the start time of a stage in ns, 0 if the stats are disabled
+{
+    if (!stats_enabled)
+        return 0;
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void stats_stop(t_stat_timer t, int64_t start)
+// adds the time since start (see stats_start) to timer t of this thread
+{
+    if (stats_enabled)
+        thread_stats.ns[t] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() - start;
+}
+
+// adds the counts of this thread to the total and clears them
+void stats_merge_thread(void);
+
+// returns the total of the merged counts
+shape_stats get_shape_stats(void);
+
+// prints the total as a table (verbosity v)
+void print_shape_stats(int v, const shape_stats& stats);
+
+// writes the total as JSON to filename, returns false if the file could not be written
+bool write_shape_stats_json(const shape_stats& stats, const string filename);
+
+#endif
@@ -12,6 +12,11 @@
 
 #include "transformation_words.h"
 #include "telegram.h"
+#include "scrambler.h"
+#include "check_bits.h"
+#include "undersampling.h"
+#include "text_codec.h"
+#include "shape_stats.h"
 
 telegram::telegram(const string inputstr, enum t_size newsize)
 // creates and initialises a new telegram
@@ -34,7 +39,7 @@ telegram::telegram(const string inputstr, enum t_size newsize)
 telegram::telegram(const telegram* p_telegram)
 // creates a new telegram, copies the contents from p_telegram
 {
-    memcpy(this, p_telegram, sizeof(telegram));
+    *this = *p_telegram;
 }
 
 telegram::~telegram(void)
@@ -47,6 +52,7 @@ void telegram::set_size(enum t_size newsize)
 // sets the new size of the telegram, updates the relevant variables
 {
     size = newsize;
+    intermediate_sb = NO_SB;    // the intermediate check bits calculation depends on the size
 
     if (newsize == s_long)
     {
@@ -90,101 +96,86 @@ void telegram::make_userdata_long()
     deshaped_contents.print_fancy(VERB_ALL, 16, number_of_userbits, NULL);
 }
 
-void telegram::parse_input(const string inputstr)
+void telegram::parse_input(string_view input)
 // parses the input line into the telegram. This is either a hex or base64 encoded string of the correct length (see below)
-// input has to be clean (i.e. no \r\t\n or spaces) and zero-terminated.
-// sets the errorcode of the telegram to ERR_INPUT_ERROR if a parsing error occurred.
+// input has to be clean (i.e. no \r\t\n or spaces). It is not copied: a view on the line is enough.
+// sets the errorcode of the telegram to ERR_INPUT_ERROR if a parsing error occurred (wrong length or illegal chars).
 // for each variant:
-//  - parse the char string into a byte string (so from base64/hex -> binary)
-//  - convert the byte string to a longnum 
+//  - validate and decode the chars into a byte string (so from base64/hex -> binary), see text_codec.h
+//  - convert the byte string to the longnum, shifted straight to the alignment a_calc
 //  - sets the values of telegram
-
-// TBD: check inputstr for illegal chars
 {
-    uint8_t arr[MAX_ARRAY_SIZE] = { 0 };   // temporary array to hold the byte array
-    int arrsize = 0;                       // #bytes in the temp array
+    uint8_t arr[MAX_ARRAY_SIZE];    // temporary array to hold the byte array
+    int arrsize = -1;               // #bytes in the temp array, -1 if the input contains illegal chars
+    bool shaped = true, hex = true;
 
     // first find out what kind of input line we have by switching between the length:
-    switch (inputstr.length())
+    switch (input.length())
     {
         case N_CHARS_SHAPED_LONG_HEX:
             set_size(s_long);
-            arrsize = hex_to_bin(inputstr, arr);
-            if (arrsize != -1)
-                contents.read_from_array(arr, arrsize);
-            else
-                errcode = ERR_INPUT_ERROR;
             break;
 
         case N_CHARS_SHAPED_SHORT_HEX:
             set_size(s_short);
-            arrsize = hex_to_bin(inputstr, arr);
-            if (arrsize != -1)
-                contents.read_from_array(arr, arrsize);
-            else
-                errcode = ERR_INPUT_ERROR;
             break;
 
         case N_CHARS_SHAPED_LONG_BASE64:
             set_size(s_long);
-            arrsize = b64_decode(inputstr, arr);
-            if (arrsize != -1)
-                contents.read_from_array(arr, arrsize);
-            else
-                errcode = ERR_INPUT_ERROR;
+            hex = false;
             break;
 
         case N_CHARS_SHAPED_SHORT_BASE64:
             set_size(s_short);
-            arrsize = b64_decode(inputstr, arr);
-            if (arrsize != -1)
-                contents.read_from_array(arr, arrsize);
-            else
-                errcode = ERR_INPUT_ERROR;            break;
+            hex = false;
+            break;
 
         case N_CHARS_UNSHAPED_LONG_HEX:
             set_size(s_long);
-            arrsize = hex_to_bin(inputstr, arr);
-            if (arrsize != -1)
-                deshaped_contents.read_from_array(arr, arrsize);
-            else
-                errcode = ERR_INPUT_ERROR;
+            shaped = false;
             break;
 
         case N_CHARS_UNSHAPED_SHORT_HEX:
             set_size(s_short);
-            arrsize = hex_to_bin(inputstr, arr);
-            if (arrsize != -1)
-                deshaped_contents.read_from_array(arr, arrsize);
-            else
-                errcode = ERR_INPUT_ERROR;
+            shaped = false;
             break;
 
         case N_CHARS_UNSHAPED_LONG_BASE64:
             set_size(s_long);
-            arrsize = b64_decode(inputstr, arr);
-            if (arrsize != -1)
-                deshaped_contents.read_from_array(arr, arrsize);
-            else
-                errcode = ERR_INPUT_ERROR;
+            shaped = false;
+            hex = false;
             break;
 
         case N_CHARS_UNSHAPED_SHORT_BASE64:
             set_size(s_short);
-            arrsize = b64_decode(inputstr, arr);
-            if (arrsize != -1)
-                deshaped_contents.read_from_array(arr, arrsize);
-            else
-                errcode = ERR_INPUT_ERROR;
+            shaped = false;
+            hex = false;
             break;
 
         default:
-            eprintf(VERB_GLOB, ERROR_COLOR "\nError parsing string" ANSI_COLOR_RESET " \"%s\" of %zd chars.\n", inputstr.c_str(), inputstr.length());
+            eprintf(VERB_GLOB, ERROR_COLOR "\nError parsing string" ANSI_COLOR_RESET " \"%.*s\" of %zd chars.\n", (int)input.length(), input.data(), input.length());
             errcode = ERR_INPUT_ERROR;
+            return;
     }
 
-    // set the alignment of the telegram to encoding:
-    alignment = a_enc;
+    if (hex)
+        arrsize = get_decode_hex()(input.data(), (int)input.length() / 2, arr) ? (int)input.length() / 2 : -1;
+    else
+        arrsize = get_decode_base64()(input.data(), (int)input.length(), arr);
+
+    if (arrsize == -1)
+    {
+        errcode = ERR_INPUT_ERROR;
+        return;
+    }
+
+    // read the bytes in the alignment a_calc: drop the bits below the byte border (see align)
+    if (shaped)
+        contents.read_from_array(arr, arrsize, 8 - size % 8);
+    else
+        deshaped_contents.read_from_array(arr, arrsize, 8 - number_of_userbits % 8);
+
+    alignment = a_calc;
 }
 
 void telegram::set_checkbits (const t_checkbits checkbits)
@@ -193,7 +184,7 @@ void telegram::set_checkbits (const t_checkbits checkbits)
     contents.write_at_location (0, checkbits, N_CHECKBITS);
 }
 
-void telegram::get_checkbits (longnum& checkbits) const
+void telegram::get_checkbits (longnum_checkbits& checkbits) const
 // reads the checkbits from contents, places them in checkbits
 {
     int i;
@@ -321,7 +312,7 @@ void telegram::align(enum t_align new_alignment)
     alignment = new_alignment;
 }
 
-void telegram::determine_U_tick (longnum& Utick)
+void telegram::determine_U_tick (longnum_userdata& Utick)
 // calculates U'(k-1) from U (=telegram contents) and writes it to U (see subset 36, paragraph 4.3.2.2, step 1)
 {
     t_word sum=0;
@@ -487,104 +478,151 @@ int telegram::check_ospc(unsigned int i, unsigned int n_offsets, )
 }
 */
 
-int telegram::scramble_transform_check_user_data(t_S S, t_H H, const longnum& user_data_orig)   
+int telegram::scramble_transform_check_user_data(t_S S, t_H H, const longnum_userdata& user_data_orig)   
 // scrambles the data in user_data_orig into contents (see subset 36, paragraph 4.3.2.2, step 3)
-// TBD optimisation: create a persistent (8 bits or 10 bits) lookup table for the current S. This will give an optimisation as this function may be called many times for a certain telegram.
-// If 10 bits, this can be combined with the 11-bit lookup and candidate checks.
-// see paragraph 3.1 in article of ZHUO Peng
+// uses the 10-bit lookup tables in scrambler.h to advance the shift register one 10-bit word at a time, see paragraph 3.1 in article of ZHUO Peng.
+// falls back to the bitwise shift register if H differs from the H with which the tables were generated.
 // checks the ERR_OFF_SYNCH_PARSING during scrambling and returns the error as soon as such an error occurred
 // Note: according to ZHUO Peng, checking the "Aperiodicity Condition for Long Format" is a very small optimisation (1%, see description @ step 4) and is therefore skipped
 {
     int i, j;
     int user_bit, t, sb, m_index = number_of_userbits;
-    t_word val10, val11, lookatword;
-    
-    // vars needed for greedy algorithm:
-    int offset_index = 0;
-    int cvw_offsets[] = { 1, 10, 9, 2 , 8, 3, 7, 4, 6, 5 };  
-    int i_start = number_of_userbits / 10 - 1;   // start one word before the number_of_userbits
-    int i_last_nvw[] = { i_start, i_start, i_start, i_start, i_start, i_start, i_start, i_start, i_start, i_start };
-    int i_vw, max_cvw = 2, n_cvw = sizeof(cvw_offsets) / sizeof(cvw_offsets[0]);
+    t_word val10;
+    int i_last_nvw[N_OSPC_OFFSETS];     // state of the greedy algorithm, see transform_check_word
+
+    init_greedy_ospc(i_last_nvw);
     
-    for (i = i_start; i >= 0; i--)
+    for (i = number_of_userbits / 10 - 1; i >= 0; i--)
     // outer loop running over the 10-bit words, starting with the last word
     {
-        val10 = 0;
-        for (j = 9; j >= 0; j--)
-        // inner loop, iterating over the bits in the current 10-bit word
+        if (H == scrambler.h)
+        // scramble the complete 10-bit word using the lookup tables
         {
-            m_index--;  // keep track of the current bit 
-            user_bit = user_data_orig.get_bit(m_index);
-            t = (char)(S >> 31);
-            sb = t ^ user_bit;
-            val10 += sb << j;
-
-            S <<= 1;
-            if (sb)
-                S ^= H;
+            m_index -= 10;
+            val10 = scrambler.scramble10(S, user_data_orig.get_word(m_index));
+        }
+        else
+        {
+            val10 = 0;
+            for (j = 9; j >= 0; j--)
+            // inner loop, iterating over the bits in the current 10-bit word
+            {
+                m_index--;  // keep track of the current bit 
+                user_bit = user_data_orig.get_bit(m_index);
+                t = (char)(S >> 31);
+                sb = t ^ user_bit;
+                val10 += sb << j;
+
+                S <<= 1;
+                if (sb)
+                    S ^= H;
+            }
         }
 
-        // 10 bits calculated, find the corresponding transformation word and write it to the correct position:
-        val11 = (t_word)transformation_words[val10];
-        contents.write_at_location(i * 11 + OFFSET_SHAPED_DATA, &val11, 11);
-        // print the current status:
-        eprintf(VERB_ALL, "#userbits=%d, i=%d, m_index=%d\n", number_of_userbits, i, m_index);
-        print_contents_fancy(VERB_ALL);
+        if (transform_check_word(i, val10, i_last_nvw) != ERR_NO_ERR)
+            return ERR_OFF_SYNCH_PARSING;
+    }
+    
+    eprintf(VERB_ALL, "OSPC check passed!\n");
+    return ERR_NO_ERR;
+}
 
-        for (offset_index = 0; offset_index < n_cvw; offset_index++)
-        // Iterate over the offsets; check the OSPC for each offset using a greedy algorithm
-        {        
-            // determine the max allowed cvw for this case:
-            // not needed if only the first two offsets are checked
-            if (offset_index <= 1) // offsets -1, 1
-                    max_cvw = 2;
-            else  // cases 2..9:
-                if (size == s_long)
-                    max_cvw = 10;
-                else
-                    max_cvw = 6;
-        
-            if ((i == i_last_nvw[offset_index] - (max_cvw + 1)) && (i_last_nvw[offset_index] >= (max_cvw + 1)))
-            // Max nr of words away from last non-valid word and not yet at the end; see if there are any other non-valid words amongst them
-            // store the position of the last non-valid word in the i_last_nvw-array
+int telegram::transform_check_keystream(const uint16_t* q, const uint16_t* ks)
+// identical to scramble_transform_check_user_data with the coefficients H of subset 36, but the scrambled words are
+// q[j] ^ ks[j]: q = the user data scrambled with S=0 and ks = the keystream of the current SB (see scrambler.h)
+// q and ks start with the last word of the user data
+{
+    int i, j = 0;
+    int i_last_nvw[N_OSPC_OFFSETS];     // state of the greedy algorithm, see transform_check_word
+
+    init_greedy_ospc(i_last_nvw);
+
+    for (i = number_of_userbits / 10 - 1; i >= 0; i--, j++)
+        if (transform_check_word(i, q[j] ^ ks[j], i_last_nvw) != ERR_NO_ERR)
+            return ERR_OFF_SYNCH_PARSING;
+
+    eprintf(VERB_ALL, "OSPC check passed!\n");
+    return ERR_NO_ERR;
+}
+
+void telegram::init_greedy_ospc(int* i_last_nvw) const
+// initialises the state of the greedy algorithm in transform_check_word: the last non-valid word of each offset
+// starts one word before the number_of_userbits
+{
+    int offset_index;
+
+    for (offset_index = 0; offset_index < N_OSPC_OFFSETS; offset_index++)
+        i_last_nvw[offset_index] = number_of_userbits / 10 - 1;
+}
+
+int telegram::transform_check_word(int i, t_word val10, int* i_last_nvw)
+// transforms the scrambled 10-bit word val10 into its transformation word and writes it to the i-th 11-bit word of the shaped data
+// then checks the OSPC for all offsets using a greedy algorithm. The words must be offered from the last word (i = number_of_userbits/10-1) down to 0.
+// i_last_nvw holds the state of the greedy algorithm (see init_greedy_ospc)
+// returns ERR_OFF_SYNCH_PARSING as soon as the OSPC fails, or ERR_NO_ERR
+{
+    static const int cvw_offsets[N_OSPC_OFFSETS] = { 1, 10, 9, 2 , 8, 3, 7, 4, 6, 5 };  
+    int offset_index, i_vw, max_cvw;
+    t_word val11, lookatword;
+
+    // 10 bits calculated, find the corresponding transformation word and write it to the correct position:
+    val11 = (t_word)transformation_words[val10];
+    contents.write_at_location(i * 11 + OFFSET_SHAPED_DATA, &val11, 11);
+    // print the current status:
+    eprintf(VERB_ALL, "#userbits=%d, i=%d\n", number_of_userbits, i);
+    print_contents_fancy(VERB_ALL);
+
+    for (offset_index = 0; offset_index < N_OSPC_OFFSETS; offset_index++)
+    // Iterate over the offsets; check the OSPC for each offset using a greedy algorithm
+    {        
+        // determine the max allowed cvw for this case:
+        if (offset_index <= 1) // offsets -1, 1
+                max_cvw = 2;
+        else  // cases 2..9:
+            if (size == s_long)
+                max_cvw = 10;
+            else
+                max_cvw = 6;
+    
+        if ((i == i_last_nvw[offset_index] - (max_cvw + 1)) && (i_last_nvw[offset_index] >= (max_cvw + 1)))
+        // Max nr of words away from last non-valid word and not yet at the end; see if there are any other non-valid words amongst them
+        // store the position of the last non-valid word in the i_last_nvw-array
+        {
+            for (i_vw = i; i_vw < i_last_nvw[offset_index]; i_vw++)
             {
-                for (i_vw = i; i_vw < i_last_nvw[offset_index]; i_vw++)
+                lookatword = contents.get_word_wraparound(size, i_vw * 11 + OFFSET_SHAPED_DATA + cvw_offsets[offset_index]) & 0x7FF;
+
+                if (verbose >= VERB_ALL)
                 {
-                    lookatword = contents.get_word_wraparound(size, i_vw * 11 + OFFSET_SHAPED_DATA + cvw_offsets[offset_index]) & 0x7FF;
-
-                    if (verbose >= VERB_ALL)
-                    {
-                        printf("offset=%d; bit=%d; ", cvw_offsets[offset_index], i_vw * 11 + OFFSET_SHAPED_DATA + cvw_offsets[offset_index]);
-                        print_bin(VERB_ALL, lookatword, 11);
-                        printf(" = octal %o", lookatword);
-                    }
-
-                    if (find11(lookatword) == NO_TW)
-                    // current word is no transformation word, point i_last_nvw to this word
-                    {
-                        i_last_nvw[offset_index] = i_vw;
-                        eprintf(VERB_ALL, "; Transformation word: no\n");
-                        break;
-                    }
-                    else
-                        eprintf(VERB_ALL, "; Transformation word: yes\n");
+                    printf("offset=%d; bit=%d; ", cvw_offsets[offset_index], i_vw * 11 + OFFSET_SHAPED_DATA + cvw_offsets[offset_index]);
+                    print_bin(VERB_ALL, lookatword, 11);
+                    printf(" = octal %o", lookatword);
                 }
 
-                if (i == i_last_nvw[offset_index] - (max_cvw + 1))
-                // more than max nr of cvw's found
+                if (find11(lookatword) == NO_TW)
+                // current word is no transformation word, point i_last_nvw to this word
                 {
-                    eprintf(VERB_ALL, "OSPC check failed\n");
-                    return ERR_OFF_SYNCH_PARSING;
+                    i_last_nvw[offset_index] = i_vw;
+                    eprintf(VERB_ALL, "; Transformation word: no\n");
+                    break;
                 }
+                else
+                    eprintf(VERB_ALL, "; Transformation word: yes\n");
             }
-        } 
-    }
-    
-    eprintf(VERB_ALL, "OSPC check passed!\n");
+
+            if (i == i_last_nvw[offset_index] - (max_cvw + 1))
+            // more than max nr of cvw's found
+            {
+                eprintf(VERB_ALL, "OSPC check failed\n");
+                return ERR_OFF_SYNCH_PARSING;
+            }
+        }
+    } 
+
     return ERR_NO_ERR;
 }
 
-int telegram::transform11to10 (longnum& userdata) 
+int telegram::transform11to10 (longnum_userdata& userdata) 
 // performs the transformation from 11 bits back to 10 bits; returns ERR_11_10_BIT if an error occurred (11-bit value not found in list) or ERR_NO_ERR if no errors occurred
 // reads transformed data from telegram contents (from OFFSET_SHAPED_DATA), writes the original user data to userdata starting at bit 0
 // see subset 36, paragraph 4.3.2.3
@@ -611,14 +649,26 @@ int telegram::transform11to10 (longnum& userdata)
     return ERR_NO_ERR; 
 }
 
-void telegram::descramble (t_S S, t_H H, longnum& user_data, int m)
+void telegram::descramble (t_S S, t_H H, longnum_userdata& user_data, int m)
 // descrambles the scrambled data in user_data, writes the descrambled data back to userdata
 // S contains the start values of the shift register, H are the coefficients and m is the amount of bits to be decoded
+// uses the 10-bit lookup tables in scrambler.h for the whole 10-bit words, the remaining bits (if any) are descrambled bit by bit
 {
     int i;
     char descrambled_bit, t, scrambled_bit;
+    t_word val10;
 
-    for (i=m-1; i>=0; i--)
+    i = m - 1;
+
+    if (H == scrambler.h)
+        for (; i >= SCRAMBLER_STEP - 1; i -= SCRAMBLER_STEP)
+        // descramble 10 bits at a time, starting with the highest word
+        {
+            val10 = scrambler.descramble10(S, user_data.get_word(i - SCRAMBLER_STEP + 1));
+            user_data.write_at_location(i - SCRAMBLER_STEP + 1, val10, SCRAMBLER_STEP);
+        }
+
+    for (; i>=0; i--)
     {
         scrambled_bit = user_data.get_bit (i);
         t = (char)(S>>31);  // get current output of the shiftregister
@@ -634,7 +684,7 @@ void telegram::descramble (t_S S, t_H H, longnum& user_data, int m)
     }
 }
 
-void telegram::calc_first_word (longnum& U, unsigned int m)
+void telegram::calc_first_word (longnum_userdata& U, unsigned int m)
 // calculates the first 10-bit word in the descrambled U, which is known in subset 36 (see 4.3.2.2) as U'(k-1)
 // m is the amount of user bits (830 or 210), so k=m/10 (0..83/21)
 // U'(k-1) = sum(U(k-1..0)) = U(k-1) + sum(U(k-2..0))
@@ -755,12 +805,13 @@ void telegram::compute_check_bits_opt(void)
 // input: a filled telegram (check bits already present will be overwritten)
 // output: the checkbits in bit 0..84 of the telegram
 // note that (as both f and g are constants), g and f*g are used, rather than calculating f*g at each run from f and g
+// the division by f*g is table driven, 32 bits at a time; a change of the ESB only costs two table lookups (see check_bits.h)
 // does not return an error code as this always works
-// tbd optimisation?: use lookup table 
 {
-    longnum remainder, checkbits; 
-    int shift, i;
-    longnum g, fg;
+    const check_bits_tables& tables = (size == s_long) ? check_bits_long : check_bits_short;
+    t_remainder remainder;
+    longnum_checkbits checkbits;
+    int i;
 
     // clear the lower 85 bits [0..84] from the input telegram, needed for the calculation:
     contents[0] = 0;            // bit [0..31]
@@ -770,68 +821,38 @@ void telegram::compute_check_bits_opt(void)
     eprintf(VERB_ALL, HEADER_COLOR "\nCalculating check bits:\n" ANSI_COLOR_RESET);
     eprintf(VERB_ALL, FIELD_COLOR "Input telegram:\t" ANSI_COLOR_RESET); print_contents_fancy(VERB_ALL);
 
-    // determine the inputs to the calculation (kept here instead of moving them to ss36.h):
-    if (size == s_long)
-    {
-        // polynomials for a long telegram:
-//        f[0] = 0b11011011111;  // not used, using fg instead
-
-        g[0] = 0b11010101001000111011101000010011;
-        g[1] = 0b01110011100110100111101000101110;
-        g[2] = 0b101110001000;
-
-        // calculated f*g: 0x003EC171 890C6F72 C063B091
-        fg[0] = 0xC063B091;
-        fg[1] = 0x890C6F72;
-        fg[2] = 0x003EC171;
-    }
-    else
-    {
-        // polynomials for a short telegram:
-//        f[0] = 0b10110101011;  // not used, using fg instead
-
-        g[0] = 0b11001010010010100011110001001011;
-        g[1] = 0b10010000110000101111111011110111;
-        g[2] = 0b100111110111;
-
-        // calculated f*g: 0x002BB94D 87757959 021B6D65, with order 86
-        fg[0] = 0x021B6D65;
-        fg[1] = 0x87757959;
-        fg[2] = 0x002BB94D;
-    }
-
     // See if the previously calculated intermediate can be used
     if (get_scrambling_bits() == intermediate_sb)  
-    // already calculated the remainder up to the ESB. Copy the intermediate result, set the right ESB's and continue the calculation
+    // already calculated the remainder of the telegram with ESB=0 for these SB
     {
-        remainder = intermediate;
-        remainder.write_at_location(N_CHECKBITS, get_extra_shaping_bits(), N_ESB);
         eprintf(VERB_ALL, "Reused intermediate calculation for ESB=%d.\n", intermediate_sb); //intermediate.print_bin(VERB_GLOB);
+        stats_count(stat_check_bits_reuse);
     }
     else
-    // No previous calculation for the current SB; copy telegram contents into remainder
-        remainder = contents;
-
-    // Perform the calculation (GF2 division, from which only the remainder is relevant)
-    for (i = remainder.get_order(); i >= FG_ORDER; i--)
+    // No previous calculation for the current SB; calculate the remainder of the telegram with ESB=0 and store the intermediate result
     {
-        shift = i - FG_ORDER;
-        if (remainder.get_bit(i - 1))
-            remainder ^= fg << shift;
-
-        if (i == N_CHECKBITS + N_ESB + FG_ORDER)
-        // calculated everything up to the Extra Shaping Bits, store the intermediate result
-        {
-            intermediate = remainder;
-            intermediate_sb = get_scrambling_bits();
-            eprintf(VERB_ALL, "Stored intermediate calculation for ESB=%d: \n",intermediate_sb); intermediate.print_bin(VERB_ALL);
-        }
-
-        //eprintf(VERB_ALL, "\ni=%d; shift=%d; \nremainder=", i, shift); remainder.print_bin(VERB_GLOB); 
+        stats_count(stat_check_bits_full);
+        remainder[0] = 0;
+        remainder[1] = 0;
+
+        for (i = (size - 1) / BITS_IN_WORD; i >= 0; i--)
+            tables.feed(remainder, (i == CHECK_BITS_ESB_WORD) ? contents[i] & ~CHECK_BITS_ESB_MASK : contents[i]);
+
+        intermediate.fill(0);
+        intermediate[0] = (t_word)remainder[0];
+        intermediate[1] = (t_word)(remainder[0] >> 32);
+        intermediate[2] = (t_word)remainder[1];
+        intermediate_sb = get_scrambling_bits();
+        eprintf(VERB_ALL, "Stored intermediate calculation for ESB=%d: \n",intermediate_sb); intermediate.print_bin(VERB_ALL);
     }
 
+    // Copy the intermediate result and add the contribution of the current ESB (the division is linear in GF2)
+    remainder[0] = (uint64_t)intermediate[0] | ((uint64_t)intermediate[1] << 32);
+    remainder[1] = intermediate[2];
+    tables.add_esb(remainder, get_extra_shaping_bits());
+
     // add (=xor) g to the remainder -> checkbits!:
-    checkbits = remainder + g;
+    tables.get_check_bits(remainder, checkbits);
 
     // save the checkbits
     contents[0] = checkbits[0];    // bits 0..31
@@ -991,16 +1012,42 @@ void telegram::shape_opt(void)
 // shaping the user data in order to find out illegal telegrams ASAP.
 // See subset 36 for more information
 {
-    longnum Utick, temp;
-    int err_location = 0, errs_found = 0, err, n_iter = 0; // , result;
-    t_word current_sb = 0, new_sb = 0;
+    longnum_userdata Utick;
+    int n_iter = 0;
     bool inc_sb = (word9 == -1); // true if run for the first time for this telegram
+    uint16_t q[SCRAMBLER_MAX_WORDS];    // U' scrambled with S=0, see scrambler.h
+
+    prepare_shaping(Utick, q);
 
+    if (search_sb_esb(Utick, q, inc_sb, LAST_TW_001, NULL, &n_iter) == ERR_NO_ERR)
+        eprintf(VERB_GLOB, "Shaped the telegram in %d combinations of scrambling bits and extra shaping bits.\n", n_iter);
+}
+
+void telegram::prepare_shaping(longnum_userdata& Utick, uint16_t* q)
+// aligns the telegram for the calculations and determines U' from the user data (deshaped_contents)
+// if the keystreams can be used (H of subset 36), scrambles U' once with S=0 into q (see scrambler.h)
+{
     align(a_calc);
     Utick = deshaped_contents;
     determine_U_tick(Utick);
     eprintf(VERB_ALL, "\nU'=\n"); Utick.print_bin(VERB_ALL);
 
+    if (H == scrambler.h)
+    // scramble U' once, each SB then only needs its precomputed keystream
+        get_scrambler_keystreams().scramble_zero_state(Utick, number_of_userbits / 10, q, scrambler);
+}
+
+int telegram::search_sb_esb(const longnum_userdata& Utick, const uint16_t* q, bool inc_sb, int last_word10, const std::atomic<int>* found_word10, int* n_iter)
+// the search of shape_opt: tries the combinations of SB and ESB in a fixed order until the telegram passes all checks
+// Utick and q must have been set by prepare_shaping. If inc_sb, starts with the next SB; otherwise continues with the current SB/ESB.
+// stops when word10 passes last_word10, or (if found_word10 is set) when another search found a solution with a lower word10.
+// returns ERR_NO_ERR if a solution was found, ERR_SB_ESB_OVERFLOW if not (errcode is only set if all SB were tried)
+{
+    int err;
+    bool use_keystreams = (H == scrambler.h);
+    const scrambler_keystreams& keystreams = get_scrambler_keystreams();
+    int64_t t;
+
     do
     // repeat until we find a correct telegram or there is an overflow of sb/esb
     {
@@ -1010,39 +1057,76 @@ void telegram::shape_opt(void)
             do
             // calculate the next scrambling bits and create shaped user bits that pass a large part of the Off-Synch-Parsing Condition
             {
-                n_iter++;
+                (*n_iter)++;
                 if (set_next_sb_esb_opt() == ERR_SB_ESB_OVERFLOW)
                 {
                     eprintf(VERB_ALL, "Overflow of SB/ESB occurred.\n");
-                    return;
+                    return ERR_SB_ESB_OVERFLOW;
                 }
-            } while (scramble_transform_check_user_data(determine_S(), H, Utick) != ERR_NO_ERR);
+
+                if ((word10 > last_word10) || (found_word10 && (found_word10->load(std::memory_order_relaxed) < word10)))
+                // end of the assigned part of the search space, or cancelled
+                    return ERR_SB_ESB_OVERFLOW;
+
+                stats_count(stat_sb_tried);
+                t = stats_start();
+                err = use_keystreams ? transform_check_keystream(q, keystreams.ks[get_scrambling_bits()])
+                                     : scramble_transform_check_user_data(determine_S(), H, Utick);
+                stats_stop(timer_scramble_ospc, t);
+
+                if (err != ERR_NO_ERR)
+                    stats_count(stat_sb_ospc_reject);
+            } while (err != ERR_NO_ERR);
         inc_sb = true;
 
-        do
-        // compute the check bits (CRC), perform checks and update the extra shaping bits until a correct solution is found.
-        // if none can be found, start from the top with new scrambling bits
-        {
-            compute_check_bits_opt();
-            n_iter++;
+        err = find_esb_opt(n_iter);
+    } while (err);
+
+    return ERR_NO_ERR;
+}
+
+static inline bool skips_esb(int err, int err_location)
+// returns true if the search of the ESB skips to the next word 9 after this error of the candidate checks (see find_esb_opt):
+// an off-synch-parsing or aperiodicity error that starts in the shaped user data
+{
+    return ((err == ERR_OFF_SYNCH_PARSING) || (err == ERR_APERIODICITY)) && (err_location >= OFFSET_SHAPED_DATA);
+}
 
-            eprintf(VERB_ALL, "\nChecking new telegram:\n");
-            print_contents_fancy(VERB_ALL);
+int telegram::find_esb_opt(int* n_iter)
+// compute the check bits (CRC), perform checks and update the extra shaping bits until a correct solution is found.
+// if none can be found, returns the last error: the caller has to start again with new scrambling bits
+// the shaped user data must have been set for the current scrambling bits. Adds the nr of tried ESB's to n_iter.
+{
+    int err, err_location = 0;
+    int64_t t;
+
+    do
+    {
+        t = stats_start();
+        compute_check_bits_opt();
+        stats_stop(timer_check_bits, t);
+        stats_count(stat_esb_tried);
+        (*n_iter)++;
 
-            // now see if the packet is "well formed", make another run if not.
+        eprintf(VERB_ALL, "\nChecking new telegram:\n");
+        print_contents_fancy(VERB_ALL);
+
+        // now see if the packet is "well formed", make another run if not.
+        // with a check profile or adaptive ordering, perform_candidate_checks_ordered leads to the same ESB skips (see there)
+        if (check_order_mode == order_canonical)
             err = perform_candidate_checks(VERB_ALL, &err_location);
+        else
+            err = perform_candidate_checks_ordered(VERB_ALL, &err_location);
 
-            if ((err == ERR_OFF_SYNCH_PARSING) || (err == ERR_APERIODICITY))
-                if (err_location >= OFFSET_SHAPED_DATA)
-                // error sequence is located completely in the shaped user data, it is therefore pointless to update the ESB
-                // solution: set last three bits of ESB to 111, so the next word 9 and if necessary word10 are selected in the next run
-                { 
-                    contents.write_at_location(N_CHECKBITS, 0b111, 3);  // set the lower three bits of the ESB to 111 
-                }
-        } while (err && set_next_esb_opt());
-    } while (err);
-    
-    eprintf(VERB_GLOB, "Shaped the telegram in %d combinations of scrambling bits and extra shaping bits.\n", n_iter);
+        if (skips_esb(err, err_location))
+        // error sequence is located completely in the shaped user data, it is therefore pointless to update the ESB
+        // solution: set last three bits of ESB to 111, so the next word 9 and if necessary word10 are selected in the next run
+        { 
+            contents.write_at_location(N_CHECKBITS, 0b111, 3);  // set the lower three bits of the ESB to 111 
+        }
+    } while (err && set_next_esb_opt());
+
+    return err;
 }
 
 /*
@@ -1108,7 +1192,7 @@ void telegram::shape(void)
 }
 */
 
-void telegram::deshape(longnum& userdata)
+void telegram::deshape(longnum_userdata& userdata)
 // deshapes the shaped data in the telegram into userdata (which could be part of telegram)
 {
     t_S S = 0;
@@ -1135,51 +1219,146 @@ void telegram::deshape()
     deshape(deshaped_contents);
 }
 
+int telegram::run_candidate_check(t_candidate_check check, int v, int* err_location)
+// Performs one of the checks of perform_candidate_checks, returns its error code (0 if OK) and sets err_location.
+{
+    int64_t t = stats_start();
+
+    switch (check)
+    {
+    case check_alphabet:
+        *err_location = check_alphabet_condition();
+        stats_stop(timer_alphabet, t);
+        if (*err_location != MAGIC_WORD)
+        {
+            eprintf(v, ERROR_COLOR "check_alphabet_condition fails" ANSI_COLOR_RESET " at word starting with bit#%d.\n", *err_location);
+            stats_count(stat_alphabet_reject);
+            return ERR_ALPHABET;
+        }
+        eprintf(v, "Check alphabet condition:\t\t\t" OK_COLOR "OK\n" ANSI_COLOR_RESET);
+        break;
+
+    case check_off_synch:
+        *err_location = check_off_synch_parsing_condition();
+        stats_stop(timer_off_synch, t);
+        if (*err_location != MAGIC_WORD)
+        {
+            eprintf(v, ERROR_COLOR "check_off_synch_parsing_condition fails" ANSI_COLOR_RESET " at bit# %d.\n", *err_location);
+            stats_count(stat_off_synch_reject);
+            return ERR_OFF_SYNCH_PARSING;
+        }
+        eprintf(v, "Check off-sync-parsing condition:\t\t" OK_COLOR "OK\n" ANSI_COLOR_RESET);
+        break;
+
+    case check_aperiodicity:
+        *err_location = check_aperiodicity_condition();
+        stats_stop(timer_aperiodicity, t);
+        if (*err_location != MAGIC_WORD)
+        {
+            eprintf(v, ERROR_COLOR "check_aperiodicity_condition fails" ANSI_COLOR_RESET " at bit# %d.\n", *err_location);
+            stats_count(stat_aperiodicity_reject);
+            return ERR_APERIODICITY;
+        }
+        eprintf(v, "Check aperiodicity condition for long format:\t" OK_COLOR "OK\n" ANSI_COLOR_RESET);
+        break;
+
+    default:
+        *err_location = check_undersampling_condition();
+        stats_stop(timer_undersampling, t);
+        if (*err_location)
+        {
+            eprintf(v, ERROR_COLOR "check_undersampling_condition fails" ANSI_COLOR_RESET".\n");
+            stats_count(stat_undersampling_reject);
+            return ERR_UNDER_SAMPLING;
+        }
+        eprintf(v, "Check undersampling condition:\t\t\t" OK_COLOR "OK\n" ANSI_COLOR_RESET);
+        break;
+    }
+
+    return ERR_NO_ERR;
+}
+
 int telegram::perform_candidate_checks(int v, int* err_location)
 // Performs all the checks in subset 36, paragraph 4.3.2.5 "Testing Candidate Telegrams".
 // Returns one of the subset 36 error codes, or 0 if all OK, stops checking after occurence of the first error.
 // Sets err_location to point to the start bit of the error (if this makes sense).
-// Perform the checks in the optimal order, see elimination rates in ZHUO Pengs article, Step 7.
+// The checks are performed in the canonical order, see elimination rates in ZHUO Pengs article, Step 7.
 // Always check the complete telegram. This leads to some redundant checks (the alphabet condition and the off-synch parsing check
 // are partially performed during the calculations), but it seems like a good idea to check everything once the calculations are done.
 {
-    *err_location = check_alphabet_condition();
-    if (*err_location != MAGIC_WORD)
+    int c, err;
+
+    for (c = 0; c < N_CANDIDATE_CHECKS; c++)
     {
-        eprintf(v, ERROR_COLOR "check_alphabet_condition fails" ANSI_COLOR_RESET " at word starting with bit#%d.\n", *err_location);
-        return ERR_ALPHABET;
+        err = run_candidate_check((t_candidate_check)c, v, err_location);
+        if (err != ERR_NO_ERR)
+            return err;
     }
-    else
-        eprintf(v, "Check alphabet condition:\t\t\t" OK_COLOR "OK\n" ANSI_COLOR_RESET);
 
-    *err_location = check_off_synch_parsing_condition();
-    if (*err_location != MAGIC_WORD)
+    stats_count(stat_candidate_passed);
+    return ERR_NO_ERR;
+}
+
+int telegram::perform_candidate_checks_ordered(int v, int* err_location)
+// Like perform_candidate_checks, in the order of the check profile or the adaptive order (see check_order.h). Only for the
+// search of the ESB (find_esb_opt), which only needs to know whether a candidate is rejected and whether skips_esb holds for
+// the first error in the canonical order. When a check rejects the candidate, the checks before it in the canonical order
+// that were not run yet are only run as long as the answer of skips_esb is still open. E.g. an alphabet error, or an
+// off-synch-parsing error outside the shaped user data, is returned at once.
+// Returns an error with the same answer of skips_esb as perform_candidate_checks, or 0 if all OK.
+{
+    t_candidate_check order[N_CANDIDATE_CHECKS];
+    bool done[N_CANDIDATE_CHECKS] = { false };
+    int is_long = (size == s_long), i, c, k, err, first_err, first_location;
+    bool timed = get_check_order(is_long, order), open;
+    int64_t t = 0;
+
+    for (i = 0; i < N_CANDIDATE_CHECKS; i++)
     {
-        eprintf(v, ERROR_COLOR "check_off_synch_parsing_condition fails" ANSI_COLOR_RESET " at bit# %d.\n", *err_location);
-        return ERR_OFF_SYNCH_PARSING;
+        if (timed)
+            t = check_order_clock();
+
+        err = run_candidate_check(order[i], v, err_location);
+        done[order[i]] = true;
+
+        if (timed)
+            t = check_order_clock() - t;
+        record_check(is_long, order[i], err != ERR_NO_ERR, timed, t);
+
+        if (err != ERR_NO_ERR)
+            break;
     }
-    else
-        eprintf(v, "Check off-sync-parsing condition:\t\t" OK_COLOR "OK\n" ANSI_COLOR_RESET);
 
-    *err_location = check_aperiodicity_condition();
-    if (*err_location != MAGIC_WORD)
+    if (i == N_CANDIDATE_CHECKS)
     {
-        eprintf(v, ERROR_COLOR "check_aperiodicity_condition fails" ANSI_COLOR_RESET " at bit# %d.\n", *err_location);
-        return ERR_APERIODICITY;
+        stats_count(stat_candidate_passed);
+        return ERR_NO_ERR;
     }
-    else
-        eprintf(v, "Check aperiodicity condition for long format:\t" OK_COLOR "OK\n" ANSI_COLOR_RESET);
 
-    *err_location = check_undersampling_condition();
-    if (*err_location)
+    // check order[i] failed. The checks before it in the canonical order that were run have passed; run the others
+    // while one of them, or order[i] itself, could still be the first canonical error for which skips_esb holds:
+    first_err = err;
+    first_location = *err_location;
+    for (c = 0; c < order[i]; c++)
     {
-        eprintf(v, ERROR_COLOR "check_undersampling_condition fails" ANSI_COLOR_RESET".\n");
-        return ERR_UNDER_SAMPLING;
+        if (done[c])
+            continue;
+
+        open = skips_esb(first_err, first_location);
+        for (k = max(c, (int)check_off_synch); k < order[i]; k++)
+            if (!done[k])
+                open = true;    // an off-synch-parsing or aperiodicity check that was not run yet
+        if (!open)
+            break;
+
+        err = run_candidate_check((t_candidate_check)c, v, err_location);
+        done[c] = true;
+        if (err != ERR_NO_ERR)
+            return err;
     }
-    else
-        eprintf(v, "Check undersampling condition:\t\t\t" OK_COLOR "OK\n" ANSI_COLOR_RESET);
 
-    return ERR_NO_ERR;
+    *err_location = first_location;
+    return first_err;
 }
 
 int telegram::check_alphabet_condition()
@@ -1220,80 +1399,48 @@ int telegram::check_off_synch_parsing_condition ()
  * 10) i = 10, 21, 32, .. : i+1 is multiple of 11, see case 1)
  * 11) i = 11, 22, 33, .. : see first line (no action)
  *
- * this check is performed using a greedy algorithm
+ * this check is performed on the bitmap of valid words (see get_valid_word_bitmap): for each offset, the first start bit of
+ * max_cvw+1 consecutive valid words is the lowest bit at that offset in the bitmap of runs (see get_valid_word_runs).
+ * This returns the same bit number as the greedy algorithm that was used before.
  */
 {
-    unsigned int i, min_i, prev_i, max_i, i_offset, max_cvw;
-    bool firstrun = true;
+    unsigned int i_offset, max_cvw;
+    int p, min_p[11];
+    longnum bitmap, runs_3, runs_max;
 
     //int offsets[] = { -1, 1, -2, 2, -3, 3, -4, 4, -5, 5 };    // Use Order 2, see ZHUO Pengs article, 3.3: i+/-2, 3, 4, 5 instead of i+2,3,4,5,6,7,8,9
     unsigned int offsets[] = { 10, 1, 9, 2, 8, 3, 7, 4, 6, 5 };
 
+    eprintf(VERB_ALL, HEADER_COLOR "\nOff-sync parsing condition check\n" ANSI_COLOR_RESET);
+    eprintf(VERB_ALL, "SB=%d; ESB=%d\n", get_scrambling_bits(), get_extra_shaping_bits());
+    print_contents_fancy(VERB_ALL);
+
+    // max cvw is 2 for offsets -1, 1 and 10 (long) or 6 (short) for the other offsets
+    max_cvw = (size == s_long) ? 10 : 6;
+
+    get_valid_word_bitmap(contents, bitmap);
+    get_valid_word_runs(bitmap, 2 + 1, runs_3);
+    get_valid_word_runs(bitmap, max_cvw + 1, runs_max);
+
     for (i_offset = 0; i_offset < sizeof(offsets) / sizeof(offsets[0]); i_offset++)
     // iterate over the offsets
     {
-        // determine the max allowed cvw for this case:
-        if (i_offset <= 1) //( (i_offset == 0) || (i_offset == 1) )   // offsets -1, 1
-            max_cvw = 2;
-        else  // cases 2..9:
-            if (size == s_long)
-                max_cvw = 10;
-            else
-                max_cvw = 6;
+        // find the first run of too many consecutive valid words for each offset (bit number mod 11):
+        for (p = 0; p < 11; p++)
+            min_p[p] = -1;
 
-        eprintf(VERB_ALL, HEADER_COLOR "\nOff-sync parsing condition check; offset=%d, max_cvw=%d\n" ANSI_COLOR_RESET, offsets[i_offset], max_cvw);
-        eprintf(VERB_ALL, "SB=%d; ESB=%d\n", get_scrambling_bits(), get_extra_shaping_bits());
-        print_contents_fancy(VERB_ALL);
+        for (p = ((i_offset <= 1) ? runs_3 : runs_max).get_next_bit(0); p >= 0; p = ((i_offset <= 1) ? runs_3 : runs_max).get_next_bit(p + 1))
+            if (min_p[p % 11] == -1)
+                min_p[p % 11] = p;
 
-        // initial conditions for greedy algorithm, starting at the lower bits:
-        i = offsets[i_offset] + max_cvw * 11;   // i points to bit 0 of max_cvw+1
-        min_i = offsets[i_offset];              // start of greedy step
-        prev_i = i;                             // the max index of the previous step
-        max_i = i;                              // the max index of the current step
-        firstrun = true;                        // set to true if this is the first greedy step
-
-        while (i < (unsigned int)size + (max_cvw+2) * 11 + offsets[i_offset])
-        // determine the max_nvw using a greedy algorithm. use max_cvw+2 to get sufficient overlap with the first step at the wraparound
+        if (min_p[offsets[i_offset]] != -1)
+        // max nr of cvw's was found, exit with an error
         {
-            // print the current greedy state:
-            if (check_verbose(VERB_ALL))
-            {
-                t_longnum_layout greedy_markings[] =
-                {
-                    {min_i, 11, ANSI_COLOR_GREEN},
-                    {i % size, 11, ANSI_COLOR_YELLOW},
-                    {0, 0, ""}
-                };
-                contents.print_fancy(VERB_ALL, 11, size, greedy_markings);
-            }
+            eprintf(VERB_ALL, ERROR_COLOR "\nNOK: off-synch-parsing condition fails; max cvw exceeded at bit #%d.\n" ANSI_COLOR_RESET, min_p[offsets[i_offset]]);
+            eprintf(VERB_ALL, "offset=%d; max. nr. of consecutive valid words=%d.\n\n", offsets[i_offset], (i_offset <= 1) ? 2 : max_cvw);
 
-            if (find11(contents.get_word_wraparound(size, i) & 0x7FF) == NO_TW)
-            // a non-valid word was found, skip to the next
-            {
-                eprintf(VERB_ALL, "Non-valid word found @bit %d; prev_i=%d\n", i % size, prev_i);
-                min_i = i + 11;                 // set min_i to the word following the current non-valid word
-                i = min_i + max_cvw * 11;       // set i to the end of the possible valid word sequence
-                prev_i = max_i;                 // remember the starting point of the previous iteration
-                max_i = i;                      // remember the max i
-                firstrun = false;               // no longer in first run
-            }
-            else
-            // a valid word was found, step back to see if the previous word was non-valid
-            {
-                eprintf(VERB_ALL, "Valid word found @bit %d; prev_i=%d\n", i % size, prev_i);
-
-                if (i == (firstrun ? min_i : (prev_i + 11)))
-                // max nr of cvw's was found, exit with an error
-                {
-                    eprintf(VERB_ALL, ERROR_COLOR "\nNOK: off-synch-parsing condition fails; max cvw exceeded at bit #%d.\n" ANSI_COLOR_RESET, min_i);
-                    eprintf(VERB_ALL, "offset=%d; max. nr. of consecutive valid words=%d.\n\n", offsets[i_offset], max_cvw);
-
-                    errcode = ERR_OFF_SYNCH_PARSING;
-                    return min_i;
-                }
-
-                i -= 11;
-            }
+            errcode = ERR_OFF_SYNCH_PARSING;
+            return min_p[offsets[i_offset]];
         }
 
         eprintf(VERB_ALL, OK_COLOR "Off-synch-parsing condition OK for offset=%d.\n" ANSI_COLOR_RESET, offsets[i_offset]);
@@ -1303,6 +1450,69 @@ int telegram::check_off_synch_parsing_condition ()
     return MAGIC_WORD;
 }
 
+void telegram::get_valid_word_bitmap(const longnum& ln, longnum& bitmap) const
+// fills bitmap with one bit for each start position p in 0..size-1 of ln: 1 if the 11-bit word at p (with wrap-around) is a 
+// transformation word, 0 if not
+{
+    int p;
+    t_word w;
+
+    bitmap.fill(0);
+
+    for (p = 0; p < size; p++)
+    {
+        if (p < size - 10)
+            w = ln.get_word(p) & 0x7FF;
+        else
+            w = ln.get_word_wraparound(size, p) & 0x7FF;
+
+        if (find11(w) != NO_TW)
+            bitmap[p / BITS_IN_WORD] |= (t_word)1 << (p % BITS_IN_WORD);
+    }
+}
+
+longnum telegram::rotate_right(const longnum& ln, int count) const
+// rotates the lower size bits of ln count (0 < count < size) bits to the right: bit p of the result is bit (p+count) mod size of ln
+{
+    int i;
+    longnum result = (ln >> count) ^ (ln << (size - count));
+
+    // clear the bits that were shifted above the telegram
+    for (i = size / BITS_IN_WORD + 1; i < WORDS_IN_LONGNUM; i++)
+        result[i] = 0;
+    result[size / BITS_IN_WORD] &= ((t_word)1 << (size % BITS_IN_WORD)) - 1;
+
+    return result;
+}
+
+void telegram::get_valid_word_runs(const longnum& bitmap, int n, longnum& runs) const
+// fills runs with one bit for each start position p in 0..size-1: 1 if the n words at p, p+11, .., p+11*(n-1) (with wrap-around) are all valid.
+// bitmap is the bitmap of valid words (see get_valid_word_bitmap).
+// uses shift-and-AND, doubling the length of the runs in each step: runs of a+b words = (runs of a) & (runs of b, rotated 11*a bits)
+{
+    longnum pow = bitmap;       // runs of pow_n words
+    int pow_n = 1, runs_n = 0;
+
+    while (n > 0)
+    {
+        if (n & 1)
+        {
+            if (runs_n == 0)
+                runs = pow;
+            else
+                runs &= rotate_right(pow, (11 * runs_n) % size);
+            runs_n += pow_n;
+        }
+
+        n >>= 1;
+        if (n > 0)
+        {
+            pow &= rotate_right(pow, (11 * pow_n) % size);
+            pow_n *= 2;
+        }
+    }
+}
+
 int telegram::calc_hamming_distance(t_word word1, t_word word2)
 // calculates and returns the hamming distance between word1 and word2
 // see https://en.wikipedia.org/wiki/Hamming_distance
@@ -1392,48 +1602,6 @@ int telegram::check_aperiodicity_condition ()
     return MAGIC_WORD;    // short telegram or no errors
 }
 
-int telegram::get_max_run_valid_words(const longnum& ln)
-/** Returns the maximum number of valid consecutive 11-bit words in telegram of length telegram->size (=n).
- * Starts at offsets i=[0..10] and for each offset, continues until n+30*11 bits have been checked.
- * Wraps around at n.
- * Because of this approach, there is no point in using offsets >= 11 as the check would repeat itself.
- * returns the maximum number of valid consecutive words found.
-*/
-{
-    int offset, n_cvw, max_cvw = 0, i;
-    t_word temp;
-
-    for (offset = 0; offset < 11; offset++)
-    {
-        eprintf(VERB_ALL, "\nOffset=%d:\n", offset);
-
-        n_cvw = 0;
-        for (i = 0; i < size + 30 * 11; i += 11)
-        {
-            // find out the max nr of consecutive valid words for the current offset:
-            temp = ln.get_word_wraparound(size, i + offset) & 0x7FF;
-            if (find11(temp) != -1)
-            // word was found in the list
-            {
-                eprintf(VERB_ALL, ANSI_COLOR_YELLOW);
-
-                n_cvw++;
-                if (n_cvw > max_cvw)
-                    max_cvw = n_cvw;
-            }
-            else
-                n_cvw = 0;    // reset the counter
-
-                eprintf(VERB_ALL, "  i=%04d; word=", i + offset); print_bin(VERB_ALL, temp, 11); eprintf(VERB_ALL, ANSI_COLOR_RESET);
-
-                if (i % 4 == 0)
-                    eprintf(VERB_ALL, "\n");
-        }
-    }
-
-    return max_cvw;
-}
-
 int telegram::check_undersampling_condition()
 /** runs the "undersampling Condition" check (subset 36, 4.3.2.5.5).
  * Under-sample the telegram of length N bits with a factor k of 1, 2, 3 and 4 (and 2^k=2,4,8,16).
@@ -1458,33 +1626,33 @@ int telegram::check_undersampling_condition()
  *   e.g.: ...F.....L... (pos in [0..N-1]; F=3, L=9, N=13 -> d=7)
  * 
  * Alternatively (and used below), for both telegram lengths N: check that the max amount of consecutive valid words is 30 for 0<=n<N+30 words (this includes wrap-around).
+ * This is done with the bitmap of valid words of the undersampled telegram: a run of 31 valid words exists if the bitmap of runs of 31 is not empty.
+ * The undersampled telegrams are created in one pass by de-interleaving the bits of the telegram (see undersampling.h).
  * return 0 if all ok or ERR_UNDER_SAMPLING if an error was found.
  * 
  * Decision: no implementation of the greedy algorithm to keep this check as simple and robust as possible. The performance gain would be minimal.
  */
 {
-    int factor, i, j;
-    int mrvw;
-    longnum v;
-    //t_telegram v = { 0 };
-    //v_size = telegram->size;
-
-    for (factor = 2; factor <= 16; factor *= 2)
-        for (i = 0; i < factor; i++)
-        {
-            // create the undersampled telegram "v":
-            for (j = 0; j < size; j++)
-                v.set_bit(j, contents.get_bit((j * factor + i) % size));
+    int factor, i, n = 0;
+    longnum v[UNDERSAMPLING_N_TELEGRAMS], bitmap, runs;
 
+    // create all undersampled telegrams "v" in one pass:
+    undersample_telegram(get_deinterleave(), contents, size, v);
+
+    for (factor = 2; factor <= UNDERSAMPLING_MAX_FACTOR; factor *= 2)
+        for (i = 0; i < factor; i++, n++)
+        {
             eprintf(VERB_ALL, "Original telegram:\n");
             contents.print_fancy(VERB_ALL, 11, size, NULL); 
             eprintf(VERB_ALL, "new telegram with offset=%d and undersampling factor=%d:\n", i, factor);
-            v.print_fancy(VERB_ALL, 11, size, NULL); 
+            v[n].print_fancy(VERB_ALL, 11, size, NULL); 
 
-            mrvw = get_max_run_valid_words(v);
-            if (mrvw > 30)
+            // look for a run of 31 valid words (with wrap-around) in the bitmap of valid words:
+            get_valid_word_bitmap(v[n], bitmap);
+            get_valid_word_runs(bitmap, 31, runs);
+            if (runs.get_order() > 0)
             { 
-                eprintf(VERB_ALL, ERROR_COLOR "ERROR:" ANSI_COLOR_RESET " undersampling condition fails (MRVW = % d; offset=%d; factor k=%d\n", mrvw, i, factor);
+                eprintf(VERB_ALL, ERROR_COLOR "ERROR:" ANSI_COLOR_RESET " undersampling condition fails (MRVW > 30 at bit %d; offset=%d; factor k=%d\n", runs.get_order() - 1, i, factor);
 
                 errcode = ERR_UNDER_SAMPLING;
                 return ERR_UNDER_SAMPLING;
@@ -1514,7 +1682,7 @@ int telegram::check_check_bits()
 // calculation of check bits is described in subset 36, 4.3.2.4.
 {
     telegram temp ("", size);
-    longnum cb1, cb2;
+    longnum_checkbits cb1, cb2;
 
     //init_telegram(&temp, telegram->size);
     temp = *this;
@@ -1573,7 +1741,7 @@ int telegram::check_shaped_deshaped()
 // checks the shaped data in telegram against the unshaped data in the telegram
 // returns 0 if no error, an appropriate error code if NOK
 {
-    longnum deshaped_data;
+    longnum_userdata deshaped_data;
 
     align(a_calc);
 
@@ -1594,3 +1762,28 @@ int telegram::check_shaped_deshaped()
 
     return ERR_NO_ERR;
 }
+
+int telegram::check_stored_telegram(t_sb sb, t_esb esb)
+// checks shaped contents that the search found before with scrambling bits sb and extra shaping bits esb (see result_cache.h)
+// without the candidate checks: the control bits, SB, ESB, check bits and the deshaped contents against the user data.
+// These determine the whole telegram, so it is the telegram that passed the candidate checks in the search.
+// returns 0 if no error, an appropriate error code if NOK
+{
+    int err;
+
+    align(a_calc);
+
+    if ((get_scrambling_bits() != sb) || (get_extra_shaping_bits() != esb))
+    {
+        errcode = ERR_CONTENT;
+        return ERR_CONTENT;
+    }
+
+    err = check_control_bits();
+    if (err == ERR_NO_ERR)
+        err = check_check_bits();
+    if (err == ERR_NO_ERR)
+        err = check_shaped_deshaped();
+
+    return err;
+}
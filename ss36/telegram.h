@@ -27,11 +27,15 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string>
+#include <string_view>
+#include <atomic>
+#include <vector>
 //#include <bit>    // for popcount instruction used in calculation of Hamming distance
 
 #include "colors.h"
 #include "longnum.h"
 #include "transformation_words.h"
+#include "check_order.h"
 
 #define BITLENGTH_LONG_TELEGRAM     1023            // length of long telegram
 #define BITLENGTH_SHORT_TELEGRAM    341             // length of short telegram
@@ -40,6 +44,7 @@ typedef t_word t_S;                // type of S, the initial state of shift regi
 typedef t_longnum t_checkbits;     // lower 85 bits are the "check bits"
 typedef t_word t_esb;              // lower 10 bits are the "extra shaping bits"
 typedef t_word t_sb;               // lower 12 bits are the "scrambling bits"
+#define NO_SB ((t_sb)-1)                // value of intermediate_sb if no intermediate has been calculated (any SB of 12 bits is valid)
 typedef t_word t_cb;               // lower 3 bits are the "control bits"
 
 #define N_CHECKBITS         85      // Nr. of checkbits
@@ -51,6 +56,10 @@ typedef t_word t_cb;               // lower 3 bits are the "control bits"
 #define N_SHAPEDDATA_L      913     // number of shaped user bits in long telegram
 #define N_SHAPEDDATA_S      231     // number of shaped user bits in short telegram
 #define OFFSET_SHAPED_DATA  N_CHECKBITS + N_ESB + N_SB + N_CB
+#define N_OSPC_OFFSETS      10      // number of offsets checked by the greedy off-synch-parsing check during shaping
+
+typedef longnum_t<N_CHECKBITS> longnum_checkbits;      // the check bits or the remainder of the check bits calculation (3 words)
+typedef longnum_t<N_USERBITS_L> longnum_userdata;      // the unshaped user data, of a long or short telegram (26 words, room for the alignment a_enc)
 
 #define CONTROL_BITS                1       // three bits, value 001 [b109..b107]
 #define MAGIC_WORD                  0xFAB   // My initials in 12 bits ;-)
@@ -81,6 +90,7 @@ static t_longnum_layout telegram_coloring_scheme[5] =
 #define ERR_MEM_ALLOC           4       // error allocating memory
 #define ERR_INPUT_ERROR         5       // error in the input
 #define ERR_THREAD_CREATION     6       // error creating calculation thread or acquiring mutex
+#define ERR_SOCKET              7       // error creating, binding or connecting a Unix domain socket (--serve, --client)
 
 // error codes from the subset 36 (including references to relevant paragraphs in the subset):
 #define ERR_ALPHABET            10      // 4.3.2.5.2 Alphabet Condition
@@ -113,17 +123,16 @@ public:
     string         input_string;               // original input line
     longnum             contents;                   // shaped contents
     enum t_size         size;                       // BITLENGTH_LONG_TELEGRAM (1023) or BITLENGTH_SHORT_TELEGRAM (341)
-    longnum             deshaped_contents;          // deshaped contents
+    longnum_userdata    deshaped_contents;          // deshaped contents
     int                 errcode;                    // error code if anything is wrong with this telegram (see below)
     enum t_align        alignment;                  // current alignment of the bits in the telegram: for hex/base64 encoding (a_enc) or for calculations (a_calc).
     unsigned int        number_of_userbits;         // #unshaped (10->11) user bits (m=N_USERBITS_L or N_USERBITS_S)
     unsigned int        number_of_shapeddata_bits;  // #bits in shaped data (N_SHAPEDDATA_L or N_SHAPEDDATA_S; =11/10*number_of_userbits)
     int                 word9, word10;              // indices of the two transformation words in which the control bits, scrambling bits and extra shaping bits are located (see function "shape")
     bool                force_long=false;           // if true: make a long telegram out of this (if this is not already the case). If false: don't mess with the sizes
-    longnum             intermediate;               // for intermediate calculation (BCH1). See step 6 in ZUO Peng's article (partial result of check bits calculation up unto the ESB)
-    t_sb                intermediate_sb=0;          // the scrambling bits with which the intermediate was calculated
+    longnum_checkbits   intermediate;               // for intermediate calculation (BCH1). See step 6 in ZUO Peng's article (remainder of the check bits calculation of the words above the ESB, in bits 0..84)
+    t_sb                intermediate_sb=NO_SB;      // the scrambling bits with which the intermediate was calculated
     t_action            action;                     // the action to be performed on this telegram
-    telegram            *next=NULL;                 // pointer to the next telegram
 
     // function prototypes:
     // start with some initialisers, getters, setters and other useful functions:
@@ -132,9 +141,9 @@ public:
     ~telegram(void);
     void set_size(enum t_size newsize);
     void make_userdata_long();
-    void parse_input(const string inputstr);
+    void parse_input(string_view input);
     void set_checkbits(const t_checkbits checkbits);
-    void get_checkbits(longnum& checkbits) const;  
+    void get_checkbits(longnum_checkbits& checkbits) const;  
     void set_extra_shaping_bits(t_esb esb);
     t_esb get_extra_shaping_bits(void) const;
     t_esb get_extra_shaping_bits(const longnum readfrom) const;
@@ -148,31 +157,42 @@ public:
     void print_contents_fancy(int v) const;
     void align(enum t_align new_alignment);
     void shape_opt(void);
-    void deshape(longnum& userdata);
+    void prepare_shaping(longnum_userdata& Utick, uint16_t* q);
+    int search_sb_esb(const longnum_userdata& Utick, const uint16_t* q, bool inc_sb, int last_word10, const std::atomic<int>* found_word10, int* n_iter);
+    void deshape(longnum_userdata& userdata);
     void deshape(void);
     int check_shaped_telegram(void);
     int check_shaped_deshaped(void);
+    int check_stored_telegram(t_sb sb, t_esb esb);
     int set_next_sb_esb_opt(void);
     bool set_next_esb_opt(void);
-    void determine_U_tick(longnum& Utick);
-    t_S determine_S(t_sb sb);
+    void determine_U_tick(longnum_userdata& Utick);
+    static t_S determine_S(t_sb sb);
     t_S determine_S(void);
-    int scramble_transform_check_user_data(t_S S, t_H H, const longnum& user_data_orig);
+    int scramble_transform_check_user_data(t_S S, t_H H, const longnum_userdata& user_data_orig);
+    int transform_check_keystream(const uint16_t* q, const uint16_t* ks);
+    void init_greedy_ospc(int* i_last_nvw) const;
+    int transform_check_word(int i, t_word val10, int* i_last_nvw);
+    int find_esb_opt(int* n_iter);
     void compute_check_bits_opt(void);
+    int run_candidate_check(t_candidate_check check, int v, int* err_location);
     int perform_candidate_checks(int v, int* err_location);
+    int perform_candidate_checks_ordered(int v, int* err_location);
 
 private:
-    int transform11to10(longnum& userdata);
-    void descramble(t_S S, t_H H, longnum& user_data, int m);  
-    void calc_first_word(longnum& U, unsigned int m);
+    int transform11to10(longnum_userdata& userdata);
+    void descramble(t_S S, t_H H, longnum_userdata& user_data, int m);  
+    void calc_first_word(longnum_userdata& U, unsigned int m);
 
     // functions needed to perform the tests of candidate telegrams (see subset 36, 4.3.2.5):
     int check_alphabet_condition(void);
     int check_off_synch_parsing_condition(void);
     int calc_hamming_distance(t_word word1, t_word word2);  // part of aperiodicity condition
     int check_aperiodicity_condition(void);
-    int get_max_run_valid_words(const longnum& ln);  
     int check_undersampling_condition(void);
+    void get_valid_word_bitmap(const longnum& ln, longnum& bitmap) const;
+    void get_valid_word_runs(const longnum& bitmap, int n, longnum& runs) const;
+    longnum rotate_right(const longnum& ln, int count) const;
 
     // additional functions needed to perform checks of the telegram:
     int check_control_bits(void);
@@ -189,5 +209,8 @@ private:
 
 };
 
+typedef vector<telegram> telegram_batch;       // the telegrams of the input, stored contiguously in the order of the input lines
+
+
 
 #endif
\ No newline at end of file
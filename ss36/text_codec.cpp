@@ -0,0 +1,416 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+#include "text_codec.h"
+#include "cpu_features.h"
+#include <string.h>         // memcpy
+
+#if defined(SS36_ARM64)
+#include <arm_neon.h>       // vqtbl1q_u8, vqtbl4q_u8, vld2q_u8, vst2q_u8, vld3q_u8, vst4q_u8, vld4q_u8, vst3q_u8
+#endif
+
+static const char hex_digits[] = "0123456789ABCDEF";
+static const char base64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+#define TEXT_CODEC_INVALID  0xFF        // the value of an illegal char in the decode tables
+
+class text_codec_tables
+// the character pairs of each byte in hex and of each 12 bits in base64, and the value of each char in hex and in base64
+{
+public:
+    char hex[256][2];
+    char base64[4096][2];
+    uint8_t hex_value[256];
+    uint8_t base64_value[256];
+
+    text_codec_tables(void)
+    {
+        int i;
+
+        memset(hex_value, TEXT_CODEC_INVALID, sizeof(hex_value));
+        memset(base64_value, TEXT_CODEC_INVALID, sizeof(base64_value));
+
+        for (i = 0; i < 16; i++)
+        {
+            hex_value[(uint8_t)hex_digits[i]] = (uint8_t)i;
+            if (i >= 10)
+                hex_value[(uint8_t)hex_digits[i] - 'A' + 'a'] = (uint8_t)i;
+        }
+
+        for (i = 0; i < 64; i++)
+            base64_value[(uint8_t)base64_digits[i]] = (uint8_t)i;
+
+        for (i = 0; i < 256; i++)
+        {
+            hex[i][0] = hex_digits[i >> 4];
+            hex[i][1] = hex_digits[i & 0x0F];
+        }
+
+        for (i = 0; i < 4096; i++)
+        {
+            base64[i][0] = base64_digits[i >> 6];
+            base64[i][1] = base64_digits[i & 0x3F];
+        }
+    }
+};
+
+static const text_codec_tables tables;
+
+char* encode_hex_portable(const uint8_t* in, int n, char* out)
+// writes the n bytes of in as hex, one table lookup per byte
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        memcpy(out, tables.hex[in[i]], 2);
+        out += 2;
+    }
+
+    return out;
+}
+
+#if defined(SS36_ARM64)
+
+static char* encode_hex_tbl(const uint8_t* in, int n, char* out)
+// writes the n bytes of in as hex, 16 bytes at a time: TBL looks up the high and low nibbles, VST2 interleaves them
+{
+    int i;
+    uint8x16_t b;
+    uint8x16x2_t digits;
+    const uint8x16_t table = vld1q_u8((const uint8_t*)hex_digits);
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        b = vld1q_u8(in + i);
+        digits.val[0] = vqtbl1q_u8(table, vshrq_n_u8(b, 4));
+        digits.val[1] = vqtbl1q_u8(table, vandq_u8(b, vdupq_n_u8(0x0F)));
+        vst2q_u8((uint8_t*)out, digits);
+        out += 32;
+    }
+
+    // the remaining bytes:
+    return encode_hex_portable(in + i, n - i, out);
+}
+
+t_encode_hex* const encode_hex_neon = encode_hex_tbl;
+
+#else
+
+t_encode_hex* const encode_hex_neon = NULL;
+
+#endif
+
+t_encode_hex* get_encode_hex(void)
+// returns the fastest hex kernel that the cpu supports
+{
+    static t_encode_hex* kernel =
+        (encode_hex_neon != NULL) ? encode_hex_neon :
+        (encode_hex_ssse3 != NULL && get_cpu_features().ssse3) ? encode_hex_ssse3 :
+        encode_hex_portable;
+
+    return kernel;
+}
+
+char* encode_base64_portable(const uint8_t* in, int n, char* out)
+// writes the n bytes of in as base64, 3 bytes at a time as 2 table lookups of 12 bits each
+{
+    int i;
+    uint32_t v;
+
+    for (i = 0; i + 3 <= n; i += 3)
+    {
+        v = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+        memcpy(out, tables.base64[v >> 12], 2);
+        memcpy(out + 2, tables.base64[v & 0xFFF], 2);
+        out += 4;
+    }
+
+    // the last 1 or 2 bytes, padded with '=':
+    if (i < n)
+    {
+        v = (uint32_t)in[i] << 16;
+        if (i + 1 < n)
+            v |= (uint32_t)in[i + 1] << 8;
+
+        memcpy(out, tables.base64[v >> 12], 2);
+        out[2] = (i + 1 < n) ? base64_digits[(v >> 6) & 0x3F] : '=';
+        out[3] = '=';
+        out += 4;
+    }
+
+    return out;
+}
+
+#if defined(SS36_ARM64)
+
+static char* encode_base64_tbl(const uint8_t* in, int n, char* out)
+// writes the n bytes of in as base64, 48 bytes at a time: VLD3 separates the 3 bytes of each group, TBL looks up the 4 values
+// of 6 bits in the 64 chars, VST4 interleaves the 4 chars of each group
+{
+    int i;
+    uint8x16x3_t b;
+    uint8x16x4_t table, c;
+    const uint8x16_t mask = vdupq_n_u8(0x3F);
+
+    table.val[0] = vld1q_u8((const uint8_t*)base64_digits);
+    table.val[1] = vld1q_u8((const uint8_t*)base64_digits + 16);
+    table.val[2] = vld1q_u8((const uint8_t*)base64_digits + 32);
+    table.val[3] = vld1q_u8((const uint8_t*)base64_digits + 48);
+
+    for (i = 0; i + 48 <= n; i += 48)
+    {
+        b = vld3q_u8(in + i);
+        c.val[0] = vqtbl4q_u8(table, vshrq_n_u8(b.val[0], 2));
+        c.val[1] = vqtbl4q_u8(table, vandq_u8(vorrq_u8(vshlq_n_u8(b.val[0], 4), vshrq_n_u8(b.val[1], 4)), mask));
+        c.val[2] = vqtbl4q_u8(table, vandq_u8(vorrq_u8(vshlq_n_u8(b.val[1], 2), vshrq_n_u8(b.val[2], 6)), mask));
+        c.val[3] = vqtbl4q_u8(table, vandq_u8(b.val[2], mask));
+        vst4q_u8((uint8_t*)out, c);
+        out += 64;
+    }
+
+    // the remaining bytes and the padding:
+    return encode_base64_portable(in + i, n - i, out);
+}
+
+t_encode_base64* const encode_base64_neon = encode_base64_tbl;
+
+#else
+
+t_encode_base64* const encode_base64_neon = NULL;
+
+#endif
+
+t_encode_base64* get_encode_base64(void)
+// returns the fastest base64 kernel that the cpu supports
+{
+    static t_encode_base64* kernel =
+        (encode_base64_neon != NULL) ? encode_base64_neon :
+        (encode_base64_ssse3 != NULL && get_cpu_features().ssse3) ? encode_base64_ssse3 :
+        encode_base64_portable;
+
+    return kernel;
+}
+
+bool decode_hex_portable(const char* in, int n, uint8_t* out)
+// decodes the 2n hex chars of in, one table lookup per char. An illegal char sets the high bit of the or-ed values.
+{
+    int i;
+    uint8_t hi, lo, invalid = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        hi = tables.hex_value[(uint8_t)in[2 * i]];
+        lo = tables.hex_value[(uint8_t)in[2 * i + 1]];
+        invalid |= hi | lo;
+        out[i] = (uint8_t)((hi << 4) | (lo & 0x0F));
+    }
+
+    return (invalid & 0x80) == 0;
+}
+
+int decode_base64_portable(const char* in, int n_chars, uint8_t* out)
+// decodes the n_chars base64 chars of in, 4 chars (=3 bytes) at a time with one table lookup per char
+// the last 4 chars may end with 1 or 2 '=', these give 1 or 2 bytes less
+{
+    int i, k = 0, n_pad = 0;
+    uint8_t a, b, c, d;
+    uint32_t v;
+
+    if (n_chars % 4 != 0)
+        return -1;
+
+    if ((n_chars > 0) && (in[n_chars - 1] == '='))
+        n_pad = (in[n_chars - 2] == '=') ? 2 : 1;
+
+    for (i = 0; i < n_chars; i += 4)
+    {
+        a = tables.base64_value[(uint8_t)in[i]];
+        b = tables.base64_value[(uint8_t)in[i + 1]];
+        c = ((i + 4 == n_chars) && (n_pad == 2)) ? 0 : tables.base64_value[(uint8_t)in[i + 2]];
+        d = ((i + 4 == n_chars) && (n_pad >= 1)) ? 0 : tables.base64_value[(uint8_t)in[i + 3]];
+
+        if ((a | b | c | d) & 0x80)
+            return -1;
+
+        v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+        out[k++] = (uint8_t)(v >> 16);
+        if ((i + 4 < n_chars) || (n_pad < 2))
+            out[k++] = (uint8_t)(v >> 8);
+        if ((i + 4 < n_chars) || (n_pad < 1))
+            out[k++] = (uint8_t)v;
+    }
+
+    return k;
+}
+
+#if defined(SS36_ARM64)
+
+static inline uint8x16_t hex_nibbles(uint8x16_t c, uint8x16_t* valid)
+// returns the values of the 16 hex chars in c, and-s the lanes of valid with 0 for each illegal char
+{
+    uint8x16_t d = vsubq_u8(c, vdupq_n_u8('0'));                            // '0'..'9' -> 0..9
+    uint8x16_t l = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a')); // 'A'..'F' and 'a'..'f' -> 0..5
+    uint8x16_t is_digit = vcleq_u8(d, vdupq_n_u8(9));
+    uint8x16_t is_letter = vcleq_u8(l, vdupq_n_u8(5));
+
+    *valid = vandq_u8(*valid, vorrq_u8(is_digit, is_letter));
+
+    return vorrq_u8(vandq_u8(is_digit, d), vandq_u8(is_letter, vaddq_u8(l, vdupq_n_u8(10))));
+}
+
+static bool decode_hex_vld2(const char* in, int n, uint8_t* out)
+// decodes the 2n hex chars of in, 16 bytes at a time: VLD2 separates the high and low nibbles
+{
+    int i;
+    uint8x16x2_t c;
+    uint8x16_t hi, lo, valid;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        c = vld2q_u8((const uint8_t*)in + 2 * i);
+        valid = vdupq_n_u8(0xFF);
+        hi = hex_nibbles(c.val[0], &valid);
+        lo = hex_nibbles(c.val[1], &valid);
+
+        if (vminvq_u8(valid) == 0)
+            return false;
+
+        vst1q_u8(out + i, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+    }
+
+    // the remaining bytes:
+    return decode_hex_portable(in + 2 * i, n - i, out + i);
+}
+
+static inline uint8x16_t base64_values(uint8x16_t c, uint8x16_t* valid)
+// returns the values of the 16 base64 chars in c, and-s the lanes of valid with 0 for each illegal char (including '=')
+{
+    uint8x16_t upper = vandq_u8(vcgeq_u8(c, vdupq_n_u8('A')), vcleq_u8(c, vdupq_n_u8('Z')));
+    uint8x16_t lower = vandq_u8(vcgeq_u8(c, vdupq_n_u8('a')), vcleq_u8(c, vdupq_n_u8('z')));
+    uint8x16_t digit = vandq_u8(vcgeq_u8(c, vdupq_n_u8('0')), vcleq_u8(c, vdupq_n_u8('9')));
+    uint8x16_t plus = vceqq_u8(c, vdupq_n_u8('+'));
+    uint8x16_t slash = vceqq_u8(c, vdupq_n_u8('/'));
+    uint8x16_t v;
+
+    *valid = vandq_u8(*valid, vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, vorrq_u8(plus, slash))));
+
+    v = vandq_u8(upper, vsubq_u8(c, vdupq_n_u8('A')));
+    v = vorrq_u8(v, vandq_u8(lower, vsubq_u8(c, vdupq_n_u8('a' - 26))));
+    v = vorrq_u8(v, vandq_u8(digit, vaddq_u8(c, vdupq_n_u8(52 - '0'))));
+    v = vorrq_u8(v, vandq_u8(plus, vdupq_n_u8(62)));
+    v = vorrq_u8(v, vandq_u8(slash, vdupq_n_u8(63)));
+
+    return v;
+}
+
+static int decode_base64_vld4(const char* in, int n_chars, uint8_t* out)
+// decodes the n_chars base64 chars of in, 64 chars (=48 bytes) at a time: VLD4 separates the 4 chars of each group,
+// VST3 interleaves the 3 bytes of each group. The last 4 chars (with the padding) are always decoded by the portable kernel.
+{
+    int i, k;
+    uint8x16x4_t c;
+    uint8x16x3_t b;
+    uint8x16_t v0, v1, v2, v3, valid;
+
+    if (n_chars % 4 != 0)
+        return -1;
+
+    for (i = 0; i + 64 <= n_chars - 4; i += 64)
+    {
+        c = vld4q_u8((const uint8_t*)in + i);
+        valid = vdupq_n_u8(0xFF);
+        v0 = base64_values(c.val[0], &valid);
+        v1 = base64_values(c.val[1], &valid);
+        v2 = base64_values(c.val[2], &valid);
+        v3 = base64_values(c.val[3], &valid);
+
+        if (vminvq_u8(valid) == 0)
+            return -1;
+
+        b.val[0] = vorrq_u8(vshlq_n_u8(v0, 2), vshrq_n_u8(v1, 4));
+        b.val[1] = vorrq_u8(vshlq_n_u8(v1, 4), vshrq_n_u8(v2, 2));
+        b.val[2] = vorrq_u8(vshlq_n_u8(v2, 6), v3);
+        vst3q_u8(out + i / 4 * 3, b);
+    }
+
+    // the remaining chars:
+    k = decode_base64_portable(in + i, n_chars - i, out + i / 4 * 3);
+
+    return (k < 0) ? -1 : i / 4 * 3 + k;
+}
+
+t_decode_hex* const decode_hex_neon = decode_hex_vld2;
+t_decode_base64* const decode_base64_neon = decode_base64_vld4;
+
+#else
+
+t_decode_hex* const decode_hex_neon = NULL;
+t_decode_base64* const decode_base64_neon = NULL;
+
+#endif
+
+t_decode_hex* get_decode_hex(void)
+// returns the fastest hex decode kernel that the cpu supports
+{
+    static t_decode_hex* kernel =
+        (decode_hex_neon != NULL) ? decode_hex_neon :
+        (decode_hex_ssse3 != NULL && get_cpu_features().ssse3) ? decode_hex_ssse3 :
+        decode_hex_portable;
+
+    return kernel;
+}
+
+t_decode_base64* get_decode_base64(void)
+// returns the fastest base64 decode kernel that the cpu supports
+{
+    static t_decode_base64* kernel =
+        (decode_base64_neon != NULL) ? decode_base64_neon :
+        (decode_base64_ssse3 != NULL && get_cpu_features().ssse3) ? decode_base64_ssse3 :
+        decode_base64_portable;
+
+    return kernel;
+}
+
+int decimal_length(int v)
+// returns the nr of chars of v in decimal notation, including the '-' of a negative number
+{
+    int length = (v < 0) ? 2 : 1;
+    unsigned int u = (v < 0) ? 0u - (unsigned int)v : (unsigned int)v;
+
+    while (u >= 10)
+    {
+        u /= 10;
+        length++;
+    }
+
+    return length;
+}
+
+char* encode_decimal(int v, char* out)
+// writes v in decimal notation to out, from the last digit backwards
+{
+    int length = decimal_length(v);
+    unsigned int u = (v < 0) ? 0u - (unsigned int)v : (unsigned int)v;
+    char* p = out + length;
+
+    do
+    {
+        *--p = (char)('0' + u % 10);
+        u /= 10;
+    } while (u > 0);
+
+    if (v < 0)
+        *--p = '-';
+
+    return out + length;
+}
@@ -0,0 +1,95 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * text_codec - fast conversion of the bytes of a telegram to hex and base64 text and back, used by the output stage and the parser
+ *
+ * Hex: each nibble is looked up in the 16 hex digits, 16 bytes at a time with a byte shuffle:
+ * - PSHUFB on x64 with SSSE3 (text_codec_ssse3.cpp)
+ * - TBL on ARM64, NEON is part of the baseline instruction set (text_codec.cpp)
+ * - a table of 256 character pairs, one pair per byte (text_codec.cpp)
+ * The kernel is selected at runtime, based on get_cpu_features().
+ *
+ * Base64: each 3 input bytes (24 bits) make 4 characters of 6 bits each:
+ * - SSSE3 (text_codec_ssse3.cpp): 12 bytes at a time. PSHUFB spreads the 3 bytes of each group over 4 bytes, multiplies
+ *   (PMULHUW/PMULLW) move the 4 values of 6 bits into the 4 bytes, PSHUFB looks up the offset of each value to its char.
+ * - NEON (text_codec.cpp): 48 bytes at a time, VLD3 separates the 3 bytes of each group, TBL looks up the 64 chars,
+ *   VST4 interleaves the 4 chars of each group.
+ * - a table of 4096 character pairs, 2 lookups of 12 bits per group (text_codec.cpp). Also writes the last bytes and the padding.
+ * The kernel is selected at runtime, like the hex kernel.
+ *
+ * The encoders write into a buffer of the caller and return a pointer behind the last character, no terminating 0 is written.
+ * The exact size of the output is known in advance (HEX_LENGTH, BASE64_LENGTH, decimal_length), so the output stage
+ * can determine the size of all lines, allocate one buffer and fill it without reallocations.
+ *
+ * The decoders validate and decode in one pass, without branches per character:
+ * - SSSE3 (text_codec_ssse3.cpp): 32 hex chars or 16 base64 chars at a time. The value of each char follows from its range
+ *   (compares), the values are merged into bytes with multiply-add (PMADDUBSW/PMADDWD) and a byte shuffle.
+ * - NEON (text_codec.cpp): 32 hex chars or 64 base64 chars at a time, VLD2/VLD4 separate the chars by their position.
+ * - a table of 256 values, one per char (text_codec.cpp). Also decodes the remaining chars of the vector kernels.
+ * A base64 text shall have a multiple of 4 chars, '=' is only accepted as padding in the last 2 chars.
+*/
+
+#ifndef TEXT_CODEC_H
+#define TEXT_CODEC_H
+
+#include <stdint.h>
+
+#define HEX_LENGTH(n_bytes)     (2 * (n_bytes))                 // nr of chars in the hex text of n_bytes bytes
+#define BASE64_LENGTH(n_bytes)  (4 * (((n_bytes) + 2) / 3))     // nr of chars in the base64 text of n_bytes bytes, including the padding
+
+// writes the n bytes of in as 2n uppercase hex chars to out, returns out + 2n
+typedef char* t_encode_hex(const uint8_t* in, int n, char* out);
+
+extern t_encode_hex encode_hex_portable;            // always available
+extern t_encode_hex* const encode_hex_ssse3;        // NULL if not compiled for x64
+extern t_encode_hex* const encode_hex_neon;         // NULL if not compiled for ARM64
+
+// returns the fastest hex kernel that the cpu supports
+t_encode_hex* get_encode_hex(void);
+
+// writes the n bytes of in as base64 text (with '=' padding) to out, returns out + BASE64_LENGTH(n)
+typedef char* t_encode_base64(const uint8_t* in, int n, char* out);
+
+extern t_encode_base64 encode_base64_portable;      // always available
+extern t_encode_base64* const encode_base64_ssse3;  // NULL if not compiled for x64
+extern t_encode_base64* const encode_base64_neon;   // NULL if not compiled for ARM64
+
+// returns the fastest base64 kernel that the cpu supports
+t_encode_base64* get_encode_base64(void);
+
+// decodes the 2n hex chars (upper- or lowercase) of in to n bytes in out, returns false if in contains an illegal char
+typedef bool t_decode_hex(const char* in, int n, uint8_t* out);
+
+// decodes the n_chars base64 chars of in to out, returns the nr of bytes in out or -1 if in is not valid base64
+typedef int t_decode_base64(const char* in, int n_chars, uint8_t* out);
+
+extern t_decode_hex decode_hex_portable;            // always available
+extern t_decode_hex* const decode_hex_ssse3;        // NULL if not compiled for x64
+extern t_decode_hex* const decode_hex_neon;         // NULL if not compiled for ARM64
+
+extern t_decode_base64 decode_base64_portable;      // always available
+extern t_decode_base64* const decode_base64_ssse3;  // NULL if not compiled for x64
+extern t_decode_base64* const decode_base64_neon;   // NULL if not compiled for ARM64
+
+// return the fastest decode kernels that the cpu supports
+t_decode_hex* get_decode_hex(void);
+t_decode_base64* get_decode_base64(void);
+
+// returns the nr of chars of v in decimal notation, including the '-' of a negative number
+int decimal_length(int v);
+
+// writes v in decimal notation to out, returns out + decimal_length(v)
+char* encode_decimal(int v, char* out);
+
+#endif
@@ -0,0 +1,172 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+// The PSHUFB kernels of text_codec.h. Compiled with -mssse3 (see CMakeLists.txt), only called if get_cpu_features().ssse3.
+
+#include "text_codec.h"
+#include "cpu_features.h"
+
+#if defined(SS36_X64)
+
+#include <tmmintrin.h>      // _mm_shuffle_epi8, _mm_maddubs_epi16, _mm_mulhi_epu16
+#include <string.h>         // memcpy
+
+static char* encode_hex_pshufb(const uint8_t* in, int n, char* out)
+// writes the n bytes of in as hex, 16 bytes at a time: PSHUFB looks up the high and low nibbles, UNPCK interleaves them
+{
+    int i;
+    __m128i b, hi, lo;
+    const __m128i table = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+    const __m128i mask = _mm_set1_epi8(0x0F);
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        b = _mm_loadu_si128((const __m128i*)(in + i));
+        hi = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(b, 4), mask));
+        lo = _mm_shuffle_epi8(table, _mm_and_si128(b, mask));
+        _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi8(hi, lo));
+        out += 32;
+    }
+
+    // the remaining bytes:
+    return encode_hex_portable(in + i, n - i, out);
+}
+
+static char* encode_base64_pshufb(const uint8_t* in, int n, char* out)
+// writes the n bytes of in as base64, 12 bytes at a time (16 are read):
+// PSHUFB copies the bytes b0 b1 b2 of each group to b1 b0 b2 b1, so that each 6-bit value lies within one 16-bit half.
+// PMULHUW moves the values 0 and 2 to bits 0..5 of their byte, PMULLW the values 1 and 3. Each value is then mapped
+// to its char by adding an offset: PSHUFB looks it up by the range of the value ('A'..'Z', 'a'..'z', '0'..'9', '+', '/').
+{
+    int i;
+    __m128i b, v, range;
+    const __m128i spread = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+    for (i = 0; i + 16 <= n; i += 12)
+    {
+        b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + i)), spread);
+        v = _mm_mulhi_epu16(_mm_and_si128(b, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+        v = _mm_or_si128(v, _mm_mullo_epi16(_mm_and_si128(b, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010)));
+
+        // the index of the offset: 0 for 26..51, 1..12 for 52..63 and 13 for 0..25:
+        range = _mm_subs_epu8(v, _mm_set1_epi8(51));
+        range = _mm_or_si128(range, _mm_and_si128(_mm_cmplt_epi8(v, _mm_set1_epi8(26)), _mm_set1_epi8(13)));
+        _mm_storeu_si128((__m128i*)out, _mm_add_epi8(v, _mm_shuffle_epi8(offsets, range)));
+        out += 16;
+    }
+
+    // the remaining bytes and the padding:
+    return encode_base64_portable(in + i, n - i, out);
+}
+
+static inline __m128i in_range(__m128i c, char lo, char hi)
+// returns 0xFF for each char of c in lo..hi, 0 otherwise. Signed compares: chars >= 0x80 are never in range.
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8(hi + 1)));
+}
+
+static inline __m128i hex_nibbles(__m128i c, __m128i* valid)
+// returns the values of the 16 hex chars in c, and-s the lanes of valid with 0 for each illegal char
+{
+    __m128i is_digit = in_range(c, '0', '9');
+    __m128i is_letter = in_range(_mm_or_si128(c, _mm_set1_epi8(0x20)), 'a', 'f');     // 'A'..'F' and 'a'..'f'
+    __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a' - 10));
+
+    *valid = _mm_and_si128(*valid, _mm_or_si128(is_digit, is_letter));
+
+    return _mm_or_si128(_mm_and_si128(is_digit, digit), _mm_and_si128(is_letter, letter));
+}
+
+static bool decode_hex_pmaddubsw(const char* in, int n, uint8_t* out)
+// decodes the 2n hex chars of in, 16 bytes at a time: PMADDUBSW merges each pair of nibbles into hi * 16 + lo
+{
+    int i;
+    __m128i first, second, valid;
+    const __m128i merge = _mm_set1_epi16(0x0110);       // the multipliers 16 (even char) and 1 (odd char)
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        valid = _mm_set1_epi8(-1);
+        first = hex_nibbles(_mm_loadu_si128((const __m128i*)(in + 2 * i)), &valid);
+        second = hex_nibbles(_mm_loadu_si128((const __m128i*)(in + 2 * i + 16)), &valid);
+
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            return false;
+
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(_mm_maddubs_epi16(first, merge), _mm_maddubs_epi16(second, merge)));
+    }
+
+    // the remaining bytes:
+    return decode_hex_portable(in + 2 * i, n - i, out + i);
+}
+
+static int decode_base64_pmaddubsw(const char* in, int n_chars, uint8_t* out)
+// decodes the n_chars base64 chars of in, 16 chars (=12 bytes) at a time:
+// PMADDUBSW and PMADDWD merge the 4 values of each group into 24 bits, PSHUFB puts the 3 bytes of each group in order.
+// The last 4 chars (with the padding) are always decoded by the portable kernel.
+{
+    int i, k;
+    __m128i c, v, valid, upper, lower, digit, plus, slash;
+    uint8_t bytes[16];
+    const __m128i order = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    if (n_chars % 4 != 0)
+        return -1;
+
+    for (i = 0; i + 16 <= n_chars - 4; i += 16)
+    {
+        c = _mm_loadu_si128((const __m128i*)(in + i));
+        upper = in_range(c, 'A', 'Z');
+        lower = in_range(c, 'a', 'z');
+        digit = in_range(c, '0', '9');
+        plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+        slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+
+        valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            return -1;
+
+        v = _mm_and_si128(upper, _mm_sub_epi8(c, _mm_set1_epi8('A')));
+        v = _mm_or_si128(v, _mm_and_si128(lower, _mm_sub_epi8(c, _mm_set1_epi8('a' - 26))));
+        v = _mm_or_si128(v, _mm_and_si128(digit, _mm_add_epi8(c, _mm_set1_epi8(52 - '0'))));
+        v = _mm_or_si128(v, _mm_and_si128(plus, _mm_set1_epi8(62)));
+        v = _mm_or_si128(v, _mm_and_si128(slash, _mm_set1_epi8(63)));
+
+        v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));  // v0 * 64 + v1, v2 * 64 + v3
+        v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));     // (v0v1) * 4096 + (v2v3)
+        _mm_storeu_si128((__m128i*)bytes, _mm_shuffle_epi8(v, order));
+        memcpy(out + i / 4 * 3, bytes, 12);
+    }
+
+    // the remaining chars:
+    k = decode_base64_portable(in + i, n_chars - i, out + i / 4 * 3);
+
+    return (k < 0) ? -1 : i / 4 * 3 + k;
+}
+
+t_encode_hex* const encode_hex_ssse3 = encode_hex_pshufb;
+t_encode_base64* const encode_base64_ssse3 = encode_base64_pshufb;
+t_decode_hex* const decode_hex_ssse3 = decode_hex_pmaddubsw;
+t_decode_base64* const decode_base64_ssse3 = decode_base64_pmaddubsw;
+
+#else
+
+t_encode_hex* const encode_hex_ssse3 = NULL;
+t_encode_base64* const encode_base64_ssse3 = NULL;
+t_decode_hex* const decode_hex_ssse3 = NULL;
+t_decode_base64* const decode_base64_ssse3 = NULL;
+
+#endif
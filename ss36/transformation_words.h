@@ -23,6 +23,7 @@ int find11(int val11);
 #define N_TRANS_WORDS   1024
 #define FIRST_TW_001    104 // index of first transformation word starting with 001
 #define LAST_TW_001     260 // index of last transformation word starting with 001
+#define N_TW_001        (LAST_TW_001 - FIRST_TW_001 + 1)    // nr of transformation words starting with 001 (possible values of word10)
 
 static unsigned short int transformation_words[N_TRANS_WORDS] = {
 00101, 00102, 00103, 00104, 00105, 00106, 00107, 00110, 00111, 00112,
@@ -0,0 +1,143 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+#include "undersampling.h"
+#include "cpu_features.h"
+
+#define E_WORDS ((UNDERSAMPLING_MAX_FACTOR * BITS_IN_LONGNUM + 63) / 64)    // max nr of 64-bit words in E
+
+class deinterleave_table
+// for each byte: the 4 even bits in the low nibble, the 4 odd bits in the high nibble
+{
+public:
+    uint8_t t[256];
+
+    deinterleave_table(void)
+    {
+        int b, j;
+
+        for (b = 0; b < 256; b++)
+        {
+            t[b] = 0;
+            for (j = 0; j < 4; j++)
+                t[b] |= (((b >> (2 * j)) & 1) << j) | (((b >> (2 * j + 1)) & 1) << (j + 4));
+        }
+    }
+};
+
+static const deinterleave_table byte_table;
+
+void deinterleave_portable(const uint64_t* in, int n_words, uint64_t* even, uint64_t* odd)
+// splits n_words 64-bit words in their even and odd bits, one byte at a time using a lookup table
+{
+    int k, b;
+    uint64_t e, o;
+    uint8_t t;
+
+    for (k = 0; k < n_words; k++)
+    {
+        e = 0;
+        o = 0;
+
+        for (b = 0; b < 8; b++)
+        {
+            t = byte_table.t[(in[k] >> (8 * b)) & 0xFF];
+            e |= (uint64_t)(t & 0xF) << (4 * b);
+            o |= (uint64_t)(t >> 4) << (4 * b);
+        }
+
+        // two input words make one output word:
+        if (k & 1)
+        {
+            even[k / 2] |= e << 32;
+            odd[k / 2] |= o << 32;
+        }
+        else
+        {
+            even[k / 2] = e;
+            odd[k / 2] = o;
+        }
+    }
+}
+
+t_deinterleave* get_deinterleave(void)
+// returns the fastest de-interleave kernel that the cpu supports
+{
+    static t_deinterleave* kernel = (deinterleave_bmi2 != NULL && get_cpu_features().bmi2) ? deinterleave_bmi2 : deinterleave_portable;
+
+    return kernel;
+}
+
+static inline uint64_t get64(const uint64_t* limbs, int bitnum)
+// returns the 64 bits of limbs starting at bitnum (limbs shall have one extra limb at the end)
+{
+    int shift = bitnum % 64;
+
+    if (shift == 0)
+        return limbs[bitnum / 64];
+    else
+        return (limbs[bitnum / 64] >> shift) | (limbs[bitnum / 64 + 1] << (64 - shift));
+}
+
+void undersample_telegram(t_deinterleave* deinterleave, const longnum& contents, int size, longnum* v)
+// fills v[0..UNDERSAMPLING_N_TELEGRAMS-1] with the undersampled telegrams of the lower size bits of contents (see undersampling.h)
+{
+    uint64_t c[LIMBS_IN_LONGNUM + 1];
+    uint64_t buf[2][E_WORDS + UNDERSAMPLING_MAX_FACTOR];    // the sequences of the current and the next level
+    uint64_t *cur = buf[0], *next = buf[1], *temp;
+    int w, s, n, i, j, f, n_words, n_words_next;
+
+    // copy the telegram into 64-bit limbs, clear the bits above size:
+    contents.write_to_limbs(c);
+    c[LIMBS_IN_LONGNUM] = 0;
+    for (i = size / 64 + 1; i < LIMBS_IN_LONGNUM; i++)
+        c[i] = 0;
+    if (size % 64)
+        c[size / 64] &= ((uint64_t)1 << (size % 64)) - 1;
+
+    // level 1: E = the telegram repeated 16 times
+    n_words = (UNDERSAMPLING_MAX_FACTOR * size + 63) / 64;
+    for (w = 0; w < n_words; w++)
+    {
+        s = (w * 64) % size;
+        n = size - s;       // nr of bits until the wrap-around
+
+        if (n >= 64)
+            cur[w] = get64(c, s);
+        else
+            cur[w] = get64(c, s) | (c[0] << n);
+    }
+
+    // levels 2, 4, 8, 16: split each sequence i of level f in sequence i (even bits) and i+f (odd bits) of level 2f
+    for (f = 1; f < UNDERSAMPLING_MAX_FACTOR; f *= 2)
+    {
+        n_words_next = (n_words + 1) / 2;
+
+        for (i = 0; i < f; i++)
+            deinterleave(cur + i * n_words, n_words, next + i * n_words_next, next + (i + f) * n_words_next);
+
+        // the first size bits of each sequence are the undersampled telegrams with factor 2f:
+        for (i = 0; i < 2 * f; i++)
+        {
+            longnum& ln = v[2 * f - 2 + i];
+
+            ln.read_from_limbs(next + i * n_words_next, (size + 63) / 64);
+            for (j = size; j < ((size + 63) / 64) * 64; j++)
+                ln.set_bit(j, 0);
+        }
+
+        temp = cur;
+        cur = next;
+        next = temp;
+        n_words = n_words_next;
+    }
+}
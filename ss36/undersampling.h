@@ -0,0 +1,51 @@
+#pragma once
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * undersampling - creates all undersampled telegrams that are needed for the undersampling condition (subset 36, 4.3.2.5.5)
+ *
+ * The undersampled telegram with factor f and offset i consists of the bits (j*f + i) mod size, for j = 0..size-1.
+ * All 30 of them (f = 2, 4, 8, 16 and i = 0..f-1) are created in one pass:
+ * - E = the telegram repeated 16 times (16*size bits), so bit k of E = bit (k mod size) of the telegram (this is the wrap-around)
+ * - split E in its even and odd bits: these are the sequences for f=2, i=0 and i=1
+ * - split each of these sequences in its even and odd bits: the sequences for f=4 (even of i -> i, odd of i -> i+2), etc.
+ * The first size bits of each sequence are the undersampled telegrams. Each level handles 16*size bits in total.
+ *
+ * The de-interleaving of the even and odd bits of a 64-bit word is done with:
+ * - PEXT on x64 with BMI2 (undersampling_bmi2.cpp)
+ * - a lookup table of 256 bytes (undersampling.cpp)
+ * The kernel is selected at runtime, based on get_cpu_features().
+*/
+
+#ifndef UNDERSAMPLING_H
+#define UNDERSAMPLING_H
+
+#include "longnum.h"
+
+#define UNDERSAMPLING_MAX_FACTOR    16      // the undersampling factors are 2, 4, 8 and 16
+#define UNDERSAMPLING_N_TELEGRAMS   30      // 2+4+8+16 undersampled telegrams
+
+// splits n_words 64-bit words in their even and odd bits: fills (n_words+1)/2 words in even and in odd
+typedef void t_deinterleave(const uint64_t* in, int n_words, uint64_t* even, uint64_t* odd);
+
+extern t_deinterleave deinterleave_portable;        // always available
+extern t_deinterleave* const deinterleave_bmi2;     // NULL if not compiled for x64
+
+// returns the fastest de-interleave kernel that the cpu supports
+t_deinterleave* get_deinterleave(void);
+
+// fills v[0..UNDERSAMPLING_N_TELEGRAMS-1] with the undersampled telegrams of the lower size bits of contents,
+// in the order f=2 (i=0,1), f=4 (i=0..3), f=8 (i=0..7), f=16 (i=0..15). Uses the kernel deinterleave.
+void undersample_telegram(t_deinterleave* deinterleave, const longnum& contents, int size, longnum* v);
+
+#endif
@@ -0,0 +1,53 @@
+/**
+* This file is part of "balise_codec".
+* balise_codec is free software: you can distribute it and/or modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+* without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* See the GNU Lesser General Public License for more details.
+* You should have received a copy of the GNU General Public License along with this program.
+* If not, see < https://www.gnu.org/licenses/>.
+*/
+
+// The PEXT kernel of undersampling.h. Compiled with -mbmi2 (see CMakeLists.txt), only called if get_cpu_features().bmi2.
+
+#include "undersampling.h"
+#include "cpu_features.h"
+
+#if defined(SS36_X64) && (defined(__BMI2__) || defined(_MSC_VER))
+
+#include <immintrin.h>      // _pext_u64
+
+static void deinterleave_pext(const uint64_t* in, int n_words, uint64_t* even, uint64_t* odd)
+// splits n_words 64-bit words in their even and odd bits, with one PEXT per 32 bits
+{
+    int k;
+    uint64_t e, o;
+
+    for (k = 0; k < n_words; k++)
+    {
+        e = _pext_u64(in[k], 0x5555555555555555);
+        o = _pext_u64(in[k], 0xAAAAAAAAAAAAAAAA);
+
+        // two input words make one output word:
+        if (k & 1)
+        {
+            even[k / 2] |= e << 32;
+            odd[k / 2] |= o << 32;
+        }
+        else
+        {
+            even[k / 2] = e;
+            odd[k / 2] = o;
+        }
+    }
+}
+
+t_deinterleave* const deinterleave_bmi2 = deinterleave_pext;
+
+#else
+
+t_deinterleave* const deinterleave_bmi2 = NULL;
+
+#endif
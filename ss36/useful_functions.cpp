@@ -17,6 +17,17 @@
 #include <string.h>
 #include "telegram.h"
 #include "parse_input.h"
+#include <errno.h>
+#include <fcntl.h>
+
+#if defined(_WIN32)
+#include <io.h>             // _open, _write, _close
+#include <sys/stat.h>       // _S_IREAD, _S_IWRITE
+#else
+#include <unistd.h>         // write, close
+#endif
+
+#define FD_WRITE_MAX    (1 << 30)       // max nr of chars per call of write
 
 bool check_verbose(int v)
 // returns true if v <= current verbosity level
@@ -198,3 +209,53 @@ signed int b64_decode(string in, uint8_t* out)
 
 	return k;
 }
+
+int open_output_fd(const string filename)
+// opens (creates or truncates) the file for writing, returns the file descriptor or -1 on error (see errno)
+// Windows: text mode, like fopen(filename, "w")
+{
+#if defined(_WIN32)
+	return _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_TEXT, _S_IREAD | _S_IWRITE);
+#else
+	return open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+#endif
+}
+
+bool write_to_fd(int fd, const char* buf, size_t n)
+// writes all n chars of buf to the file descriptor fd, retrying after partial writes and interrupts
+// returns true if success, false on error (see errno)
+{
+	long long written;
+	size_t chunk;
+
+	while (n > 0)
+	{
+		chunk = (n > FD_WRITE_MAX) ? FD_WRITE_MAX : n;
+#if defined(_WIN32)
+		written = _write(fd, buf, (unsigned int)chunk);
+#else
+		written = write(fd, buf, chunk);
+#endif
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		buf += written;
+		n -= (size_t)written;
+	}
+
+	return true;
+}
+
+void close_fd(int fd)
+// closes the file descriptor
+{
+#if defined(_WIN32)
+	_close(fd);
+#else
+	close(fd);
+#endif
+}
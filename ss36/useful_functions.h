@@ -63,4 +63,14 @@ unsigned int b64_encode(const uint8_t* in, unsigned int in_len, string& out);
 // returns size of output excluding null byte
 signed int b64_decode(string in, uint8_t* out);
 
+// opens (creates or truncates) the file for writing, returns the file descriptor or -1 on error (see errno)
+int open_output_fd(const string filename);
+
+// writes all n chars of buf to the file descriptor fd, retrying after partial writes
+// returns true if success, false on error (see errno)
+bool write_to_fd(int fd, const char* buf, size_t n);
+
+// closes the file descriptor
+void close_fd(int fd);
+
 #endif
\ No newline at end of file
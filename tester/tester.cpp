@@ -18,6 +18,11 @@
 #include "telegram.h"
 #include "parse_input.h"
 #include "balise_codec.h"     // included to test functions in this file. 
+#include "scrambler.h"
+#include "check_bits.h"
+#include "undersampling.h"
+#include "cpu_features.h"
+#include "text_codec.h"
 
 int verbose = VERB_PROG;
  
@@ -279,6 +284,103 @@ int test_long_write_at_location(int* errs)
     return err;
 }
 
+t_word get_word_wraparound_bitwise(const longnum& ln, int size, int bitnum)
+// the bit by bit version of longnum::get_word_wraparound, used as a reference
+{
+    int i, n = 0;
+    t_word retval = 0;
+
+    if (size)
+        n = (bitnum % size + size) % size;
+
+    for (i = n + BITS_IN_WORD - 1; i >= n; i--)
+    {
+        retval <<= 1;
+        retval |= ln.get_bit((i < size) ? i : i - size);
+    }
+
+    return retval;
+}
+
+void write_at_location_bitwise(longnum& ln, int location, const t_word* newvalue, int n_bits)
+// the bit by bit version of longnum::write_at_location, used as a reference
+{
+    int i;
+
+    for (i = 0; i < n_bits; i++)
+        ln.set_bit(location + i, (newvalue[i / BITS_IN_WORD] >> (i % BITS_IN_WORD)) & 1);
+}
+
+int test_word_level_access(int count, int* errs)
+// compares get_word_wraparound and write_at_location with their bit by bit versions at random positions in telegrams of both sizes,
+// writing up to 3 words at a time. Prints the time per call of both versions (microbenchmark).
+{
+    int i, size, location, n_bits, err = 0;
+    int positions[1000];
+    t_word w[3], sum = 0;
+    longnum ln(FILL_RANDOM), ln2, ln_ref;
+    clock_t start;
+    double t_word_level[2], t_bitwise[2];
+
+    for (i = 0; i < count; i++)
+    // correctness
+    {
+        size = (i % 2) ? BITLENGTH_LONG_TELEGRAM : BITLENGTH_SHORT_TELEGRAM;
+        location = rand() % BITS_IN_LONGNUM;
+        n_bits = rand() % (3 * BITS_IN_WORD + 1);
+        w[0] = (rand() << 16) ^ rand();
+        w[1] = (rand() << 16) ^ rand();
+        w[2] = (rand() << 16) ^ rand();
+
+        if (ln.get_word_wraparound(size, location - size) != get_word_wraparound_bitwise(ln, size, location - size))
+        {
+            eprintf(VERB_GLOB, "\nError in get_word_wraparound, size=%d, bitnum=%d.\n", size, location - size);
+            err++;
+        }
+
+        ln2 = ln;
+        ln_ref = ln;
+        ln2.write_at_location(location, w, n_bits);
+        write_at_location_bitwise(ln_ref, location, w, (location + n_bits > BITS_IN_LONGNUM) ? BITS_IN_LONGNUM - location : n_bits);
+        if (ln2 != ln_ref)
+        {
+            eprintf(VERB_GLOB, "\nError in write_at_location, location=%d, n_bits=%d.\n", location, n_bits);
+            err++;
+        }
+    }
+
+    // microbenchmark: the OSPC-reads and the 11-bit writes during shaping
+    for (i = 0; i < 1000; i++)
+        positions[i] = rand() % BITLENGTH_LONG_TELEGRAM;
+
+    start = clock();
+    for (i = 0; i < 100 * 1000; i++)
+        sum += ln.get_word_wraparound(BITLENGTH_LONG_TELEGRAM, positions[i % 1000]);
+    t_word_level[0] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (i = 0; i < 100 * 1000; i++)
+        sum += get_word_wraparound_bitwise(ln, BITLENGTH_LONG_TELEGRAM, positions[i % 1000]);
+    t_bitwise[0] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (i = 0; i < 100 * 1000; i++)
+        ln.write_at_location(positions[i % 1000], &sum, 11);
+    t_word_level[1] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (i = 0; i < 100 * 1000; i++)
+        write_at_location_bitwise(ln, positions[i % 1000], &sum, 11);
+    t_bitwise[1] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    // 100*1000 calls: secs * 1e4 = ns per call
+    printf("(get_word_wraparound: %.1f -> %.1f ns, write_at_location(11 bits): %.1f -> %.1f ns per call) ",
+        t_bitwise[0] * 1e4, t_word_level[0] * 1e4, t_bitwise[1] * 1e4, t_word_level[1] * 1e4);
+
+    *errs += err;
+    return err;
+}
+
 int test_long_get_order(int* errs)
 // tests the function long_get_order by trying all possibilities.
 // Returns the amount of errors that occurred.
@@ -304,6 +406,42 @@ int test_long_get_order(int* errs)
     return err;
 }
 
+template <int N_BITS>
+int test_longnum_size(int count, int* errs)
+// compares the operations on a longnum_t<N_BITS> with the same operations on a longnum, of which the higher bits are masked out
+// returns the amount of errors that occurred
+{
+    int i, shift, err = 0;
+    longnum a, b, mask;
+    longnum_t<N_BITS> a_n, b_n;
+
+    mask.fill(0);
+    for (i = 0; i < longnum_t<N_BITS>::BITS; i++)
+        mask.set_bit(i, 1);
+
+    for (i = 0; i < count; i++)
+    {
+        a.fill(FILL_RANDOM);
+        b.fill(FILL_RANDOM);
+        a &= mask;
+        b &= mask;
+        a_n = a;    // conversion to the smaller size
+        b_n = b;
+        shift = rand() % longnum_t<N_BITS>::BITS;
+
+        if ((longnum(a_n) != a) || (longnum(a_n ^ b_n) != (a ^ b)) || (longnum(a_n >> shift) != (a >> shift)) ||
+            (longnum(a_n << shift) != ((a << shift) & mask)) || (a_n.get_order() != a.get_order()) || 
+            (a_n.get_word(shift) != a.get_word(shift)))
+        {
+            eprintf(VERB_GLOB, "\nError in longnum_t<%d>, shift=%d.\n", N_BITS, shift);
+            err++;
+        }
+    }
+
+    *errs += err;
+    return err;
+}
+
 int test_division(int* errs)
 {
     longnum numerator (FILL_RANDOM), denominator, quotient, remainder;   // teller, noemer, quotient, rest. teller/noemer = quotient; teller%noemer=rest; teller=quotient*noemer+rest
@@ -352,6 +490,65 @@ int test_divisions(int n, int* errs)
     return err;
 }
 
+int test_gf2_kernels(const t_gf2_kernels* kernels, int n, int* errs)
+// compares n random multiplications and divisions by small denominators (order 2..128) of the GF2 kernels with the bitwise longnum functions
+{
+    int i, order, err = 0;
+    longnum a, b, product, quotient, remainder, temp_q, temp_r;
+    uint64_t la[LIMBS_IN_LONGNUM], lb[LIMBS_IN_LONGNUM], lr[LIMBS_IN_LONGNUM], lrem[2];
+
+    for (i = 0; i < n; i++)
+    {
+        a.fill(FILL_RANDOM);
+        b.fill(FILL_RANDOM);
+
+        // multiplication:
+        product = a;
+        product.GF2_multiply_portable(b);
+
+        a.write_to_limbs(la);
+        b.write_to_limbs(lb);
+        kernels->multiply(la, lb, lr, LIMBS_IN_LONGNUM);
+        temp_q.read_from_limbs(lr, LIMBS_IN_LONGNUM);
+
+        if ((temp_q != product) || (a * b != product))
+        {
+            eprintf(VERB_GLOB, "\nError in %s GF2-multiplication.\n", kernels->name);
+            err++;
+        }
+
+        // division by a denominator with an order of 2..128:
+        order = 2 + (i % (GF2_BARRETT_MAX_DEGREE));
+        b = b >> (BITS_IN_LONGNUM - order);
+        b.set_bit(order - 1, 1);
+
+        a.GF2_division_portable(b, quotient, remainder);
+
+        b.write_to_limbs(lb);
+        gf2_barrett barrett(lb);
+        kernels->divide(barrett, la, LIMBS_IN_LONGNUM, lr, lrem);
+        temp_q.read_from_limbs(lr, LIMBS_IN_LONGNUM);
+        temp_r.read_from_limbs(lrem, 2);
+
+        if ((temp_q != quotient) || (temp_r != remainder))
+        {
+            eprintf(VERB_GLOB, "\nError in %s GF2-division, denominator order %d.\n", kernels->name, order);
+            err++;
+        }
+
+        // the longnum division (using the fastest backend):
+        a.GF2_division(b, temp_q, temp_r);
+        if ((temp_q != quotient) || (temp_r != remainder))
+        {
+            eprintf(VERB_GLOB, "\nError in longnum GF2-division, denominator order %d.\n", order);
+            err++;
+        }
+    }
+
+    *errs += err;
+    return err;
+}
+
 int run_encoding_decoding_test(int count, int* errcount)
 // tests the functions to read from and write to hex/base64 strings
 // generates "count" random bit sequences of random telegramlength, encodes them and decodes them, checks against original values
@@ -427,6 +624,187 @@ int run_encoding_decoding_test(int count, int* errcount)
     return err;
 }
 
+int test_scrambler_tables(int count, int* errs)
+// tests the table driven scrambler and descrambler against the bitwise shift register for count random values of S and input bits
+// returns the amount of errors found
+{
+    int i, j, err = 0;
+    t_S S, S_bit, S_table, S_desc;
+    t_word in10, out_bit, out_table, out_desc, bit_out;
+
+    for (i = 0; i < count; i++)
+    {
+        S = ((t_S)rand() << 16) ^ (t_S)rand() ^ ((t_S)rand() << 31);
+        in10 = rand() & 0x3FF;
+
+        // bitwise reference (see scramble_transform_check_user_data):
+        S_bit = S;
+        out_bit = 0;
+        for (j = 9; j >= 0; j--)
+        {
+            bit_out = (S_bit >> 31) ^ ((in10 >> j) & 1);
+            out_bit += bit_out << j;
+            S_bit <<= 1;
+            if (bit_out)
+                S_bit ^= H;
+        }
+
+        S_table = S;
+        out_table = scrambler.scramble10(S_table, in10);
+
+        // descrambling the scrambled bits should give the input bits and the same S:
+        S_desc = S;
+        out_desc = scrambler.descramble10(S_desc, out_table);
+
+        if ((out_bit != out_table) || (S_bit != S_table) || (out_desc != in10) || (S_desc != S_table))
+        {
+            err++;
+            eprintf(VERB_GLOB, "\nERR, scrambler tables fail: S=%08X; in=%03X; bitwise=%03X/%08X; tables=%03X/%08X; descrambled=%03X/%08X\n",
+                S, in10, out_bit, S_bit, out_table, S_table, out_desc, S_desc);
+        }
+    }
+
+    *errs += err;
+    return err;
+}
+
+int test_scrambler_keystreams(int count, int* errs)
+// compares the scrambling with the precomputed keystreams (q ^ ks) with the chained 10-bit scrambler for count random
+// user data and scrambling bits, for long and short telegrams. Also compares the shaped contents of both paths.
+// returns the amount of errors found
+{
+    int i, j, n_words, err = 0, res_chain, res_ks;
+    t_sb sb;
+    t_S S;
+    enum t_size size;
+    longnum_userdata U;
+    longnum contents_chain;
+    uint16_t q[SCRAMBLER_MAX_WORDS];
+    const scrambler_keystreams& keystreams = get_scrambler_keystreams();
+
+    for (i = 0; i < count; i++)
+    {
+        size = (i % 2) ? s_long : s_short;
+        telegram t("", size);
+        n_words = t.number_of_userbits / 10;
+
+        U.fill(FILL_RANDOM);
+        sb = rand() % SCRAMBLER_N_SB;
+        keystreams.scramble_zero_state(U, n_words, q, scrambler);
+
+        S = telegram::determine_S(sb);
+        for (j = 0; j < n_words; j++)
+            if ((q[j] ^ keystreams.ks[sb][j]) != scrambler.scramble10(S, U.get_word((n_words - 1 - j) * 10)))
+            {
+                eprintf(VERB_GLOB, "\nERR, keystream fails: size=%d; sb=%d; word=%d\n", size, sb, j);
+                err++;
+                break;
+            }
+
+        // both paths must write the same shaped data and give the same result of the OSPC check:
+        t.contents.fill(0);
+        res_chain = t.scramble_transform_check_user_data(telegram::determine_S(sb), H, U);
+        contents_chain = t.contents;
+        t.contents.fill(0);
+        res_ks = t.transform_check_keystream(q, keystreams.ks[sb]);
+
+        if ((res_chain != res_ks) || (contents_chain != t.contents))
+        {
+            eprintf(VERB_GLOB, "\nERR, keystream shaping differs: size=%d; sb=%d; results=%d/%d\n", size, sb, res_chain, res_ks);
+            err++;
+        }
+    }
+
+    *errs += err;
+    return err;
+}
+
+int test_check_bits_tables(int count, int* errs)
+// compares the table driven check bits of count random long and short telegrams with the bitwise GF2-division
+// the check bits are calculated four times per telegram with a random ESB, the last three times using the intermediate result
+{
+    int i, j, err = 0;
+    enum t_size size;
+    longnum fg, g, quotient, remainder, expected;
+    longnum_checkbits calculated;
+
+    for (i = 0; i < count; i++)
+    {
+        size = (i % 2) ? s_long : s_short;
+        const check_bits_tables& tables = (size == s_long) ? check_bits_long : check_bits_short;
+        telegram t("", size);
+
+        for (j = 0; j < 3; j++)
+        {
+            fg[j] = tables.fg[j];
+            g[j] = tables.g[j];
+        }
+
+        t.contents.fill(FILL_RANDOM);
+        t.contents >>= BITS_IN_LONGNUM - size;
+        t.set_scrambling_bits(rand() % 4096);
+
+        for (j = 0; j < 4; j++)
+        {
+            t.set_extra_shaping_bits(rand() % 1024);
+            t.compute_check_bits_opt();
+
+            // the bitwise calculation: remainder of the telegram with cleared check bits, plus g
+            expected = t.contents;
+            expected[0] = 0;
+            expected[1] = 0;
+            expected[2] &= 0xFFE00000;
+            expected.GF2_division_portable(fg, quotient, remainder);
+            expected = remainder + g;
+
+            t.get_checkbits(calculated);
+
+            if (calculated != expected)
+            {
+                eprintf(VERB_GLOB, "\nError in check bits, size=%d, j=%d.\n", size, j);
+                err++;
+            }
+        }
+    }
+
+    *errs += err;
+    return err;
+}
+
+int test_undersampling(t_deinterleave* deinterleave, int count, int* errs)
+// compares the undersampled telegrams of count random long and short telegrams with the bitwise construction
+{
+    int i, j, n, factor, offset, size, err = 0;
+    longnum contents, expected, v[UNDERSAMPLING_N_TELEGRAMS];
+
+    for (i = 0; i < count; i++)
+    {
+        size = (i % 2) ? BITLENGTH_LONG_TELEGRAM : BITLENGTH_SHORT_TELEGRAM;
+        contents.fill(FILL_RANDOM);
+        contents >>= BITS_IN_LONGNUM - size;
+
+        undersample_telegram(deinterleave, contents, size, v);
+
+        n = 0;
+        for (factor = 2; factor <= UNDERSAMPLING_MAX_FACTOR; factor *= 2)
+            for (offset = 0; offset < factor; offset++, n++)
+            {
+                expected.fill(0);
+                for (j = 0; j < size; j++)
+                    expected.set_bit(j, contents.get_bit((j * factor + offset) % size));
+
+                if (v[n] != expected)
+                {
+                    eprintf(VERB_GLOB, "\nError in undersampled telegram, size=%d, factor=%d, offset=%d.\n", size, factor, offset);
+                    err++;
+                }
+            }
+    }
+
+    *errs += err;
+    return err;
+}
+
 telegram* create_random_telegram(void)
 // creates a random telegram: random length and random user data
 {
@@ -450,31 +828,295 @@ telegram* create_random_telegram(void)
     return tel;
 }
 
-telegram* generate_random_telegrams(int count)
-// generates a linked list of random telegrams (only unshaped user data, random length)
-// returns a pointer to the first telegram
+int test_parallel_search(int count, int n_threads, int* errs)
+// shapes count random telegrams with the search distributed over n_threads threads and compares them with shape_opt
 {
-    int i = 0;
-    telegram* tel_list = NULL;
-    telegram* current_tel = NULL;
+    int i, err = 0;
+    telegram *expected, *tel;
+    BS::thread_pool pool(n_threads);
 
     for (i = 0; i < count; i++)
     {
-        if (i == 0)
+        expected = create_random_telegram();
+
+        // a fresh telegram with the same user data:
+        tel = new telegram("", expected->size);
+        tel->deshaped_contents = expected->deshaped_contents;
+        tel->alignment = a_calc;
+
+        shape_telegram_parallel(tel, pool);
+        expected->shape_opt();
+
+        if ((tel->contents != expected->contents) || (tel->word9 != expected->word9) || (tel->word10 != expected->word10))
         {
-            tel_list = create_random_telegram();
-            current_tel = tel_list;
+            eprintf(VERB_GLOB, "\nError in telegram #%d of size %d shaped with a parallel search.\n", i, expected->size);
+            err++;
         }
-        else
+
+        delete expected;
+        delete tel;
+    }
+
+    *errs += err;
+    return err;
+}
+
+int test_take_chunk(int count, int* errs)
+// checks that take_chunk hands out each telegram exactly once, for count random nr's of telegrams, chunk sizes and threads
+// the adaptive size must decrease towards the end
+{
+    int i, err = 0;
+    unsigned int n, chunk_size, n_threads, first, size, expected_first, last_size;
+    std::atomic<unsigned int> next;
+
+    for (i = 0; i < count; i++)
+    {
+        n = rand() % 5000;
+        chunk_size = (i % 2) ? rand() % 100 : 0;
+        n_threads = 1 + rand() % 16;
+        next = 0;
+        expected_first = 0;
+        last_size = n + 1;
+
+        while ((size = take_chunk(next, n, chunk_size, n_threads, &first)) > 0)
         {
-            current_tel->next = create_random_telegram();
-            current_tel = current_tel->next;
+            if ((first != expected_first) || ((chunk_size > 0) && (size > chunk_size)) || ((chunk_size == 0) && (size > last_size)))
+            {
+                eprintf(VERB_GLOB, "\nERR, take_chunk: n=%d; chunk_size=%d; first=%d (expected %d); size=%d\n", n, chunk_size, first, expected_first, size);
+                err++;
+                break;
+            }
+
+            expected_first += size;
+            last_size = size;
+        }
+
+        if (expected_first != n)
+        {
+            eprintf(VERB_GLOB, "\nERR, take_chunk handed out %d of %d telegrams\n", expected_first, n);
+            err++;
         }
     }
 
-    eprintf(VERB_ALL, "Created list of %d random telegrams.\n", count);
+    *errs += err;
+    return err;
+}
 
-    return tel_list;
+int test_text_codec(int count, int* errs)
+// compares the hex and base64 kernels and the decimal encoder with the reference functions, for count random byte arrays
+{
+    int i, j, k, n, v, err = 0;
+    uint8_t bytes[300];
+    char out[4 * sizeof(bytes)], temp[3];
+    char* end;
+    string expected, b64;
+    t_encode_hex* kernels[3] = { encode_hex_portable, encode_hex_ssse3, encode_hex_neon };
+    t_encode_base64* b64_kernels[3] = { encode_base64_portable, encode_base64_ssse3, encode_base64_neon };
+
+    if (!get_cpu_features().ssse3)
+    {
+        kernels[1] = NULL;
+        b64_kernels[1] = NULL;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        n = rand() % (int)sizeof(bytes);
+        expected = "";
+        for (j = 0; j < n; j++)
+        {
+            bytes[j] = (uint8_t)rand();
+            snprintf(temp, sizeof(temp), "%02X", bytes[j]);
+            expected += temp;
+        }
+
+        for (k = 0; k < 3; k++)
+            if (kernels[k] != NULL)
+            {
+                end = kernels[k](bytes, n, out);
+                if ((end - out != HEX_LENGTH(n)) || (string(out, end - out) != expected))
+                {
+                    eprintf(VERB_GLOB, "\nERR, hex kernel %d, n=%d: %s\n", k, n, string(out, end - out).c_str());
+                    err++;
+                }
+            }
+
+        b64_encode(bytes, n, b64);
+        for (k = 0; k < 3; k++)
+            if (b64_kernels[k] != NULL)
+            {
+                end = b64_kernels[k](bytes, n, out);
+                if ((end - out != BASE64_LENGTH(n)) || (string(out, end - out) != b64))
+                {
+                    eprintf(VERB_GLOB, "\nERR, base64 kernel %d, n=%d: %s != %s\n", k, n, string(out, end - out).c_str(), b64.c_str());
+                    err++;
+                }
+            }
+
+        v = (i == 0) ? INT32_MIN : rand() - RAND_MAX / 2;
+        end = encode_decimal(v, out);
+        if ((end - out != decimal_length(v)) || (string(out, end - out) != to_string(v)))
+        {
+            eprintf(VERB_GLOB, "\nERR, decimal %d: %s\n", v, string(out, end - out).c_str());
+            err++;
+        }
+    }
+
+    *errs += err;
+    return err;
+}
+
+int test_text_decoders(int count, int* errs)
+// compares the hex and base64 decode kernels with hex_to_bin and b64_decode for count random byte arrays,
+// and checks that an illegal char anywhere in the text is detected
+{
+    int i, j, k, n, pos, err = 0;
+    uint8_t bytes[300], expected[300], decoded[300];
+    char temp[3];
+    string hex, b64;
+    t_decode_hex* hex_kernels[3] = { decode_hex_portable, decode_hex_ssse3, decode_hex_neon };
+    t_decode_base64* b64_kernels[3] = { decode_base64_portable, decode_base64_ssse3, decode_base64_neon };
+    const char illegal_hex[] = "gG=-_ \x80\xff";
+    const char illegal_b64[] = "=-_ .\x80\xff";
+
+    if (!get_cpu_features().ssse3)
+    {
+        hex_kernels[1] = NULL;
+        b64_kernels[1] = NULL;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        n = 1 + rand() % (int)sizeof(bytes);
+        hex = "";
+        for (j = 0; j < n; j++)
+        {
+            bytes[j] = (uint8_t)rand();
+            snprintf(temp, sizeof(temp), (rand() % 2) ? "%02X" : "%02x", bytes[j]);
+            hex += temp;
+        }
+        b64_encode(bytes, n, b64);
+
+        hex_to_bin(hex, expected);
+        for (k = 0; k < 3; k++)
+            if (hex_kernels[k] != NULL)
+            {
+                if (!hex_kernels[k](hex.data(), n, decoded) || (memcmp(decoded, expected, n) != 0))
+                {
+                    eprintf(VERB_GLOB, "\nERR, hex decode kernel %d, n=%d\n", k, n);
+                    err++;
+                }
+
+                pos = rand() % (int)hex.length();
+                temp[0] = hex[pos];
+                hex[pos] = illegal_hex[rand() % (sizeof(illegal_hex) - 1)];
+                if (hex_kernels[k](hex.data(), n, decoded))
+                {
+                    eprintf(VERB_GLOB, "\nERR, hex decode kernel %d accepted '%c' at %d\n", k, hex[pos], pos);
+                    err++;
+                }
+                hex[pos] = temp[0];
+            }
+
+        b64_decode(b64, expected);
+        for (k = 0; k < 3; k++)
+            if (b64_kernels[k] != NULL)
+            {
+                if ((b64_kernels[k](b64.data(), (int)b64.length(), decoded) != n) || (memcmp(decoded, expected, n) != 0))
+                {
+                    eprintf(VERB_GLOB, "\nERR, base64 decode kernel %d, n=%d\n", k, n);
+                    err++;
+                }
+
+                // an illegal char, or a '=' that is not padding:
+                pos = rand() % ((int)b64.length() - 2);
+                temp[0] = b64[pos];
+                b64[pos] = illegal_b64[rand() % (sizeof(illegal_b64) - 1)];
+                if (b64_kernels[k](b64.data(), (int)b64.length(), decoded) != -1)
+                {
+                    eprintf(VERB_GLOB, "\nERR, base64 decode kernel %d accepted '%c' at %d\n", k, b64[pos], pos);
+                    err++;
+                }
+                b64[pos] = temp[0];
+            }
+    }
+
+    *errs += err;
+    return err;
+}
+
+int test_split_lines(int count, int* errs)
+// splits count random texts in chunks (see split_lines) and checks that the chunks are the text, cut after line delimiters,
+// and that parsing the chunks gives the same telegrams as parsing the whole text
+{
+    int i, j, n_lines, err = 0;
+    unsigned int n_chunks;
+    string text, joined;
+    vector<string_view> chunks;
+    telegram_batch whole, parts, part;
+    const char* lines[] = { "", "# comment", "garbage;", ";;", "\r",
+        "122B598615DCBE810BEACD557705A54B5EDBBBE5CE7F8FBEEBEF40", "ffffffffffffffffffffffffffffffffffffffffffffffffffffff  # all ones" };
+
+    for (i = 0; i < count; i++)
+    {
+        text = "";
+        n_lines = rand() % 50;
+        for (j = 0; j < n_lines; j++)
+            text += string(lines[rand() % (sizeof(lines) / sizeof(lines[0]))]) + ((j < n_lines - 1) || (rand() % 2) ? "\n" : "");
+
+        n_chunks = 1 + rand() % 20;
+        chunks = split_lines(text, n_chunks);
+
+        joined = "";
+        for (j = 0; j < (int)chunks.size(); j++)
+        {
+            joined += chunks[j];
+            if ((j < (int)chunks.size() - 1) && (chunks[j].back() != LINE_DELIM))
+                err++;
+        }
+
+        whole = parse_content_string(text);
+        parts.clear();
+        for (string_view chunk : chunks)
+        {
+            part = parse_content_string(chunk);
+            parts.insert(parts.end(), part.begin(), part.end());
+        }
+
+        if ((joined != text) || (chunks.size() > n_chunks) || (whole.size() != parts.size()))
+        {
+            eprintf(VERB_GLOB, "\nERR, split_lines: %d chunks of %d, %d telegrams in the chunks, %d in the text\n",
+                (int)chunks.size(), n_chunks, (int)parts.size(), (int)whole.size());
+            err++;
+            continue;
+        }
+
+        for (j = 0; j < (int)whole.size(); j++)
+            if ((whole[j].input_string != parts[j].input_string) || (whole[j].errcode != parts[j].errcode))
+                err++;
+    }
+
+    *errs += err;
+    return err;
+}
+
+telegram_batch generate_random_telegrams(int count)
+// generates a batch of random telegrams (only unshaped user data, random length)
+{
+    int i = 0;
+    telegram* tel;
+    telegram_batch telegrams;
+
+    for (i = 0; i < count; i++)
+    {
+        tel = create_random_telegram();
+        telegrams.push_back(*tel);
+        delete tel;
+    }
+
+    eprintf(VERB_ALL, "Created batch of %d random telegrams.\n", count);
+
+    return telegrams;
 }
 /*
 telegram* generate_random_telegrams(int count)
@@ -510,7 +1152,7 @@ telegram* generate_random_telegrams(int count)
 int run_shape_deshape_list_test(int count, int* errcount)
 // runs a shape/deshape test using the multithreading-function from balise_codec.cpp:
 {
-    telegram* telegramlist;
+    telegram_batch telegramlist;
 
     telegramlist = generate_random_telegrams(count);
 
@@ -529,14 +1171,15 @@ int run_make_long_test(int count, int* errcount)
 {
     int i = 0, err = 0;
     longnum short_data;
-    telegram *telegramlist, *p_telegram;
+    telegram_batch telegramlist;
+    telegram* p_telegram;
 
     telegramlist = generate_random_telegrams(count);
-    p_telegram = telegramlist;
 
-    // iterate over the telegrams in the list:
-    while (p_telegram)
+    // iterate over the telegrams in the batch:
+    for (telegram& t : telegramlist)
     {
+        p_telegram = &t;
         i++;
 
         if (p_telegram->number_of_userbits == N_USERBITS_S)
@@ -562,8 +1205,6 @@ int run_make_long_test(int count, int* errcount)
                 err++;
             }
         }
-
-        p_telegram = p_telegram->next;
     }
 
     *errcount += err;
@@ -763,7 +1404,7 @@ int test_zp_results(int* error_count)
 
     int i = 0, result = 0, err_location, local_error = 0;
     telegram* p_telegram = new telegram(zp_test_telegram, s_long);
-    longnum Utick;
+    longnum_userdata Utick;
     t_word cb = 1;
 
     p_telegram->align(a_calc);
@@ -818,18 +1459,20 @@ int check_against_zp(int* error_count)
 {
     int i=0, local_error=0;
     telegram* p_telegram;
+    telegram_batch variants;
 
-    // create the telegram and the shortlist parameters:
-    telegram *p_test_telegram = new telegram(zp_test_telegram, s_long);
-    p_test_telegram->action = act_shape;
+    // create the telegram:
+    telegram test_telegram(zp_test_telegram, s_long);
+    test_telegram.action = act_shape;
 
     // calculate all possible telegrams:
-    telegram_calc_all(p_test_telegram);
+    telegram_calc_all(&test_telegram, variants);
 
     // check the outcome against the results of ZP:
-    p_telegram = p_test_telegram;
-    while (p_telegram)
+    for (telegram& t : variants)
     {
+        p_telegram = &t;
+
         if ((zp_results[i].sb != p_telegram->get_scrambling_bits()) || (zp_results[i].esb != p_telegram->get_extra_shaping_bits()))
         // an error was found
         {
@@ -837,7 +1480,6 @@ int check_against_zp(int* error_count)
             local_error++;
         }
 
-        p_telegram = p_telegram->next;
         i++;
     }
 
@@ -879,18 +1521,52 @@ int main(void)
     printf("Testing long_write_at_location:\t\t\t");
     print_result(test_long_write_at_location(&error_count));
 
+    printf("Testing word level access against bitwise: ");
+    print_result(test_word_level_access(10000, &error_count));
+
     printf("Testing long_get_order:\t\t\t\t");
     print_result(test_long_get_order(&error_count));
 
+    printf("Testing longnum sizes (85, 341, 830 bits):\t");
+    print_result(test_longnum_size<85>(100, &error_count) + test_longnum_size<830>(100, &error_count));
+
     // test longnum division and multiplication:
     printf("Testing 50*GF2-divison & multiplication:\t");
     print_result(test_divisions(50, &error_count));
 
     // test encoding schemes:
+    printf("Testing GF2 kernels (portable):\t\t\t");
+    print_result(test_gf2_kernels(&gf2_kernels_portable, 500, &error_count));
+
+    if (gf2_get_hw_kernels() != NULL)
+    {
+        printf("Testing GF2 kernels (%s):\t\t\t", gf2_get_hw_kernels()->name);
+        print_result(test_gf2_kernels(gf2_get_hw_kernels(), 500, &error_count));
+    }
+
     printf("Testing HEX and BASE64 encoding/decoding:\t");
     print_result(run_encoding_decoding_test(100, &error_count));
     
+    // test the lookup tables of the scrambler:
+    printf("Testing scrambler tables:\t\t\t");
+    print_result(test_scrambler_tables(10000, &error_count));
+
+    printf("Testing scrambler keystreams:\t\t\t");
+    print_result(test_scrambler_keystreams(1000, &error_count));
+
     // test telegram creation functions:
+    printf("Testing check bits tables:\t\t\t");
+    print_result(test_check_bits_tables(1000, &error_count));
+
+    printf("Testing undersampling (portable):\t\t");
+    print_result(test_undersampling(deinterleave_portable, 100, &error_count));
+
+    if (deinterleave_bmi2 != NULL && get_cpu_features().bmi2)
+    {
+        printf("Testing undersampling (bmi2):\t\t\t");
+        print_result(test_undersampling(deinterleave_bmi2, 100, &error_count));
+    }
+
     printf("Testing make_long:\t\t\t\t");
     print_result(run_make_long_test(50, &error_count));
 /*
@@ -909,6 +1585,21 @@ int main(void)
         print_result(run_shape_test(telegrams, &error_count));
     }
 */
+    printf("Testing parallel search of SB/ESB of 20 random telegrams:\t");
+    print_result(test_parallel_search(20, 4, &error_count));
+
+    printf("Testing chunks of telegrams for the threads:\t");
+    print_result(test_take_chunk(1000, &error_count));
+
+    printf("Testing hex, base64 and decimal output encoders:\t");
+    print_result(test_text_codec(1000, &error_count));
+
+    printf("Testing hex and base64 input decoders:\t\t");
+    print_result(test_text_decoders(1000, &error_count));
+
+    printf("Testing the split of the input in chunks of lines:\t");
+    print_result(test_split_lines(200, &error_count));
+
     printf("Running multithreaded shape/deshape test with 100 random telegrams:\t");
     print_result(run_shape_deshape_list_test(100, &error_count));
 